@@ -1,13 +1,17 @@
 #version 460 core
 #extension GL_ARB_shader_draw_parameters : enable
 
-#include "meshes.glsl"
+#include "shadow_casters.glsl"
+#include "csm.glsl"
 
 layout (location = 0) in vec3 aPos;
 
+// each cascade is drawn on its own, into its layer attached to the frame buffer
+uniform int uCascadeIndex;
+
 void main() {
-	uint instanceIndex = gl_InstanceID + gl_BaseInstanceARB;
+	uint instanceIndex = shadowCasterSlots[gl_InstanceID + gl_BaseInstanceARB];
 	MeshInstanceData instanceData = meshInstancesDataArray[instanceIndex];
 
-	gl_Position = instanceData.model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+	gl_Position = cascades[uCascadeIndex].lightSpaceMatrix * instanceData.model * vec4(aPos, 1.0);
+}
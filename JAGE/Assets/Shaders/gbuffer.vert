@@ -19,7 +19,7 @@ layout (location = 2) in vec2 aTexCoords;
 
 void main()
 {
-	 uint instanceIndex = gl_InstanceID + gl_BaseInstanceARB;
+	 uint instanceIndex = visibleInstanceSlots[gl_InstanceID + gl_BaseInstanceARB];
 	 MeshInstanceData instanceData = meshInstancesDataArray[instanceIndex];
 
 	 gl_Position = projection * view * instanceData.model * vec4(aPos, 1.0);
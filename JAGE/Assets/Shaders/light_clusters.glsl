@@ -0,0 +1,27 @@
+#version 460 core
+
+// view space froxels, x and y split the screen, z splits the view depth exponentially
+layout (std140, binding = 15) uniform LightClusterGrid {
+    uvec4 clusterGrid;
+    float clusterSliceScale;
+    float clusterSliceBias;
+};
+
+struct LightClusterRange {
+    uint offset;
+    uint count;
+};
+
+layout (std430, binding = 16) readonly buffer LightClusters {
+    LightClusterRange lightClusters[];
+};
+
+layout (std430, binding = 17) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+uint GetLightCluster(vec2 screenUV, float viewDepth) {
+    uint  slice = uint(clamp(log(viewDepth) * clusterSliceScale + clusterSliceBias, 0.0, float(clusterGrid.z - 1u)));
+    uvec2 tile  = min(uvec2(screenUV * vec2(clusterGrid.xy)), clusterGrid.xy - 1u);
+    return tile.x + clusterGrid.x * (tile.y + clusterGrid.y * slice);
+};
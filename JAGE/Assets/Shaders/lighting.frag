@@ -4,6 +4,7 @@
 #include "csm.glsl"
 #include "camera.glsl"
 #include "lighting.glsl"
+#include "light_clusters.glsl"
 
 in  vec2  TexCoords;
 
@@ -28,34 +29,39 @@ void main() {
     vec3  camToFragDir     = normalize(viewPos.xyz - WorldFragPos);
     vec3  lightingResult   = vec3(0.0, 0.0, 0.0);
 
-    if (pointLightsCount > 0) {
-	    for (int i = 0; i < pointLightsCount; ++i) {
-            PointLightData pointLight   = pointLights[i];
-            vec3  pointLightDir         = normalize(pointLight.position - WorldFragPos);
-            float distanceToLight       = length(pointLight.position - WorldFragPos);
-            float attenuation           = 1.0 / (distanceToLight * distanceToLight);
-            float attenuatedIntensity   = pointLight.intensity * attenuation;
+    // only the lights assigned to this pixel's cluster can reach it
+    float viewDepth = -(view * vec4(WorldFragPos, 1.0)).z;
+    LightClusterRange cluster = lightClusters[GetLightCluster(TexCoords, viewDepth)];
 
-            vec3 pointLightResult = GetLight(
-                pointLight.color, 
-                attenuatedIntensity, 
-                pointLightDir, 
-                camToFragDir, 
-                WorldNormal, 
-                Specular
-            );
+    for (uint c = 0u; c < cluster.count; ++c) {
+        PointLightData pointLight   = pointLights[lightIndices[cluster.offset + c]];
+        vec3  pointLightDir         = normalize(pointLight.position - WorldFragPos);
+        float distanceToLight       = length(pointLight.position - WorldFragPos);
+        float attenuation           = GetPointLightAttenuation(distanceToLight, pointLight.range);
+        float attenuatedIntensity   = pointLight.intensity * attenuation;
 
-            float shadow = GetPointLightDataShadow(
+        vec3 pointLightResult = GetLight(
+            pointLight.color, 
+            attenuatedIntensity, 
+            pointLightDir, 
+            camToFragDir, 
+            WorldNormal, 
+            Specular
+        );
+
+        float shadow = 0.0;
+        if (pointLight.shadowLayer >= 0) {
+            shadow = GetPointLightDataShadow(
                 shadowCubemapArray,
-                pointLight.dataArrayIndex, 
+                pointLight.shadowLayer, 
                 WorldFragPos, 
                 pointLight.position, 
                 pointLight.shadowFarPlane,
                 viewPos.xyz
             );
-            
-		    lightingResult += (1.0 - shadow) * pointLightResult;
-	    };
+        };
+        
+        lightingResult += (1.0 - shadow) * pointLightResult;
     };
 
     if (hasDirectionalLight) {
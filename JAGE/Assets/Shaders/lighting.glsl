@@ -34,11 +34,13 @@ const vec3 sampleOffsetDirections[20] = vec3[] (
 
 struct PointLightData {
     vec3  position;
+    int   shadowLayer;
     vec3  color;
     float intensity;
     float shadowFarPlane;
     float shadowNearPlane;
     int   dataArrayIndex;
+    float range;
     mat4  cubemapViewMatrices[6];
 };
 
@@ -74,6 +76,13 @@ vec3 GetLight(vec3  lightColor,
     return diffuse + spec;;
 };
 
+// inverse square falloff windowed to reach zero at the light's range
+float GetPointLightAttenuation(float distanceToLight, float range) {
+    float ratio  = distanceToLight / range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return (window * window) / max(distanceToLight * distanceToLight, 0.0001);
+};
+
 float GetRandomPoissonIndex(vec4 seed4) {
     float dot_product = dot(seed4, vec4(12.9898,78.233,45.164,94.673));
     return fract(sin(dot_product) * 43758.5453);
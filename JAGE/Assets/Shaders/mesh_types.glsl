@@ -0,0 +1,30 @@
+#version 460 core
+
+struct DrawMeshCommandData {
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	uint baseVertex;
+	uint baseInstance;
+
+	int diffTexHndlrIndex;
+	int specTexHndlrIndex;
+	int normTexHndlrIndex;
+
+	uint lodCount;
+	float lodError;
+};
+
+const uint FREE_INSTANCE_SLOT = 0xFFFFFFFFu;
+
+// point shadow caster entries, slot in the low bits and the touched cube faces above
+const uint SHADOW_CASTER_FACE_SHIFT = 26u;
+const uint SHADOW_CASTER_SLOT_MASK = (1u << SHADOW_CASTER_FACE_SHIFT) - 1u;
+
+struct MeshInstanceData {
+	mat4 model;
+	mat4 inverseModel;
+	vec4 boundsCenter;		// world AABB
+	vec3 boundsExtent;
+	uint drawCmdIndex;		// FREE_INSTANCE_SLOT when the slot is unused
+};
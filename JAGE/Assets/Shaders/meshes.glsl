@@ -1,28 +1,16 @@
 #version 460 core
 
-struct DrawMeshCommandData {
-	uint count;
-	uint instanceCount;
-	uint firstIndex;
-	uint baseVertex;
-	uint baseInstance;
-
-	int diffTexHndlrIndex;
-	int specTexHndlrIndex;
-	int normTexHndlrIndex;
-};
-
-struct MeshInstanceData {
-	mat4 model;
-	mat4 inverseModel;
-	bool shouldDraw;
-	float padding[3];
-};
+#include "mesh_types.glsl"
 
 layout(std430, binding = 2) readonly buffer MeshInstanceDataArray {
     MeshInstanceData meshInstancesDataArray[];
 };
 
+// persistent instance slots visible this frame, indexed by gl_BaseInstance + gl_InstanceID
+layout(std430, binding = 10) readonly buffer VisibleInstanceSlots {
+    uint visibleInstanceSlots[];
+};
+
 layout(std430, binding = 7) readonly buffer DrawCmdsDataArray {
     DrawMeshCommandData drawCmdsDataArray[];
 };
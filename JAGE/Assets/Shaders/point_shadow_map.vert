@@ -3,11 +3,14 @@
 
 layout (location = 0) in vec3 aPos;
 
-#include "meshes.glsl"
+#include "shadow_casters.glsl"
+
+flat out uint vFaceMask;
 
 void main() {
-	uint instanceIndex = gl_InstanceID + gl_BaseInstanceARB;
-	MeshInstanceData instanceData = meshInstancesDataArray[instanceIndex];
+	uint casterEntry = shadowCasterSlots[gl_InstanceID + gl_BaseInstanceARB];
+	MeshInstanceData instanceData = meshInstancesDataArray[casterEntry & SHADOW_CASTER_SLOT_MASK];
 
+	vFaceMask = casterEntry >> SHADOW_CASTER_FACE_SHIFT;
 	gl_Position = instanceData.model * vec4(aPos, 1.0);
 }
\ No newline at end of file
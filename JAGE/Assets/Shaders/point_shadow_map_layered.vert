@@ -0,0 +1,22 @@
+#version 460 core
+#extension GL_ARB_shader_draw_parameters : enable
+#extension GL_ARB_shader_viewport_layer_array : require
+
+layout (location = 0) in vec3 aPos;
+
+#include "shadow_casters.glsl"
+#include "lighting.glsl"
+
+uniform int uPointLightIndex;
+
+out vec4 FragPos;
+
+void main() {
+	uint casterEntry = shadowCasterSlots[gl_InstanceID + gl_BaseInstanceARB];
+	MeshInstanceData instanceData = meshInstancesDataArray[casterEntry & SHADOW_CASTER_SLOT_MASK];
+	int face = int(casterEntry >> SHADOW_CASTER_FACE_SHIFT);
+
+	FragPos = instanceData.model * vec4(aPos, 1.0);
+	gl_Position = pointLights[uPointLightIndex].cubemapViewMatrices[face] * FragPos;
+	gl_Layer = 6 * pointLights[uPointLightIndex].shadowLayer + face;
+}
\ No newline at end of file
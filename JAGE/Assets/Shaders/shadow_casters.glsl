@@ -0,0 +1,10 @@
+#version 460 core
+
+#include "meshes.glsl"
+
+// casters of the light or cascade being drawn, grouped by draw command. For point lights the
+// bits above the slot hold the mask of touched faces on the geometry shader path and a single
+// face index on the instanced paths, cascades store the bare slot
+layout(std430, binding = 13) readonly buffer ShadowCasterSlots {
+    uint shadowCasterSlots[];
+};
@@ -8,7 +8,7 @@ uniform mat4 uLightSpaceMatrix;
 
 void main()
 {
-	uint instanceIndex = gl_InstanceID + gl_BaseInstanceARB;
+	uint instanceIndex = visibleInstanceSlots[gl_InstanceID + gl_BaseInstanceARB];
 	MeshInstanceData instanceData = meshInstancesDataArray[instanceIndex];
 
 	gl_Position = uLightSpaceMatrix * instanceData.model * vec4(aPos, 1.0);
@@ -3,153 +3,503 @@
 #include <filesystem>
 #include "AssetManager.h"
 #include "AssetLoader.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "TextureCooker.h"
+
+namespace {
+	TextureAssetType ToTextureAssetType(const aiTextureType aiType) {
+		switch (aiType) {
+		case aiTextureType_AMBIENT_OCCLUSION: return TextureAssetType::AO;
+		case aiTextureType_METALNESS: return TextureAssetType::Metallic;
+		case aiTextureType_SPECULAR: return TextureAssetType::Specular;
+		case aiTextureType_NORMALS: return TextureAssetType::Normal;
+		default: return TextureAssetType::Albedo;
+		}
+	}
+
+	/* Everything that changes what an import produces, part of the mesh cache key. */
+	uint64_t HashImportOptions(const uint32_t readFlags, const AssetImportSettings& settings) {
+		const uint32_t counts[6] = { readFlags, settings.lodCount, settings.lodMinTriangles, settings.optimize ? 1u : 0u, settings.cacheSize, settings.compactVertices ? 1u : 0u };
+		const float thresholds[3] = { settings.lodReduction, settings.lodMaxError, settings.overdrawThreshold };
+		const uint64_t hash = Utils::HashBytes(counts, sizeof(counts));
+		return Utils::HashBytes(thresholds, sizeof(thresholds), hash);
+	}
+}
 
 MeshModel& AssetLoader::LoadMeshModelFromFile(const std::string& path, bool flipUV) {
-	auto& assetManager = AssetManager::Get();
-	auto* existingModel = assetManager.GetAssetByPath<MeshModel>(path);
+	return Wait(LoadMeshModelAsync(path, flipUV));
+}
 
+std::shared_future<MeshModel*> AssetLoader::LoadMeshModelAsync(const std::string& path, bool flipUV) {
+	auto* existingModel = AssetManager::Get().GetAssetByPath<MeshModel>(path);
 	if (existingModel) {
-		return *existingModel;
+		std::promise<MeshModel*> ready;
+		ready.set_value(existingModel);
+		return ready.get_future().share();
+	}
+
+	auto pending = pendingModels.find(path);
+	if (pending != pendingModels.end())
+		return pending->second;
+
+	StartWorkers();
+
+	auto import = std::make_shared<ModelImport>();
+	import->path = path;
+	import->flipUV = flipUV;
+	import->settings = ReadImportSettings();
+
+	std::shared_future<MeshModel*> model = import->promise.get_future().share();
+	pendingModels[path] = model;
+	{
+		std::lock_guard<std::mutex> lock(importsMutex);
+		requestedImports.push_back(import);
+	}
+	QueueTask([this, import]() { ImportScene(import); });
+	return model;
+}
+
+void AssetLoader::Poll() {
+	// a finished import waits for every import requested before it
+	std::vector<std::shared_ptr<ModelImport>> imports;
+	{
+		std::lock_guard<std::mutex> lock(importsMutex);
+		while (!requestedImports.empty() && requestedImports.front()->finished) {
+			imports.push_back(std::move(requestedImports.front()));
+			requestedImports.pop_front();
+		}
+	}
+
+	for (const auto& import : imports) {
+		MeshModel* model = CommitModel(*import);
+		pendingModels.erase(import->path);
+		import->promise.set_value(model);
 	}
+}
+
+MeshModel& AssetLoader::Wait(const std::shared_future<MeshModel*>& model) {
+	while (model.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready)
+		Poll();
 
-	std::unique_ptr<Assimp::Importer> importer = std::make_unique<Assimp::Importer>();
+	return *model.get();
+}
 
+/* Reads the model's mesh cache, or the scene when there is none, then queues one task per
+mesh and per texture file. */
+void AssetLoader::ImportScene(const std::shared_ptr<ModelImport>& import) {
 	uint32_t readFlags = aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_OptimizeMeshes;
-	if (flipUV)
+	if (import->flipUV)
 		readFlags |= aiProcess_FlipUVs;
-	const aiScene* scene = importer->ReadFile(path, readFlags);
 
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
-	{
-		LOG("AssimpImporter", LOG_ERROR, importer->GetErrorString());
-		LOG(LogAssetLoader, LOG_CRITICAL, "Failed to load model from file at " + path);
+	if (import->settings.cacheMeshes) {
+		import->cachePath = MeshCache::GetCachePath(import->path, HashImportOptions(readFlags, import->settings));
+		if (!import->cachePath.empty() && ImportCachedScene(import))
+			return;
 	}
 
-	auto& meshModel = assetManager.CreateAsset<MeshModel>();
-	meshModel.assetPath = path;
+	import->importer = std::make_unique<Assimp::Importer>();
+	const aiScene* scene = import->importer->ReadFile(import->path, readFlags);
+	import->scene = scene;
 
-	ProcessObjNode(scene->mRootNode, scene, path, meshModel);
+	// the import's own task holds it open until every other task is queued
+	import->remainingTasks = 1;
 
-	if (meshModel.meshes.size() == 0) {
-		LOG(LogAssetLoader, LOG_CRITICAL, std::format("Failed to load model from file {}", path));
+	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+		import->error = import->importer->GetErrorString();
+		FinishTask(import);
+		return;
+	}
+
+	std::vector<const aiMesh*> aiMeshes;
+	CollectMeshes(scene->mRootNode, scene, aiMeshes);
+	import->meshes.resize(aiMeshes.size());
+
+	std::unordered_map<std::string, int32_t> texturePaths;
+	for (size_t i = 0; i < aiMeshes.size(); i++) {
+		if (aiMeshes[i]->mMaterialIndex >= 0) {
+			aiMaterial* aiMat = scene->mMaterials[aiMeshes[i]->mMaterialIndex];
+			import->meshes[i].diffuseTexture = CollectTexture(aiMat, aiTextureType_DIFFUSE, *import, texturePaths);
+			import->meshes[i].specularTexture = CollectTexture(aiMat, aiTextureType_SPECULAR, *import, texturePaths);
+			import->meshes[i].normalTexture = CollectTexture(aiMat, aiTextureType_NORMALS, *import, texturePaths);
+		}
+	}
+
+	import->remainingTasks += static_cast<uint32_t>(aiMeshes.size() + import->textures.size());
+
+	for (size_t i = 0; i < aiMeshes.size(); i++) {
+		const aiMesh* aiMesh = aiMeshes[i];
+		QueueTask([this, import, aiMesh, i]() {
+			ImportedMesh& imported = import->meshes[i];
+			ProcessMesh(aiMesh, import->settings, imported);
+			if (import->settings.compactVertices)
+				imported.packedVertices.assign(imported.mesh.vertices.begin(), imported.mesh.vertices.end());
+			FinishTask(import);
+		});
+	}
+
+	for (size_t i = 0; i < import->textures.size(); i++) {
+		QueueTask([this, import, i]() {
+			ImportedTexture& imported = import->textures[i];
+			imported.loaded = PrepareTexture(imported.texture.assetPath, imported.texture.type, import->settings, imported.texture);
+			FinishTask(import);
+		});
 	}
 
-	return meshModel;
+	FinishTask(import);
 }
 
-void AssetLoader::ProcessObjNode(aiNode* node, const aiScene* scene, const std::string& path, MeshModel& meshModel) {
+void AssetLoader::CollectMeshes(const aiNode* node, const aiScene* scene, std::vector<const aiMesh*>& aiMeshes) {
 	for (uint32_t i = 0; i < node->mNumMeshes; i++) {
-		aiMesh* aimesh = scene->mMeshes[node->mMeshes[i]];
-		Asset meshAssetId = ProcessMesh(aimesh, scene, path);
-		meshModel.meshes.push_back(meshAssetId);
+		aiMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
 	}
 
 	for (uint32_t i = 0; i < node->mNumChildren; i++) {
-		ProcessObjNode(node->mChildren[i], scene, path, meshModel);
+		CollectMeshes(node->mChildren[i], scene, aiMeshes);
 	}
 }
 
-Asset AssetLoader::ProcessMesh(aiMesh* aiMesh, const aiScene* scene, const std::string& path) {
-	auto& assetManager = AssetManager::Get();
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
+/* First texture of the type on the material, as an index into the import's textures.
+Meshes sharing a file share the entry. */
+int32_t AssetLoader::CollectTexture(aiMaterial* mat, const aiTextureType aiType, ModelImport& import, std::unordered_map<std::string, int32_t>& texturePaths) {
+	if (mat->GetTextureCount(aiType) == 0)
+		return -1;
+
+	aiString fileName;
+	mat->GetTexture(aiType, 0, &fileName);
+	std::filesystem::path pathObj(import.path);
+	const std::string texturePath = (pathObj.parent_path() / std::string(fileName.C_Str())).string();
+
+	auto [it, inserted] = texturePaths.try_emplace(texturePath, static_cast<int32_t>(import.textures.size()));
+	if (inserted) {
+		ImportedTexture& imported = import.textures.emplace_back();
+		imported.texture.assetPath = texturePath;
+		imported.texture.type = ToTextureAssetType(aiType);
+	}
+
+	return it->second;
+}
 
+void AssetLoader::ProcessMesh(const aiMesh* aiMesh, const AssetImportSettings& settings, ImportedMesh& imported) {
+	Mesh& mesh = imported.mesh;
+
+	mesh.vertices.resize(aiMesh->mNumVertices);
 	for (uint32_t i = 0; i < aiMesh->mNumVertices; i++) {
-		Vertex vertex;
+		Vertex& vertex = mesh.vertices[i];
+		vertex.Position = Vec3(aiMesh->mVertices[i].x, aiMesh->mVertices[i].y, aiMesh->mVertices[i].z);
 
-		glm::vec3 vector;
-		vector.x = aiMesh->mVertices[i].x;
-		vector.y = aiMesh->mVertices[i].y;
-		vector.z = aiMesh->mVertices[i].z;
+		if (aiMesh->mNormals)
+			vertex.Normal = Vec3(aiMesh->mNormals[i].x, aiMesh->mNormals[i].y, aiMesh->mNormals[i].z);
 
-		vertex.Position = vector;
+		if (aiMesh->mTextureCoords[0])
+			vertex.TexCoords = Vec2(aiMesh->mTextureCoords[0][i].x, aiMesh->mTextureCoords[0][i].y);
+	}
 
-		vector.x = aiMesh->mNormals[i].x;
-		vector.y = aiMesh->mNormals[i].y;
-		vector.z = aiMesh->mNormals[i].z;
+	// triangulated, so three indices per face
+	mesh.indices.reserve(static_cast<size_t>(aiMesh->mNumFaces) * 3);
+	for (uint32_t i = 0; i < aiMesh->mNumFaces; i++) {
+		const aiFace& face = aiMesh->mFaces[i];
+		mesh.indices.insert(mesh.indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+	}
 
-		vertex.Normal = vector;
+	imported.importedVertexCount = mesh.vertices.size();
+	mesh.ComputeBounds();
+	GenerateMeshLods(mesh, settings);
+	OptimizeMesh(mesh, settings, imported);
+	mesh.ComputeBounds();
+}
 
-		if (aiMesh->mTextureCoords[0])
-		{
-			glm::vec2 vec;
-			vec.x = aiMesh->mTextureCoords[0][i].x;
-			vec.y = aiMesh->mTextureCoords[0][i].y;
-			vertex.TexCoords = vec;
-		}
-		else
-			vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+/* The last task of an import hands it to the render thread. */
+void AssetLoader::FinishTask(const std::shared_ptr<ModelImport>& import) {
+	if (--import->remainingTasks > 0)
+		return;
 
-		vertices.push_back(vertex);
-	};
+	import->scene = nullptr;
+	import->importer.reset();
 
-	for (uint32_t i = 0; i < aiMesh->mNumFaces; i++) {
-		aiFace face = aiMesh->mFaces[i];
-		for (uint32_t j = 0; j < face.mNumIndices; j++)
-		{
-			indices.push_back(face.mIndices[j]);
-		}
-	};
+	if (import->error.empty() && !import->meshes.empty() && !import->cacheFile.IsOpen() && !import->cachePath.empty())
+		WriteCache(*import);
 
-	Mesh& newMesh = assetManager.CreateAsset<Mesh>();
-	newMesh.assetPath = path;
-	newMesh.vertices = vertices;
-	newMesh.indices = indices;
+	std::lock_guard<std::mutex> lock(importsMutex);
+	import->finished = true;
+}
+
+/* Maps the model's cache and copies each mesh out of it on the workers, for the physics and
+the occlusion culling that read meshes on the CPU. The GPU buffers are filled from the mapping.
+Returns false when there is no valid cache and the scene has to be imported. */
+bool AssetLoader::ImportCachedScene(const std::shared_ptr<ModelImport>& import) {
+	std::vector<MeshCacheTexture> cachedTextures;
+	std::vector<MeshCacheEntry> cachedMeshes;
+	if (!import->cacheFile.Open(import->cachePath) || !MeshCache::Read(import->cacheFile, cachedTextures, cachedMeshes)) {
+		import->cacheFile.Close();
+		return false;
+	}
+
+	import->textures.resize(cachedTextures.size());
+	for (size_t i = 0; i < cachedTextures.size(); i++) {
+		import->textures[i].texture.assetPath = std::move(cachedTextures[i].path);
+		import->textures[i].texture.type = cachedTextures[i].type;
+	}
 
-	if (aiMesh->mMaterialIndex >= 0) {
-		aiMaterial* aiMat = scene->mMaterials[aiMesh->mMaterialIndex];
-		std::vector<Asset> diffuseTextures = LoadTexturesFromMaterial(aiMat, aiTextureType_DIFFUSE, path);
-		std::vector<Asset> specularTextures = LoadTexturesFromMaterial(aiMat, aiTextureType_SPECULAR, path);
-		std::vector<Asset> normalTextures = LoadTexturesFromMaterial(aiMat, aiTextureType_NORMALS, path);
+	import->meshes.resize(cachedMeshes.size());
+	for (size_t i = 0; i < cachedMeshes.size(); i++) {
+		ImportedMesh& imported = import->meshes[i];
+		imported.cachedData = cachedMeshes[i].data;
+		imported.mesh.boundsMin = cachedMeshes[i].boundsMin;
+		imported.mesh.boundsMax = cachedMeshes[i].boundsMax;
+		imported.diffuseTexture = cachedMeshes[i].diffuseTexture;
+		imported.specularTexture = cachedMeshes[i].specularTexture;
+		imported.normalTexture = cachedMeshes[i].normalTexture;
+	}
 
-		// create material assigned to this mesh
-		if (!diffuseTextures.empty())
-			newMesh.diffuseTexture = diffuseTextures[0];
-		if (!specularTextures.empty())
-			newMesh.specularTexture = specularTextures[0];
-		if (!normalTextures.empty())
-			newMesh.specularTexture = normalTextures[0];
+	import->remainingTasks = 1 + static_cast<uint32_t>(import->meshes.size() + import->textures.size());
+
+	for (size_t i = 0; i < import->meshes.size(); i++) {
+		QueueTask([this, import, i]() {
+			ImportedMesh& imported = import->meshes[i];
+			const MeshData& data = imported.cachedData;
+			imported.mesh.vertices.assign(data.vertices.begin(), data.vertices.end());
+			imported.mesh.indices.assign(data.indices.begin(), data.indices.end());
+			imported.mesh.lods.resize(data.lodCount);
+			for (uint32_t lod = 0; lod < data.lodCount; lod++) {
+				imported.mesh.lods[lod].indices.assign(data.lodIndices[lod].begin(), data.lodIndices[lod].end());
+				imported.mesh.lods[lod].error = data.lodErrors[lod];
+			}
+			FinishTask(import);
+		});
 	}
 
-	OpenGlApi::Get().RegisterMesh(&newMesh);
+	for (size_t i = 0; i < import->textures.size(); i++) {
+		QueueTask([this, import, i]() {
+			ImportedTexture& imported = import->textures[i];
+			imported.loaded = PrepareTexture(imported.texture.assetPath, imported.texture.type, import->settings, imported.texture);
+			FinishTask(import);
+		});
+	}
 
-	return newMesh.assetId;
+	FinishTask(import);
+	return true;
 }
 
-std::vector<Asset> AssetLoader::LoadTexturesFromMaterial(aiMaterial* mat, const aiTextureType aiType, const std::string& path) {
-	std::vector<Asset> textures;
+/* A failed write only means importing through Assimp again next run. */
+void AssetLoader::WriteCache(const ModelImport& import) {
+	std::vector<MeshCacheTexture> cachedTextures(import.textures.size());
+	for (size_t i = 0; i < import.textures.size(); i++) {
+		cachedTextures[i].path = import.textures[i].texture.assetPath;
+		cachedTextures[i].type = import.textures[i].texture.type;
+	}
 
-	TextureAssetType texType;
-	if (aiType == aiTextureType_BASE_COLOR || aiType == aiTextureType_DIFFUSE) {
-		texType = TextureAssetType::Albedo;
+	std::vector<MeshCacheEntry> cachedMeshes(import.meshes.size());
+	for (size_t i = 0; i < import.meshes.size(); i++) {
+		const ImportedMesh& imported = import.meshes[i];
+		cachedMeshes[i].data = imported.mesh.GetData();
+		cachedMeshes[i].data.packedVertices = imported.packedVertices;
+		cachedMeshes[i].boundsMin = imported.mesh.boundsMin;
+		cachedMeshes[i].boundsMax = imported.mesh.boundsMax;
+		cachedMeshes[i].diffuseTexture = imported.diffuseTexture;
+		cachedMeshes[i].specularTexture = imported.specularTexture;
+		cachedMeshes[i].normalTexture = imported.normalTexture;
 	}
-	else if (aiType == aiTextureType_AMBIENT_OCCLUSION) {
-		texType = TextureAssetType::AO;
+
+	MeshCache::Write(import.cachePath, cachedTextures, cachedMeshes);
+}
+
+/* Creates the assets of a finished import and registers them, textures first since the
+meshes' draw commands take their handle indices. */
+MeshModel* AssetLoader::CommitModel(ModelImport& import) {
+	auto& assetManager = AssetManager::Get();
+
+	auto& meshModel = assetManager.CreateAsset<MeshModel>(import.path);
+
+	if (!import.error.empty()) {
+		LOG("AssimpImporter", LOG_ERROR, import.error);
+		LOG(LogAssetLoader, LOG_CRITICAL, "Failed to load model from file at " + import.path);
+		return &meshModel;
 	}
-	else if (aiType == aiTextureType_METALNESS) {
-		texType = TextureAssetType::Metallic;
+
+	const bool fromCache = import.cacheFile.IsOpen();
+	if (fromCache)
+		LOG(LogAssetLoader, LOG_VERBOSE, std::format("Loaded model {} from mesh cache {}", import.path, import.cachePath));
+
+	std::vector<AssetHandle<Texture>> textures(import.textures.size());
+	for (size_t i = 0; i < import.textures.size(); i++) {
+		Texture& prepared = import.textures[i].texture;
+
+		// loaded meanwhile by another model
+		Texture* existingTexture = assetManager.GetAssetByPath<Texture>(prepared.assetPath);
+		if (existingTexture) {
+			stbi_image_free(prepared.data);
+			textures[i] = AssetHandle<Texture>(existingTexture->assetId);
+			continue;
+		}
+
+		if (!import.textures[i].loaded) {
+			LOG(LogAssetLoader, LOG_CRITICAL, "Failed to load texture from " + prepared.assetPath);
+			continue;
+		}
+
+		textures[i] = AssetHandle<Texture>(CommitTexture(prepared).assetId);
+	}
+
+	for (size_t i = 0; i < import.meshes.size(); i++) {
+		ImportedMesh& imported = import.meshes[i];
+		Mesh& newMesh = assetManager.CreateAsset<Mesh>(import.path, static_cast<uint32_t>(i));
+		newMesh.vertices = std::move(imported.mesh.vertices);
+		newMesh.indices = std::move(imported.mesh.indices);
+		newMesh.lods = std::move(imported.mesh.lods);
+		newMesh.boundsMin = imported.mesh.boundsMin;
+		newMesh.boundsMax = imported.mesh.boundsMax;
+
+		if (imported.diffuseTexture >= 0)
+			newMesh.diffuseTexture = textures[imported.diffuseTexture];
+		if (imported.specularTexture >= 0)
+			newMesh.specularTexture = textures[imported.specularTexture];
+		if (imported.normalTexture >= 0)
+			newMesh.normalTexture = textures[imported.normalTexture];
+
+		for (const AssetHandle<Texture> texture : { newMesh.diffuseTexture, newMesh.specularTexture, newMesh.normalTexture }) {
+			if (texture.IsValid())
+				assetManager.AddDependency(newMesh.assetId, texture.id);
+		}
+
+		LOG(LogAssetLoader, LOG_VERBOSE, std::format("Generated {} lods for mesh from {} ({} triangles)", newMesh.lods.size(), newMesh.assetPath, newMesh.indices.size() / 3));
+		if (import.settings.optimize && !fromCache)
+			LOG(LogAssetLoader, LOG_VERBOSE, std::format("Optimized mesh from {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, {} -> {} vertices",
+				newMesh.assetPath, imported.before.acmr, imported.after.acmr, imported.before.atvr, imported.after.atvr, imported.importedVertexCount, newMesh.vertices.size()));
+
+		MeshData data = fromCache ? imported.cachedData : newMesh.GetData();
+		if (!fromCache)
+			data.packedVertices = imported.packedVertices;
+		OpenGlApi::Get().RegisterMesh(&newMesh, data);
+		meshModel.meshes.push_back(newMesh.assetId);
+		assetManager.AddDependency(meshModel.assetId, newMesh.assetId);
 	}
-	else if (aiType == aiTextureType_SPECULAR) {
-		texType = TextureAssetType::Specular;
+
+	import.cacheFile.Close();
+
+	if (meshModel.meshes.size() == 0) {
+		LOG(LogAssetLoader, LOG_CRITICAL, std::format("Failed to load model from file {}", import.path));
 	}
-	else if (aiType == aiTextureType_NORMALS)
+
+	return &meshModel;
+}
+
+AssetImportSettings AssetLoader::ReadImportSettings() {
+	AssetImportSettings settings;
+	settings.lodCount = std::clamp(cfg::Engine.Read<uint32_t>("Assets", "assets.lod.count", MESH_MAX_LODS), 1u, static_cast<uint32_t>(MESH_MAX_LODS));
+	settings.lodReduction = std::clamp(cfg::Engine.Read<float>("Assets", "assets.lod.reduction", 0.5f), 0.05f, 0.95f);
+	settings.lodMaxError = cfg::Engine.Read<float>("Assets", "assets.lod.max_error", 0.05f);
+	settings.lodMinTriangles = cfg::Engine.Read<uint32_t>("Assets", "assets.lod.min_triangles", 64);
+	settings.optimize = cfg::Engine.Read<bool>("Assets", "assets.optimize.enabled", true);
+	settings.cacheSize = std::max(3u, cfg::Engine.Read<uint32_t>("Assets", "assets.optimize.cache_size", 16));
+	settings.overdrawThreshold = cfg::Engine.Read<float>("Assets", "assets.optimize.overdraw_threshold", 1.05f);
+	settings.cookTextures = cfg::Engine.Read<bool>("Assets", "assets.textures.cook", true);
+	settings.useBC7 = cfg::Engine.Read<bool>("Assets", "assets.textures.bc7", false);
+	settings.streamTextures = cfg::Engine.Read<bool>("Assets", "assets.textures.stream", true);
+	settings.cacheMeshes = cfg::Engine.Read<bool>("Assets", "assets.meshes.cache", true);
+	settings.compactVertices = cfg::Rendering.Read<bool>("OpenGL", "opengl.mesh.compact_vertices", true);
+	return settings;
+}
+
+/* 0 threads in the config leaves one hardware thread to the render thread. */
+void AssetLoader::StartWorkers() {
+	if (!workers.empty())
+		return;
+
+	uint32_t threadCount = cfg::Engine.Read<uint32_t>("Assets", "assets.import.threads", 0);
+	if (threadCount == 0)
+		threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+	for (uint32_t i = 0; i < threadCount; i++)
+		workers.emplace_back([this](std::stop_token stopToken) { Run(stopToken); });
+}
+
+void AssetLoader::StopWorkers() {
+	for (std::jthread& worker : workers)
+		worker.request_stop();
+
+	taskAvailable.notify_all();
+	workers.clear();
+}
+
+void AssetLoader::QueueTask(std::function<void()> task) {
 	{
-		texType = TextureAssetType::Normal;
+		std::lock_guard<std::mutex> lock(tasksMutex);
+		tasks.push_back(std::move(task));
 	}
-	else {
-		LOG(LogAssetLoader, LOG_CRITICAL, std::format("Failed to infer texture type from texture at {}", path));
+	taskAvailable.notify_one();
+}
+
+void AssetLoader::Run(std::stop_token stopToken) {
+	while (!stopToken.stop_requested()) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(tasksMutex);
+			if (!taskAvailable.wait(lock, stopToken, [this] { return !tasks.empty(); }))
+				return;
+
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		task();
 	}
+}
+
+void AssetLoader::GenerateMeshLods(Mesh& mesh, const AssetImportSettings& settings) {
+	const uint32_t lodCount = settings.lodCount;
+	const float reduction = settings.lodReduction;
+	const float maxError = settings.lodMaxError;
+	const size_t minTriangles = settings.lodMinTriangles;
 
-	for (uint32_t i = 0; i < mat->GetTextureCount(aiType); i++) {
-		aiString fileName;
-		mat->GetTexture(aiType, i, &fileName);
-		std::filesystem::path pathObj(path);
-		std::filesystem::path texturePathObj = pathObj.parent_path() / std::string(fileName.C_Str());
-		Texture& texture = LoadTextureFromFile(texturePathObj.string(), texType);
-		textures.push_back(texture.assetId);
+	mesh.lods.clear();
+
+	// every level starts from the full mesh so that errors do not stack up
+	size_t previousCount = mesh.indices.size();
+	float target = static_cast<float>(mesh.indices.size());
+	for (uint32_t lod = 1; lod < lodCount; lod++) {
+		target *= reduction;
+		const size_t targetCount = static_cast<size_t>(target) / 3 * 3;
+		if (targetCount < minTriangles * 3)
+			break;
+
+		MeshLod meshLod;
+		meshLod.indices = MeshSimplifier::Simplify(mesh.vertices, mesh.indices, targetCount, maxError, &meshLod.error);
+
+		// the error bound stopped the simplifier, a level this close to the last one is not worth a draw
+		if (meshLod.indices.empty() || meshLod.indices.size() > previousCount * 9 / 10)
+			break;
+
+		previousCount = meshLod.indices.size();
+		mesh.lods.push_back(std::move(meshLod));
+	}
+}
+
+/* Orders every lod's triangles for the post-transform cache, the full mesh also for overdraw,
+then packs the vertices in the order the full mesh first reads them. */
+void AssetLoader::OptimizeMesh(Mesh& mesh, const AssetImportSettings& settings, ImportedMesh& imported) {
+	if (!settings.optimize)
+		return;
+
+	const uint32_t cacheSize = settings.cacheSize;
+	const float overdrawThreshold = settings.overdrawThreshold;
+
+	imported.before = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), cacheSize);
+
+	MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.vertices.size(), cacheSize);
+	if (overdrawThreshold >= 1.0f)
+		MeshOptimizer::OptimizeOverdraw(mesh.indices, mesh.vertices, cacheSize, overdrawThreshold);
+	for (MeshLod& lod : mesh.lods)
+		MeshOptimizer::OptimizeVertexCache(lod.indices, mesh.vertices.size(), cacheSize);
+
+	// the lods only use vertices of the full mesh, so they follow its remap
+	const std::vector<uint32_t> remap = MeshOptimizer::OptimizeVertexFetch(mesh.vertices, mesh.indices);
+	for (MeshLod& lod : mesh.lods) {
+		for (uint32_t& index : lod.indices)
+			index = remap[index];
 	}
 
-	return textures;
+	imported.after = MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), cacheSize);
 }
 
 Texture& AssetLoader::LoadTextureFromFile(const std::string& path, const uint8_t texType) {
@@ -159,26 +509,101 @@ Texture& AssetLoader::LoadTextureFromFile(const std::string& path, const uint8_t
 		return *existingTexture;
 	}
 
+	Texture prepared;
+	if (!PrepareTexture(path, static_cast<TextureAssetType>(texType), ReadImportSettings(), prepared))
+		LOG(LogAssetLoader, LOG_CRITICAL, "Failed to load texture from " + path);
+
+	return CommitTexture(prepared);
+}
+
+/* Decodes the image, or reads or cooks its cache, without creating the asset. Runs on any thread. */
+bool AssetLoader::PrepareTexture(const std::string& path, const TextureAssetType texType, const AssetImportSettings& settings, Texture& texture) {
+	texture.assetPath = path;
+	texture.type = texType;
+
+	if (settings.cookTextures && PrepareCookedTexture(path, texType, settings, texture))
+		return true;
+
 	int width, height, nrChannels;
 	unsigned char* data = stbi_load(path.data(), &width, &height, &nrChannels, 0);
 
 	if (!data || width == 0) {
-		LOG(LogAssetLoader, LOG_CRITICAL, "Failed to load texture from " + path);
 		stbi_image_free(data);
+		return false;
 	}
 
-	LOG(LogAssetLoader, LOG_VERBOSE, std::format("Loaded texture from {}. Width: {} | Height: {}", path, width, height));
-	auto& texture = assetManager.CreateAsset<Texture>();
-	texture.assetPath = path;
 	texture.data = data;
 	texture.height = height;
 	texture.width = width;
 	texture.nrChannels = nrChannels;
 	texture.hasAlphaChannel = nrChannels > 3;
-	texture.type = static_cast<TextureAssetType>(texType);
+	return true;
+}
+
+/* Fills the block compressed mips cached for the file's contents, decoding and cooking them
+first on a cache miss. Streamed textures only read the cache's mip table and leave the levels,
+or the cooking, to the renderer's workers. Returns false when the image can not be decoded. */
+bool AssetLoader::PrepareCookedTexture(const std::string& path, const TextureAssetType texType, const AssetImportSettings& settings, Texture& texture) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::vector<uint8_t> source(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(source.data()), source.size()))
+		return false;
+
+	const std::string cachePath = TextureCooker::GetCachePath(source, texType, settings.useBC7);
+
+	if (settings.streamTextures) {
+		if (!TextureCooker::ReadCacheHeader(cachePath, texture)) {
+			int width, height, nrChannels;
+			if (!stbi_info_from_memory(source.data(), static_cast<int>(source.size()), &width, &height, &nrChannels) || width == 0)
+				return false;
+
+			texture.width = width;
+			texture.height = height;
+		}
+
+		texture.cookedPath = cachePath;
+		return true;
+	}
+
+	if (TextureCooker::ReadCache(cachePath, texture))
+		return true;
+
+	if (!TextureCooker::CookSource(source, texture, settings.useBC7))
+		return false;
+
+	// a failed write only means cooking again next run
+	TextureCooker::WriteCache(cachePath, texture);
+	return true;
+}
+
+/* Creates the asset of a prepared texture and registers it, the GPU holds the only copy of
+its pixels from here on. */
+Texture& AssetLoader::CommitTexture(Texture& prepared) {
+	auto& texture = AssetManager::Get().CreateAsset<Texture>(prepared.assetPath);
+	texture.type = prepared.type;
+	texture.data = prepared.data;
+	texture.width = prepared.width;
+	texture.height = prepared.height;
+	texture.nrChannels = prepared.nrChannels;
+	texture.hasAlphaChannel = prepared.hasAlphaChannel;
+	texture.compressedFormat = prepared.compressedFormat;
+	texture.compressedData = std::move(prepared.compressedData);
+	texture.mips = std::move(prepared.mips);
+	texture.cookedPath = std::move(prepared.cookedPath);
+	prepared.data = nullptr;
+
+	const char* kind = !texture.cookedPath.empty() ? "streamed" : texture.compressedFormat != 0 ? "cooked" : "raw";
+	LOG(LogAssetLoader, LOG_VERBOSE, std::format("Loaded {} texture from {}. Width: {} | Height: {} | Mips: {}", kind, texture.assetPath, texture.width, texture.height, texture.mips.size()));
 
 	OpenGlApi::Get().RegisterTexture2D(&texture);
 
-	stbi_image_free(data);
+	stbi_image_free(texture.data);
+	texture.data = nullptr;
+	texture.compressedData.clear();
+	texture.compressedData.shrink_to_fit();
 	return texture;
-}
\ No newline at end of file
+}
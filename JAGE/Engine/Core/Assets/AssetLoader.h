@@ -4,18 +4,111 @@
 #include "Texture.h"
 #include "MeshModel.h"
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshCache.h"
 #include <stb/stb_image.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+/* Import options, read on the calling thread so that workers never touch the config. */
+struct AssetImportSettings {
+	uint32_t lodCount = MESH_MAX_LODS;
+	float lodReduction = 0.5f;
+	float lodMaxError = 0.05f;
+	uint32_t lodMinTriangles = 64;
+	bool optimize = true;
+	uint32_t cacheSize = 16;
+	float overdrawThreshold = 1.05f;
+	bool cookTextures = true;
+	bool useBC7 = false;
+	bool streamTextures = true;
+	bool cacheMeshes = true;
+	bool compactVertices = true;	// the renderer's opengl.mesh.compact_vertices, meshes then also carry PackedVertex
+};
+
+/* A mesh built by a worker, its textures index the import's texture list. */
+struct ImportedMesh {
+	Mesh mesh;
+	int32_t diffuseTexture = -1;
+	int32_t specularTexture = -1;
+	int32_t normalTexture = -1;
+	std::vector<PackedVertex> packedVertices;	// built by the worker when compactVertices is set
+	size_t importedVertexCount = 0;
+	VertexCacheStats before;	// post-transform cache before and after OptimizeMesh
+	VertexCacheStats after;
+	MeshData cachedData;		// ranges in the mapped cache when the model was cached
+};
+
+/* A texture decoded or read from the cache by a worker. */
+struct ImportedTexture {
+	Texture texture;			// path, type, size and the raw pixels or the cooked mips
+	bool loaded = false;
+};
+
+/* A model on its way through the workers. Its meshes and textures are processed in parallel
+and the last task to finish queues the model for the render thread, which turns it into assets
+and registers them with the GL. */
+struct ModelImport {
+	std::string path;
+	bool flipUV = false;
+	AssetImportSettings settings;
+	std::unique_ptr<Assimp::Importer> importer;
+	const aiScene* scene = nullptr;
+	std::string error;
+	std::string cachePath;
+	MappedFile cacheFile;		// mapped until the render thread uploaded the meshes
+
+	std::vector<ImportedMesh> meshes;		// in node order
+	std::vector<ImportedTexture> textures;	// one per texture file the meshes use
+	std::atomic<uint32_t> remainingTasks = 0;
+	bool finished = false;		// guarded by the loader's importsMutex
+	std::promise<MeshModel*> promise;
+};
 
 class AssetLoader {
 private:
 	AssetLoader() = default;
+	~AssetLoader() { StopWorkers(); }
+
+	// worker side, no assets, GL or logging
+	void ImportScene(const std::shared_ptr<ModelImport>& import);
+	bool ImportCachedScene(const std::shared_ptr<ModelImport>& import);
+	void WriteCache(const ModelImport& import);
+	void CollectMeshes(const aiNode* node, const aiScene* scene, std::vector<const aiMesh*>& aiMeshes);
+	int32_t CollectTexture(aiMaterial* mat, const aiTextureType aiType, ModelImport& import, std::unordered_map<std::string, int32_t>& texturePaths);
+	void ProcessMesh(const aiMesh* aiMesh, const AssetImportSettings& settings, ImportedMesh& imported);
+	void GenerateMeshLods(Mesh& mesh, const AssetImportSettings& settings);
+	void OptimizeMesh(Mesh& mesh, const AssetImportSettings& settings, ImportedMesh& imported);
+	bool PrepareTexture(const std::string& path, const TextureAssetType texType, const AssetImportSettings& settings, Texture& texture);
+	bool PrepareCookedTexture(const std::string& path, const TextureAssetType texType, const AssetImportSettings& settings, Texture& texture);
+	void FinishTask(const std::shared_ptr<ModelImport>& import);
+
+	// render thread side
+	MeshModel* CommitModel(ModelImport& import);
+	Texture& CommitTexture(Texture& prepared);
+	static AssetImportSettings ReadImportSettings();
 
-	void ProcessObjNode(aiNode* node, const aiScene* scene, const std::string& path, MeshModel& meshModel);
-	Asset ProcessMesh(aiMesh* mesh, const aiScene* scene, const std::string& path);
-	std::vector<Asset> LoadTexturesFromMaterial(aiMaterial* mat, const aiTextureType aiType, const std::string& path);
+	void StartWorkers();
+	void StopWorkers();
+	void QueueTask(std::function<void()> task);
+	void Run(std::stop_token stopToken);
+
+	std::mutex tasksMutex;
+	std::condition_variable_any taskAvailable;
+	std::deque<std::function<void()>> tasks;
+	std::vector<std::jthread> workers;
+
+	std::mutex importsMutex;
+	std::deque<std::shared_ptr<ModelImport>> requestedImports;	// in request order, committed in that order
+	std::unordered_map<std::string, std::shared_future<MeshModel*>> pendingModels;	// by path, render thread only
 
 public:
 	// prevents copying
@@ -27,6 +120,20 @@ public:
 		return instance;
 	}
 
+	/* Imports the model on the worker threads. The future is ready once Poll registered
+	the model's meshes and textures, call from the render thread only. */
+	std::shared_future<MeshModel*> LoadMeshModelAsync(const std::string& path, bool flipUV = false);
+
+	/* Turns finished imports into assets in the order they were requested, so asset ids
+	do not depend on which worker finished first. Call once a frame from the render thread. */
+	void Poll();
+
+	/* No model is waiting on the workers or on Poll. */
+	bool IsIdle() const { return pendingModels.empty(); }
+
+	/* Polls until the model is ready. */
+	MeshModel& Wait(const std::shared_future<MeshModel*>& model);
+
 	MeshModel& LoadMeshModelFromFile(const std::string& path, bool flipUV = false);
 	Texture& LoadTextureFromFile(const std::string& path, const uint8_t texType);
-};
\ No newline at end of file
+};
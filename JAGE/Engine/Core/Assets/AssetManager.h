@@ -5,7 +5,11 @@
 #include "Mesh.h"
 #include "MeshModel.h"
 #include "Texture.h"
+#include <Core/Utils.h>
+#include <Core/Log/Logging.h>
 
+/* Owns every asset. Besides the per type containers it keeps a guid index, so lookups by path
+are a hash away, and the dependency graph between assets (model -> meshes -> textures). */
 class AssetManager {
 public:
 	static AssetManager& Get() {
@@ -13,11 +17,33 @@ public:
 		return instance;
 	}
 
+	/* Stable across runs, subIndex tells apart the assets one file holds, like a model's meshes. */
+	static AssetGuid MakeGuid(const AssetType type, const std::string& path, const uint32_t subIndex = 0) {
+		uint64_t hash = Utils::HashBytes(path.data(), path.size());
+		const uint32_t key[2] = { static_cast<uint32_t>(type), subIndex };
+		return Utils::HashBytes(key, sizeof(key), hash);
+	}
+
+	/* Assets without a path get a guid that only holds for this run. */
 	template<typename T>
-	T& CreateAsset() {
+	T& CreateAsset(const std::string& path = "", const uint32_t subIndex = 0) {
 		auto& container = GetContainer<T>();
 		auto asset = std::make_unique<T>();
 		asset->assetId = nextId++;
+		asset->assetPath = path;
+		asset->assetGuid = path.empty()
+			? MakeGuid(T::assetType, path, static_cast<uint32_t>(asset->assetId))
+			: MakeGuid(T::assetType, path, subIndex);
+
+		AssetRecord& record = records[asset->assetId];
+		record.type = T::assetType;
+		record.guid = asset->assetGuid;
+
+		// the first asset keeps the guid, lookups by path must not jump to a copy
+		const auto [guidIt, inserted] = guidToAsset.try_emplace(asset->assetGuid, asset->assetId);
+		if (!inserted)
+			LOG(LogAssetLoader, LOG_ERROR, std::format("Asset {} duplicates the guid of asset {} ({}, sub asset {}).", asset->assetId, guidIt->second, path, subIndex));
+
 		T& ref = *asset;
 		container[asset->assetId] = std::move(asset);
 		return ref;
@@ -31,14 +57,99 @@ public:
 	}
 
 	template<typename T>
-	T* GetAssetByPath(const std::string& path) {
-		auto& container = GetContainer<T>();
-		for (const auto& pair : container) {
-			if (pair.second->assetPath == path) {
-				return pair.second.get();
-			}
+	T* Resolve(const AssetHandle<T> handle) {
+		return GetAssetById<T>(handle.id);
+	}
+
+	template<typename T>
+	T* GetAssetByGuid(const AssetGuid guid) {
+		auto it = guidToAsset.find(guid);
+		return it != guidToAsset.end() ? GetAssetById<T>(it->second) : nullptr;
+	}
+
+	template<typename T>
+	T* GetAssetByPath(const std::string& path, const uint32_t subIndex = 0) {
+		return GetAssetByGuid<T>(MakeGuid(T::assetType, path, subIndex));
+	}
+
+	/* Guids of every asset of the type, sorted, so the same set hashes the same. */
+	template<typename T>
+	std::vector<AssetGuid> GetAssetGuids() {
+		std::vector<AssetGuid> guids;
+		for (const auto& [id, asset] : GetContainer<T>())
+			guids.push_back(asset->assetGuid);
+
+		std::sort(guids.begin(), guids.end());
+		return guids;
+	}
+
+	/* asset uses dependency, which then outlives it. */
+	void AddDependency(const Asset asset, const Asset dependency) {
+		auto assetIt = records.find(asset);
+		auto dependencyIt = records.find(dependency);
+		if (assetIt == records.end() || dependencyIt == records.end() || asset == dependency)
+			return;
+
+		std::vector<Asset>& dependencies = assetIt->second.dependencies;
+		if (std::find(dependencies.begin(), dependencies.end(), dependency) != dependencies.end())
+			return;
+
+		dependencies.push_back(dependency);
+		dependencyIt->second.dependents.push_back(asset);
+	}
+
+	const std::vector<Asset>& GetDependencies(const Asset asset) const {
+		auto it = records.find(asset);
+		return it != records.end() ? it->second.dependencies : noAssets;
+	}
+
+	const std::vector<Asset>& GetDependents(const Asset asset) const {
+		auto it = records.find(asset);
+		return it != records.end() ? it->second.dependents : noAssets;
+	}
+
+	/* The asset and everything it uses, each after all of its own dependencies. */
+	std::vector<Asset> GetLoadOrder(const Asset asset) const {
+		std::vector<Asset> order;
+		std::unordered_set<Asset> visited;
+		AppendLoadOrder(asset, visited, order);
+		return order;
+	}
+
+	/* Destroys the asset unless something still uses it, then every dependency nothing else uses.
+	GPU copies stay with the renderer, so only unload what no entity draws or collides with.
+	Returns false when the asset is still in use or does not exist. */
+	bool UnloadAsset(const Asset asset) {
+		auto it = records.find(asset);
+		if (it == records.end() || !it->second.dependents.empty())
+			return false;
+
+		const AssetRecord record = std::move(it->second);
+		records.erase(it);
+
+		auto guidIt = guidToAsset.find(record.guid);
+		if (guidIt != guidToAsset.end() && guidIt->second == asset)
+			guidToAsset.erase(guidIt);
+
+		switch (record.type) {
+		case AssetType::Mesh: meshes.erase(asset); break;
+		case AssetType::MeshModel: meshModels.erase(asset); break;
+		case AssetType::Material: materials.erase(asset); break;
+		case AssetType::Texture: textures.erase(asset); break;
 		}
-		return nullptr;
+
+		for (const Asset dependency : record.dependencies) {
+			auto dependencyIt = records.find(dependency);
+			if (dependencyIt == records.end())
+				continue;
+
+			std::vector<Asset>& dependents = dependencyIt->second.dependents;
+			dependents.erase(std::remove(dependents.begin(), dependents.end(), asset), dependents.end());
+			if (dependents.empty())
+				UnloadAsset(dependency);
+		}
+
+		return true;
 	}
 
 private:
@@ -46,14 +157,26 @@ private:
 	AssetManager(const AssetManager&) = delete;
 	AssetManager& operator=(const AssetManager&) = delete;
 
+	struct AssetRecord {
+		AssetType type = AssetType::Mesh;
+		AssetGuid guid = 0;
+		std::vector<Asset> dependencies;	// assets this one uses
+		std::vector<Asset> dependents;		// assets using this one
+	};
+
+	void AppendLoadOrder(const Asset asset, std::unordered_set<Asset>& visited, std::vector<Asset>& order) const {
+		if (!visited.insert(asset).second)
+			return;
+
+		for (const Asset dependency : GetDependencies(asset))
+			AppendLoadOrder(dependency, visited, order);
+
+		order.push_back(asset);
+	}
+
 	template<typename T>
 	std::unordered_map<Asset, std::unique_ptr<T>>& GetContainer();
 
-	template<> std::unordered_map<Asset, std::unique_ptr<Mesh>>& GetContainer<Mesh>() { return meshes; }
-	template<> std::unordered_map<Asset, std::unique_ptr<MeshModel>>& GetContainer<MeshModel>() { return meshModels; }
-	template<> std::unordered_map<Asset, std::unique_ptr<Material>>& GetContainer<Material>() { return materials; }
-	template<> std::unordered_map<Asset, std::unique_ptr<Texture>>& GetContainer<Texture>() { return textures; }
-
 	Asset nextId = 0;
 
 	std::unordered_map<Asset, std::unique_ptr<Mesh>> meshes;
@@ -61,6 +184,13 @@ private:
 	std::unordered_map<Asset, std::unique_ptr<Material>> materials;
 	std::unordered_map<Asset, std::unique_ptr<Texture>> textures;
 
-
+	std::unordered_map<Asset, AssetRecord> records;
+	std::unordered_map<AssetGuid, Asset> guidToAsset;
+	inline static const std::vector<Asset> noAssets;
 };
 
+// specialized at namespace scope, in-class explicit specializations only build with MSVC
+template<> inline std::unordered_map<Asset, std::unique_ptr<Mesh>>& AssetManager::GetContainer<Mesh>() { return meshes; }
+template<> inline std::unordered_map<Asset, std::unique_ptr<MeshModel>>& AssetManager::GetContainer<MeshModel>() { return meshModels; }
+template<> inline std::unordered_map<Asset, std::unique_ptr<Material>>& AssetManager::GetContainer<Material>() { return materials; }
+template<> inline std::unordered_map<Asset, std::unique_ptr<Texture>>& AssetManager::GetContainer<Texture>() { return textures; }
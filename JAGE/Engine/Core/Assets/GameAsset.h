@@ -2,13 +2,35 @@
 
 #include "Common.h"
 
+using AssetGuid = uint64_t;
+
+enum class AssetType : uint8_t {
+	Mesh,
+	MeshModel,
+	Material,
+	Texture
+};
+
+/* An asset id that only resolves to assets of type T. */
+template<typename T>
+struct AssetHandle {
+	Asset id = -1;
+
+	AssetHandle() = default;
+	explicit AssetHandle(const Asset id) : id(id) {};
+
+	bool IsValid() const { return id >= 0; }
+	bool operator==(const AssetHandle&) const = default;
+};
+
 struct GameAsset {
 public:
 	Asset assetId = -1;
+	AssetGuid assetGuid = 0;	// same across runs for assets loaded from a path
 	std::string assetName;
 	std::string assetPath;
 
 	GameAsset() = default;
 	GameAsset(const std::string& assetName) : assetName(assetName) {};
 	GameAsset(const Asset id) : assetId(id) {};
-};
\ No newline at end of file
+};
@@ -4,13 +4,15 @@
 #include "GameAsset.h"
 
 struct Material : public GameAsset {
+	static constexpr AssetType assetType = AssetType::Material;
+
 	glm::vec3 mBaseColor = glm::vec3(1.0f);
 	float mBaseSpecular = 0.5f;
 
-	Asset diffuseTexture = -1;
-	Asset specularTexture = -1;
-	Asset roughnessTexture = -1;
-	Asset normalTexture = -1;
+	AssetHandle<Texture> diffuseTexture;
+	AssetHandle<Texture> specularTexture;
+	AssetHandle<Texture> roughnessTexture;
+	AssetHandle<Texture> normalTexture;
 
 	Material() = default;
 	Material(const std::string& assetName) : GameAsset(assetName) {};
@@ -1,6 +1,11 @@
 #pragma once
 
 #include "GameAsset.h"
+#include <span>
+
+#define MESH_MAX_LODS 4
+
+struct Texture;
 
 struct Vertex {
 	Vertex() = default;
@@ -9,7 +14,43 @@ struct Vertex {
 	glm::vec2 TexCoords = glm::vec2(0.0f);
 };
 
+/* Vertex layout of the mesh VBO when opengl.mesh.compact_vertices is set, 20 bytes instead of
+32. The normal is signed 10:10:10:2 and the uvs are half floats, both normalized by the
+attribute format so the vertex shaders read the same vec3 and vec2 as with Vertex. Built on
+the import workers and kept in the mesh cache, so the GPU upload needs no conversion. */
+struct PackedVertex {
+	glm::vec3 position = glm::vec3(0.0f);
+	uint32_t normal = 0;
+	uint32_t texCoords = 0;
+
+	PackedVertex() = default;
+	PackedVertex(const Vertex& vertex) : position(vertex.Position), texCoords(glm::packHalf2x16(vertex.TexCoords)) {
+		const glm::vec3 n = glm::clamp(vertex.Normal, glm::vec3(-1.0f), glm::vec3(1.0f));
+		normal = (static_cast<uint32_t>(static_cast<int32_t>(std::round(n.x * 511.0f)) & 0x3FF))
+			   | (static_cast<uint32_t>(static_cast<int32_t>(std::round(n.y * 511.0f)) & 0x3FF) << 10)
+			   | (static_cast<uint32_t>(static_cast<int32_t>(std::round(n.z * 511.0f)) & 0x3FF) << 20);
+	}
+};
+
+/* A coarser index list over the same vertices, error is relative to the bounds radius. */
+struct MeshLod {
+	std::vector<uint32_t> indices;
+	float error = 0.0f;
+};
+
+/* Vertex and index ranges of a mesh, in the asset's own arrays or in a mapped cache. */
+struct MeshData {
+	std::span<const Vertex> vertices;
+	std::span<const PackedVertex> packedVertices;	// same vertices in the GPU layout, empty unless compact vertices are on
+	std::span<const uint32_t> indices;
+	std::array<std::span<const uint32_t>, MESH_MAX_LODS - 1> lodIndices;
+	std::array<float, MESH_MAX_LODS - 1> lodErrors{};
+	uint32_t lodCount = 0;			// levels in lodIndices, lod 1 and up
+};
+
 struct Mesh : public GameAsset {
+	static constexpr AssetType assetType = AssetType::Mesh;
+
 	GLuint glID = 0;				// open gl id when buffered
 	bool mGPU = false;				// is this asset data on the GPU
 
@@ -17,13 +58,41 @@ struct Mesh : public GameAsset {
 	uint32_t mGlBaseInstance = 0;
 
 	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
+	std::vector<uint32_t> indices;	// full detail, lod 0
+	std::vector<MeshLod> lods;		// lod 1 and up, coarsest last
+
+	AssetHandle<Texture> diffuseTexture;
+	AssetHandle<Texture> specularTexture;
+	AssetHandle<Texture> normalTexture;
 
-	Asset diffuseTexture = -1;
-	Asset specularTexture = -1;
-	Asset normalTexture = -1;
+	Vec3 boundsMin{ 0.0f };			// local space AABB, set at import
+	Vec3 boundsMax{ 0.0f };
 
 	Mesh() = default;
 	Mesh(const std::string& assetName) : GameAsset(assetName) {};
 	Mesh(const Asset id) : GameAsset(id) {};
+
+	MeshData GetData() const {
+		MeshData data;
+		data.vertices = vertices;
+		data.indices = indices;
+		data.lodCount = static_cast<uint32_t>(std::min<size_t>(lods.size(), MESH_MAX_LODS - 1));
+		for (uint32_t lod = 0; lod < data.lodCount; lod++) {
+			data.lodIndices[lod] = lods[lod].indices;
+			data.lodErrors[lod] = lods[lod].error;
+		}
+
+		return data;
+	}
+
+	void ComputeBounds() {
+		if (vertices.empty())
+			return;
+
+		boundsMin = boundsMax = vertices[0].Position;
+		for (const Vertex& vertex : vertices) {
+			boundsMin = glm::min(boundsMin, vertex.Position);
+			boundsMax = glm::max(boundsMax, vertex.Position);
+		}
+	}
 };
@@ -0,0 +1,270 @@
+#include "MeshCache.h"
+#include <Core/Utils.h>
+#include <filesystem>
+#include <cstring>
+
+namespace {
+	constexpr uint32_t MESH_CACHE_MAGIC = 0x48534D4A;	// "JMSH"
+	constexpr size_t MESH_CACHE_ALIGNMENT = 16;
+
+	struct MeshCacheHeader {
+		uint32_t magic = MESH_CACHE_MAGIC;
+		uint32_t version = MESH_CACHE_VERSION;
+		uint32_t textureCount = 0;
+		uint32_t meshCount = 0;
+	};
+
+	/* Followed by pathLength characters, padded to 4 bytes. */
+	struct MeshCacheTextureRecord {
+		uint32_t type = 0;
+		uint32_t pathLength = 0;
+	};
+
+	struct MeshCacheMeshRecord {
+		uint64_t vertexOffset = 0;	// from the start of the file
+		uint64_t packedVertexOffset = 0;	// PackedVertex copies of the vertices, none when packedVertexCount is 0
+		uint64_t indexOffset = 0;	// lod 0 then every lod, back to back
+		uint32_t vertexCount = 0;
+		uint32_t packedVertexCount = 0;
+		uint32_t indexCount = 0;
+		uint32_t lodCount = 0;
+		uint32_t lodIndexCounts[MESH_MAX_LODS - 1] = {};
+		float lodErrors[MESH_MAX_LODS - 1] = {};
+		int32_t diffuseTexture = -1;
+		int32_t specularTexture = -1;
+		int32_t normalTexture = -1;
+		float boundsMin[3] = {};
+		float boundsMax[3] = {};
+	};
+
+	static_assert(std::is_trivially_copyable_v<Vertex> && sizeof(Vertex) == 32, "Vertex is stored as is, bump MESH_CACHE_VERSION when it changes.");
+	static_assert(std::is_trivially_copyable_v<PackedVertex> && sizeof(PackedVertex) == 20, "PackedVertex is stored as is, bump MESH_CACHE_VERSION when it changes.");
+
+	size_t AlignUp(const size_t offset, const size_t alignment) {
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	bool IsTextureIndexValid(const int32_t index, const uint32_t textureCount) {
+		return index >= -1 && index < static_cast<int32_t>(textureCount);
+	}
+
+	/* Checks that a range lies within the file without overflowing on corrupt offsets. */
+	bool IsRangeValid(const uint64_t offset, const uint64_t bytes, const size_t fileSize) {
+		return offset <= fileSize && bytes <= fileSize - offset;
+	}
+
+	bool AreIndicesValid(const std::span<const uint32_t> indices, const uint32_t vertexCount) {
+		return std::all_of(indices.begin(), indices.end(), [vertexCount](const uint32_t index) { return index < vertexCount; });
+	}
+
+	/* Folds in the write times of the material files next to the source. Scenes such as .obj keep
+	their materials, and so the texture each mesh uses, in sidecar files that Assimp reads by name. */
+	uint64_t HashMaterialSidecars(const std::string& sourcePath, uint64_t hash) {
+		std::error_code error;
+		std::filesystem::path directory = std::filesystem::path(sourcePath).parent_path();
+		if (directory.empty())
+			directory = ".";
+
+		std::vector<std::filesystem::path> sidecars;
+		for (auto it = std::filesystem::directory_iterator(directory, error); !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+			if (it->path().extension() == ".mtl")
+				sidecars.push_back(it->path());
+		}
+		std::sort(sidecars.begin(), sidecars.end());
+
+		for (const auto& sidecar : sidecars) {
+			const auto writeTime = std::filesystem::last_write_time(sidecar, error);
+			const int64_t ticks = error ? 0 : writeTime.time_since_epoch().count();
+			const std::string name = sidecar.filename().string();
+			hash = Utils::HashBytes(name.data(), name.size(), hash);
+			hash = Utils::HashBytes(&ticks, sizeof(ticks), hash);
+		}
+
+		return hash;
+	}
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath, const uint64_t optionsHash) {
+	std::error_code error;
+	const auto writeTime = std::filesystem::last_write_time(sourcePath, error);
+	if (error)
+		return "";
+
+	const int64_t ticks = writeTime.time_since_epoch().count();
+	uint64_t hash = Utils::HashBytes(sourcePath.data(), sourcePath.size());
+	hash = Utils::HashBytes(&ticks, sizeof(ticks), hash);
+	hash = Utils::HashBytes(&optionsHash, sizeof(optionsHash), hash);
+	hash = HashMaterialSidecars(sourcePath, hash);
+	return std::format("{}{:016x}_v{}.jmsh", MESH_CACHE_DIR, hash, MESH_CACHE_VERSION);
+}
+
+bool MeshCache::Read(const MappedFile& file, std::vector<MeshCacheTexture>& textures, std::vector<MeshCacheEntry>& meshes) {
+	const uint8_t* data = file.GetData();
+	const size_t fileSize = file.GetSize();
+	if (!file.IsOpen() || fileSize < sizeof(MeshCacheHeader))
+		return false;
+
+	MeshCacheHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION)
+		return false;
+
+	size_t offset = sizeof(header);
+	textures.resize(header.textureCount);
+	for (MeshCacheTexture& texture : textures) {
+		MeshCacheTextureRecord record;
+		if (!IsRangeValid(offset, sizeof(record), fileSize))
+			return false;
+		std::memcpy(&record, data + offset, sizeof(record));
+		offset += sizeof(record);
+
+		if (!IsRangeValid(offset, record.pathLength, fileSize))
+			return false;
+		texture.path.assign(reinterpret_cast<const char*>(data + offset), record.pathLength);
+		texture.type = static_cast<TextureAssetType>(record.type);
+		offset = AlignUp(offset + record.pathLength, 4);
+	}
+
+	meshes.resize(header.meshCount);
+	for (MeshCacheEntry& mesh : meshes) {
+		MeshCacheMeshRecord record;
+		if (!IsRangeValid(offset, sizeof(record), fileSize))
+			return false;
+		std::memcpy(&record, data + offset, sizeof(record));
+		offset += sizeof(record);
+
+		uint64_t lodIndexCount = 0;
+		if (record.lodCount > MESH_MAX_LODS - 1)
+			return false;
+		for (uint32_t lod = 0; lod < record.lodCount; lod++)
+			lodIndexCount += record.lodIndexCounts[lod];
+
+		// the counts are 32 bit, so their byte sizes cannot overflow 64 bits
+		const uint64_t vertexBytes = static_cast<uint64_t>(record.vertexCount) * sizeof(Vertex);
+		const uint64_t packedVertexBytes = static_cast<uint64_t>(record.packedVertexCount) * sizeof(PackedVertex);
+		const uint64_t indexBytes = (record.indexCount + lodIndexCount) * sizeof(uint32_t);
+		if (record.vertexOffset % MESH_CACHE_ALIGNMENT != 0 || record.indexOffset % MESH_CACHE_ALIGNMENT != 0 ||
+			!IsRangeValid(record.vertexOffset, vertexBytes, fileSize) || !IsRangeValid(record.indexOffset, indexBytes, fileSize) ||
+			(record.packedVertexCount != 0 && record.packedVertexCount != record.vertexCount) ||
+			record.packedVertexOffset % MESH_CACHE_ALIGNMENT != 0 || !IsRangeValid(record.packedVertexOffset, packedVertexBytes, fileSize) ||
+			!IsTextureIndexValid(record.diffuseTexture, header.textureCount) ||
+			!IsTextureIndexValid(record.specularTexture, header.textureCount) ||
+			!IsTextureIndexValid(record.normalTexture, header.textureCount))
+			return false;
+
+		// the mapping is page aligned and the ranges are aligned within it
+		const Vertex* vertices = reinterpret_cast<const Vertex*>(data + record.vertexOffset);
+		const uint32_t* indices = reinterpret_cast<const uint32_t*>(data + record.indexOffset);
+
+		mesh.data.vertices = std::span<const Vertex>(vertices, record.vertexCount);
+		mesh.data.packedVertices = std::span<const PackedVertex>(reinterpret_cast<const PackedVertex*>(data + record.packedVertexOffset), record.packedVertexCount);
+		mesh.data.indices = std::span<const uint32_t>(indices, record.indexCount);
+		mesh.data.lodCount = record.lodCount;
+		indices += record.indexCount;
+		for (uint32_t lod = 0; lod < record.lodCount; lod++) {
+			mesh.data.lodIndices[lod] = std::span<const uint32_t>(indices, record.lodIndexCounts[lod]);
+			mesh.data.lodErrors[lod] = record.lodErrors[lod];
+			indices += record.lodIndexCounts[lod];
+
+			if (!AreIndicesValid(mesh.data.lodIndices[lod], record.vertexCount))
+				return false;
+		}
+
+		// an index past the vertices would read out of the vertex buffer on the GPU and in physics
+		if (!AreIndicesValid(mesh.data.indices, record.vertexCount))
+			return false;
+
+		mesh.boundsMin = Vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]);
+		mesh.boundsMax = Vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]);
+		mesh.diffuseTexture = record.diffuseTexture;
+		mesh.specularTexture = record.specularTexture;
+		mesh.normalTexture = record.normalTexture;
+	}
+
+	return true;
+}
+
+bool MeshCache::Write(const std::string& path, const std::vector<MeshCacheTexture>& textures, const std::vector<MeshCacheEntry>& meshes) {
+	try {
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+	}
+	catch (const std::filesystem::filesystem_error&) {
+		return false;
+	}
+
+	// the tables go first, so every range's offset is known before any data is written
+	size_t offset = sizeof(MeshCacheHeader);
+	for (const MeshCacheTexture& texture : textures)
+		offset = AlignUp(offset + sizeof(MeshCacheTextureRecord) + texture.path.size(), 4);
+	offset += meshes.size() * sizeof(MeshCacheMeshRecord);
+
+	std::vector<MeshCacheMeshRecord> records(meshes.size());
+	for (size_t i = 0; i < meshes.size(); i++) {
+		const MeshCacheEntry& mesh = meshes[i];
+		MeshCacheMeshRecord& record = records[i];
+
+		record.vertexCount = static_cast<uint32_t>(mesh.data.vertices.size());
+		record.packedVertexCount = static_cast<uint32_t>(mesh.data.packedVertices.size());
+		record.indexCount = static_cast<uint32_t>(mesh.data.indices.size());
+		record.lodCount = mesh.data.lodCount;
+		size_t indexCount = mesh.data.indices.size();
+		for (uint32_t lod = 0; lod < mesh.data.lodCount; lod++) {
+			record.lodIndexCounts[lod] = static_cast<uint32_t>(mesh.data.lodIndices[lod].size());
+			record.lodErrors[lod] = mesh.data.lodErrors[lod];
+			indexCount += mesh.data.lodIndices[lod].size();
+		}
+
+		record.diffuseTexture = mesh.diffuseTexture;
+		record.specularTexture = mesh.specularTexture;
+		record.normalTexture = mesh.normalTexture;
+		for (int axis = 0; axis < 3; axis++) {
+			record.boundsMin[axis] = mesh.boundsMin[axis];
+			record.boundsMax[axis] = mesh.boundsMax[axis];
+		}
+
+		record.vertexOffset = AlignUp(offset, MESH_CACHE_ALIGNMENT);
+		record.packedVertexOffset = AlignUp(record.vertexOffset + record.vertexCount * sizeof(Vertex), MESH_CACHE_ALIGNMENT);
+		record.indexOffset = AlignUp(record.packedVertexOffset + record.packedVertexCount * sizeof(PackedVertex), MESH_CACHE_ALIGNMENT);
+		offset = record.indexOffset + indexCount * sizeof(uint32_t);
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	const char padding[MESH_CACHE_ALIGNMENT] = {};
+	auto padTo = [&file, &padding](const size_t target) {
+		const size_t position = static_cast<size_t>(file.tellp());
+		file.write(padding, target - position);
+	};
+
+	MeshCacheHeader header;
+	header.textureCount = static_cast<uint32_t>(textures.size());
+	header.meshCount = static_cast<uint32_t>(meshes.size());
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	for (const MeshCacheTexture& texture : textures) {
+		MeshCacheTextureRecord record;
+		record.type = static_cast<uint32_t>(texture.type);
+		record.pathLength = static_cast<uint32_t>(texture.path.size());
+		file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+		file.write(texture.path.data(), texture.path.size());
+		padTo(AlignUp(static_cast<size_t>(file.tellp()), 4));
+	}
+
+	file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(MeshCacheMeshRecord));
+
+	for (size_t i = 0; i < meshes.size(); i++) {
+		const MeshData& data = meshes[i].data;
+		padTo(records[i].vertexOffset);
+		file.write(reinterpret_cast<const char*>(data.vertices.data()), data.vertices.size_bytes());
+		padTo(records[i].packedVertexOffset);
+		file.write(reinterpret_cast<const char*>(data.packedVertices.data()), data.packedVertices.size_bytes());
+		padTo(records[i].indexOffset);
+		file.write(reinterpret_cast<const char*>(data.indices.data()), data.indices.size_bytes());
+		for (uint32_t lod = 0; lod < data.lodCount; lod++)
+			file.write(reinterpret_cast<const char*>(data.lodIndices[lod].data()), data.lodIndices[lod].size_bytes());
+	}
+
+	return file.good();
+}
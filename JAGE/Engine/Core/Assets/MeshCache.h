@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Common.h>
+#include <Core/MappedFile.h>
+#include "Mesh.h"
+#include "Texture.h"
+
+#define MESH_CACHE_DIR "Cache/Meshes/"
+#define MESH_CACHE_VERSION 2
+
+struct MeshCacheTexture {
+	std::string path;
+	TextureAssetType type = TextureAssetType::Albedo;
+};
+
+/* One mesh of a cached model, its textures index the model's texture list. */
+struct MeshCacheEntry {
+	MeshData data;
+	Vec3 boundsMin{ 0.0f };
+	Vec3 boundsMax{ 0.0f };
+	int32_t diffuseTexture = -1;
+	int32_t specularTexture = -1;
+	int32_t normalTexture = -1;
+};
+
+/* Keeps imported models in the form they are uploaded in, so warm starts skip Assimp and the
+mesh processing. A cache holds the texture files the meshes use, then every mesh's vertices,
+indices and lods back to back, aligned so that a mapped file can be read in place. With compact
+vertices the meshes also keep their vertices in the GPU layout, uploaded straight from the mapping. */
+namespace MeshCache {
+	/* Keyed by the source path, its last write time and a hash of the import options.
+	Empty when the source file does not exist. */
+	std::string GetCachePath(const std::string& sourcePath, const uint64_t optionsHash);
+
+	/* Checks a mapped cache and points the entries' data into it, valid while the file stays mapped. */
+	bool Read(const MappedFile& file, std::vector<MeshCacheTexture>& textures, std::vector<MeshCacheEntry>& meshes);
+	bool Write(const std::string& path, const std::vector<MeshCacheTexture>& textures, const std::vector<MeshCacheEntry>& meshes);
+}
@@ -3,6 +3,8 @@
 #include "GameAsset.h"
 
 struct MeshModel : public GameAsset {
+	static constexpr AssetType assetType = AssetType::MeshModel;
+
 	std::vector<Asset> meshes;
 
 	MeshModel() = default;
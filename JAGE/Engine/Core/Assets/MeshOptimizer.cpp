@@ -0,0 +1,229 @@
+#include "MeshOptimizer.h"
+
+namespace {
+	/* Triangles around every vertex, one entry per corner. */
+	struct TriangleAdjacency {
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		TriangleAdjacency(const std::vector<uint32_t>& indices, const size_t vertexCount)
+			: offsets(vertexCount + 1, 0), triangles(indices.size()) {
+			for (const uint32_t index : indices)
+				offsets[index + 1]++;
+			for (size_t v = 0; v < vertexCount; v++)
+				offsets[v + 1] += offsets[v];
+
+			std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	};
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, const size_t vertexCount, const uint32_t cacheSize) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	const TriangleAdjacency adjacency(indices, vertexCount);
+
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+	// time a vertex entered the cache, it is cached while less than cacheSize vertices came after it
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	uint32_t time = cacheSize + 1;
+	size_t cursor = 0;
+	int64_t fan = 0;
+
+	while (fan >= 0) {
+		candidates.clear();
+
+		// emit every remaining triangle around the fanning vertex
+		for (uint32_t a = adjacency.offsets[fan]; a < adjacency.offsets[fan + 1]; a++) {
+			const uint32_t triangle = adjacency.triangles[a];
+			if (emitted[triangle])
+				continue;
+
+			for (uint32_t c = 0; c < 3; c++) {
+				const uint32_t v = indices[triangle * 3 + c];
+				result.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+			emitted[triangle] = 1;
+		}
+
+		// next fan: the candidate with live triangles that stays cached longest, if its fan still fits
+		fan = -1;
+		int64_t bestPriority = -1;
+		for (const uint32_t v : candidates) {
+			if (liveTriangles[v] == 0)
+				continue;
+
+			int64_t priority = 0;
+			if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+				priority = time - cacheTime[v];
+
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				fan = v;
+			}
+		}
+
+		if (fan >= 0)
+			continue;
+
+		// dead end, go back to a recently used vertex or on to the next one in input order
+		while (!deadEnds.empty() && fan < 0) {
+			const uint32_t v = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[v] > 0)
+				fan = v;
+		}
+
+		for (; cursor < vertexCount && fan < 0; cursor++) {
+			if (liveTriangles[cursor] > 0)
+				fan = static_cast<int64_t>(cursor);
+		}
+	}
+
+	indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const uint32_t cacheSize, const float threshold) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+		return;
+
+	const float meshAcmr = AnalyzeVertexCache(indices, vertices.size(), cacheSize).acmr;
+
+	// cut wherever a cluster started with a cold cache has already caught up with the whole mesh
+	std::vector<uint32_t> clusterStarts = { 0 };
+	{
+		std::vector<uint32_t> cacheTime(vertices.size(), 0);
+		uint32_t time = cacheSize + 1;
+		uint32_t clusterMisses = 0;
+		uint32_t clusterTriangles = 0;
+
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (uint32_t c = 0; c < 3; c++) {
+				const uint32_t v = indices[t * 3 + c];
+				if (time - cacheTime[v] > cacheSize) {
+					cacheTime[v] = time++;
+					clusterMisses++;
+				}
+			}
+			clusterTriangles++;
+
+			if (t + 1 < triangleCount && clusterMisses <= clusterTriangles * meshAcmr * threshold) {
+				clusterStarts.push_back(static_cast<uint32_t>(t + 1));
+				clusterMisses = 0;
+				clusterTriangles = 0;
+				time += cacheSize + 1;
+			}
+		}
+	}
+	clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+	const size_t clusterCount = clusterStarts.size() - 1;
+	if (clusterCount < 2)
+		return;
+
+	// area weighted centroid and normal of every cluster and of the whole mesh
+	std::vector<Vec3> clusterCentroids(clusterCount, Vec3(0.0f));
+	std::vector<Vec3> clusterNormals(clusterCount, Vec3(0.0f));
+	Vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+		float clusterArea = 0.0f;
+		for (uint32_t t = clusterStarts[cluster]; t < clusterStarts[cluster + 1]; t++) {
+			const Vec3& p0 = vertices[indices[t * 3]].Position;
+			const Vec3& p1 = vertices[indices[t * 3 + 1]].Position;
+			const Vec3& p2 = vertices[indices[t * 3 + 2]].Position;
+			const Vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const float area = glm::length(normal);
+
+			clusterCentroids[cluster] += (p0 + p1 + p2) * (area / 3.0f);
+			clusterNormals[cluster] += normal;
+			clusterArea += area;
+		}
+
+		meshCentroid += clusterCentroids[cluster];
+		meshArea += clusterArea;
+		clusterCentroids[cluster] = clusterArea > 0.0f ? clusterCentroids[cluster] / clusterArea : Vec3(0.0f);
+	}
+	meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : Vec3(0.0f);
+
+	std::vector<std::pair<float, uint32_t>> order(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+		const float length = glm::length(clusterNormals[cluster]);
+		const Vec3 normal = length > 0.0f ? clusterNormals[cluster] / length : Vec3(0.0f);
+		order[cluster] = { -glm::dot(clusterCentroids[cluster] - meshCentroid, normal), static_cast<uint32_t>(cluster) };
+	}
+	std::stable_sort(order.begin(), order.end(), [](const auto& l, const auto& r) { return l.first < r.first; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (const auto& [key, cluster] : order)
+		result.insert(result.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+
+	indices.swap(result);
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<Vertex> result;
+	result.reserve(vertices.size());
+
+	for (uint32_t& index : indices) {
+		if (remap[index] == UINT32_MAX) {
+			remap[index] = static_cast<uint32_t>(result.size());
+			result.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(result);
+	return remap;
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, const size_t vertexCount, const uint32_t cacheSize) {
+	VertexCacheStats stats;
+	if (indices.size() < 3)
+		return stats;
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<uint8_t> referenced(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	uint32_t misses = 0;
+	uint32_t uniqueVertices = 0;
+
+	for (const uint32_t v : indices) {
+		if (time - cacheTime[v] > cacheSize) {
+			cacheTime[v] = time++;
+			misses++;
+		}
+
+		if (!referenced[v]) {
+			referenced[v] = 1;
+			uniqueVertices++;
+		}
+	}
+
+	stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+	return stats;
+}
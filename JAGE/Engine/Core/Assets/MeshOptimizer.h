@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Common.h>
+#include "Mesh.h"
+
+/* Average cache miss ratio per triangle and per referenced vertex of a FIFO
+post-transform cache. ACMR is 0.5 at best on large grids and 3 at worst, ATVR is 1 at best. */
+struct VertexCacheStats {
+	float acmr = 0.0f;
+	float atvr = 0.0f;
+};
+
+namespace MeshOptimizer {
+	/* Reorders triangles for a FIFO post-transform cache of cacheSize entries (Tipsify).
+	Triangles keep their winding. */
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, const size_t vertexCount, const uint32_t cacheSize);
+
+	/* Splits cache ordered triangles into clusters where restarting the cache costs at most
+	threshold times the mesh ACMR, then draws the clusters facing away from the mesh center
+	first so that they tend to occlude the rest. Run after OptimizeVertexCache. */
+	void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const uint32_t cacheSize, const float threshold);
+
+	/* Moves vertices into the order the indices first use them and drops unused ones.
+	Returns the new index of every old vertex, UINT32_MAX for the dropped ones. */
+	std::vector<uint32_t> OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, const size_t vertexCount, const uint32_t cacheSize);
+}
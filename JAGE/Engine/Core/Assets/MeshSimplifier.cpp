@@ -0,0 +1,266 @@
+#include "MeshSimplifier.h"
+#include <Core/Utils.h>
+#include <numeric>
+
+namespace {
+	/* Sum of squared distances to a set of planes, weighted by triangle area. */
+	struct Quadric {
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+		double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+		double a22 = 0.0, a23 = 0.0;
+		double a33 = 0.0;
+		double weight = 0.0;
+
+		void AddPlane(const glm::dvec3& n, const double d, const double w) {
+			a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+			a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+			a22 += w * n.z * n.z; a23 += w * n.z * d;
+			a33 += w * d * d;
+			weight += w;
+		}
+
+		void Add(const Quadric& q) {
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+			a11 += q.a11; a12 += q.a12; a13 += q.a13;
+			a22 += q.a22; a23 += q.a23;
+			a33 += q.a33;
+			weight += q.weight;
+		}
+
+		/* Mean squared distance of p to the planes. */
+		double Error(const glm::dvec3& p) const {
+			const double e = a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x
+						   + a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y
+						   + a22 * p.z * p.z + 2.0 * a23 * p.z
+						   + a33;
+			return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+		}
+	};
+
+	struct Collapse {
+		uint32_t from;		// position being removed
+		uint32_t to;		// position it merges into
+		double cost;
+	};
+
+	uint64_t EdgeKey(const uint32_t a, const uint32_t b) {
+		return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+	}
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const std::vector<Vertex>& vertices,
+											   const std::vector<uint32_t>& indices,
+											   const size_t targetIndexCount,
+											   const float maxError,
+											   float* resultError) {
+	std::vector<uint32_t> result = indices;
+	if (resultError)
+		*resultError = 0.0f;
+	if (vertices.empty() || indices.size() < 3 || result.size() <= targetIndexCount)
+		return result;
+
+	// vertices sharing a position are split by their attributes, collapses work on positions
+	const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+	std::vector<uint32_t> positionOf(vertexCount);
+	std::vector<uint32_t> wedgeCount;
+	std::vector<glm::dvec3> positions;
+	{
+		std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			const glm::vec3& p = vertices[v].Position;
+			const uint64_t hash = Utils::HashBytes(&p, sizeof(p));
+			std::vector<uint32_t>& bucket = buckets[hash];
+
+			uint32_t position = UINT32_MAX;
+			for (const uint32_t candidate : bucket) {
+				if (vertices[candidate].Position == p) {
+					position = positionOf[candidate];
+					break;
+				}
+			}
+
+			if (position == UINT32_MAX) {
+				position = static_cast<uint32_t>(positions.size());
+				positions.push_back(glm::dvec3(p));
+				wedgeCount.push_back(0);
+				bucket.push_back(v);
+			}
+
+			positionOf[v] = position;
+			wedgeCount[position]++;
+		}
+	}
+	const uint32_t positionCount = static_cast<uint32_t>(positions.size());
+
+	glm::dvec3 boundsMin = positions[0], boundsMax = positions[0];
+	for (const glm::dvec3& p : positions) {
+		boundsMin = glm::min(boundsMin, p);
+		boundsMax = glm::max(boundsMax, p);
+	}
+	const double radius = std::max(glm::length(boundsMax - boundsMin) * 0.5, 1e-12);
+	const double maxCost = (static_cast<double>(maxError) * radius) * (static_cast<double>(maxError) * radius);
+
+	// seams and open or non-manifold edges stay in place, other positions may merge into them
+	std::vector<uint8_t> locked(positionCount, 0);
+	{
+		std::unordered_map<uint64_t, uint32_t> edgeUses;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (uint32_t e = 0; e < 3; e++)
+				edgeUses[EdgeKey(positionOf[result[i + e]], positionOf[result[i + (e + 1) % 3]])]++;
+		}
+
+		for (const auto& [key, uses] : edgeUses) {
+			if (uses != 2) {
+				locked[key >> 32] = 1;
+				locked[key & 0xFFFFFFFFu] = 1;
+			}
+		}
+
+		for (uint32_t p = 0; p < positionCount; p++) {
+			if (wedgeCount[p] > 1)
+				locked[p] = 1;
+		}
+	}
+
+	std::vector<Quadric> quadrics(positionCount);
+	for (size_t i = 0; i < result.size(); i += 3) {
+		const glm::dvec3& p0 = positions[positionOf[result[i]]];
+		const glm::dvec3& p1 = positions[positionOf[result[i + 1]]];
+		const glm::dvec3& p2 = positions[positionOf[result[i + 2]]];
+		const glm::dvec3 cross = glm::cross(p1 - p0, p2 - p0);
+		const double length = glm::length(cross);
+		if (length <= 0.0)
+			continue;
+
+		const glm::dvec3 normal = cross / length;
+		const double d = -glm::dot(normal, p0);
+		for (uint32_t c = 0; c < 3; c++)
+			quadrics[positionOf[result[i + c]]].AddPlane(normal, d, length * 0.5);
+	}
+
+	std::vector<uint32_t> collapseTo(vertexCount);
+	std::vector<uint8_t> touched(positionCount);
+	std::vector<uint32_t> triangleOffsets(positionCount + 1);
+	std::vector<uint32_t> triangleLists;
+	std::vector<Collapse> collapses;
+	double worstCost = 0.0;
+
+	while (result.size() > targetIndexCount) {
+		const size_t triangleCount = result.size() / 3;
+
+		// triangles around every position
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (const uint32_t index : result)
+			triangleOffsets[positionOf[index] + 1]++;
+		for (uint32_t p = 0; p < positionCount; p++)
+			triangleOffsets[p + 1] += triangleOffsets[p];
+		triangleLists.resize(result.size());
+		{
+			std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++)
+				triangleLists[cursor[positionOf[result[i]]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (uint32_t e = 0; e < 3; e++) {
+				const uint32_t a = positionOf[result[i + e]];
+				const uint32_t b = positionOf[result[i + (e + 1) % 3]];
+				if (!locked[a])
+					collapses.push_back({ a, b, quadrics[a].Error(positions[b]) });
+				if (!locked[b])
+					collapses.push_back({ b, a, quadrics[b].Error(positions[a]) });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.cost < r.cost; });
+
+		// each collapse removes about two triangles, stop a pass early so the costs stay fresh
+		const size_t collapseGoal = std::max<size_t>(1, (triangleCount - targetIndexCount / 3) / 2);
+		size_t collapseCount = 0;
+
+		std::iota(collapseTo.begin(), collapseTo.end(), 0u);
+		std::fill(touched.begin(), touched.end(), 0);
+
+		for (const Collapse& collapse : collapses) {
+			if (collapseCount >= collapseGoal || collapse.cost > maxCost)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			// the surviving corner of a triangle on the edge holds the attributes to use
+			uint32_t target = UINT32_MAX;
+			bool flips = false;
+			const glm::dvec3& destination = positions[collapse.to];
+			for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !flips; t++) {
+				const uint32_t* corners = &result[triangleLists[t] * 3];
+				uint32_t fromCorner = 0;
+				bool onEdge = false;
+				for (uint32_t c = 0; c < 3; c++) {
+					if (positionOf[corners[c]] == collapse.from)
+						fromCorner = c;
+					if (positionOf[corners[c]] == collapse.to) {
+						onEdge = true;
+						target = corners[c];
+					}
+				}
+
+				if (onEdge)
+					continue;
+
+				const glm::dvec3& p1 = positions[positionOf[corners[(fromCorner + 1) % 3]]];
+				const glm::dvec3& p2 = positions[positionOf[corners[(fromCorner + 2) % 3]]];
+				const glm::dvec3& p0 = positions[collapse.from];
+				const glm::dvec3 before = glm::cross(p1 - p0, p2 - p0);
+				const glm::dvec3 after = glm::cross(p1 - destination, p2 - destination);
+				// folding a triangle onto its side is as bad as flipping it
+				const double lengths = glm::length(before) * glm::length(after);
+				flips = lengths <= 0.0 || glm::dot(before, after) < 0.25 * lengths;
+			}
+
+			if (flips || target == UINT32_MAX)
+				continue;
+
+			// the neighbourhood changes, later collapses in this pass must not rely on it
+			for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++) {
+				for (uint32_t c = 0; c < 3; c++)
+					touched[positionOf[result[triangleLists[t] * 3 + c]]] = 1;
+			}
+
+			for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++) {
+				for (uint32_t c = 0; c < 3; c++) {
+					const uint32_t index = result[triangleLists[t] * 3 + c];
+					if (positionOf[index] == collapse.from)
+						collapseTo[index] = target;
+				}
+			}
+
+			quadrics[collapse.to].Add(quadrics[collapse.from]);
+			worstCost = std::max(worstCost, collapse.cost);
+			collapseCount++;
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		// remap the corners and drop the triangles that lost an edge
+		size_t written = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			const uint32_t a = collapseTo[result[i]];
+			const uint32_t b = collapseTo[result[i + 1]];
+			const uint32_t c = collapseTo[result[i + 2]];
+			if (positionOf[a] == positionOf[b] || positionOf[b] == positionOf[c] || positionOf[a] == positionOf[c])
+				continue;
+
+			result[written++] = a;
+			result[written++] = b;
+			result[written++] = c;
+		}
+		result.resize(written);
+	}
+
+	if (resultError)
+		*resultError = static_cast<float>(std::sqrt(worstCost) / radius);
+
+	return result;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Common.h>
+#include "Mesh.h"
+
+namespace MeshSimplifier {
+	/* Collapses edges of a triangle list, cheapest quadric error first, until the index count
+	drops to targetIndexCount or the next collapse would move the surface further than
+	maxError. Vertices are only merged into their neighbours, never moved or added, so the
+	result indexes the same vertex buffer. Open borders and attribute seams are kept.
+	Errors are relative to the radius of the mesh bounds. */
+	std::vector<uint32_t> Simplify(const std::vector<Vertex>& vertices,
+								   const std::vector<uint32_t>& indices,
+								   const size_t targetIndexCount,
+								   const float maxError,
+								   float* resultError = nullptr);
+}
@@ -13,7 +13,17 @@ enum TextureAssetType : uint8_t {
 	Count
 };
 
+/* One level of a cooked texture, a range of Texture::compressedData. */
+struct TextureMip {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	size_t offset = 0;
+	size_t size = 0;
+};
+
 struct Texture : public GameAsset {
+	static constexpr AssetType assetType = AssetType::Texture;
+
 	GLuint glID = 0;
 	GLuint64 glHandle = 0;
 	GLint handleIndex = -1;
@@ -26,6 +36,11 @@ struct Texture : public GameAsset {
 	uint32_t height = 0;
 	uint32_t nrChannels = 0;
 
+	GLenum compressedFormat = 0;			// block format of the cooked mips, 0 when data holds raw pixels
+	std::vector<uint8_t> compressedData;	// every mip, largest first
+	std::vector<TextureMip> mips;
+	std::string cookedPath;					// cache the renderer streams the mips from, empty when they are uploaded at registration
+
 	Texture() = default;
 	Texture(const std::string& assetName) : GameAsset(assetName) {};
 	Texture(const Asset id) : GameAsset(id) {};
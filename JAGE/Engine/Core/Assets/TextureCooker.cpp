@@ -0,0 +1,494 @@
+#include "TextureCooker.h"
+#include <Core/Utils.h>
+#include <stb/stb_image.h>
+#include <filesystem>
+#include <cfloat>
+#include <cstring>
+
+namespace {
+	constexpr uint32_t TEXTURE_CACHE_MAGIC = 0x5845544A;	// "JTEX"
+
+	struct TextureCacheHeader {
+		uint32_t magic = TEXTURE_CACHE_MAGIC;
+		uint32_t version = TEXTURE_CACHE_VERSION;
+		uint32_t format = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipCount = 0;
+		uint32_t hasAlpha = 0;
+		uint32_t padding = 0;
+	};
+
+	/* Little endian bit stream over one block. */
+	struct BlockWriter {
+		uint8_t* block;
+		uint32_t bit = 0;
+
+		void Write(uint32_t value, const uint32_t bits) {
+			for (uint32_t i = 0; i < bits; i++, bit++, value >>= 1)
+				block[bit >> 3] |= static_cast<uint8_t>((value & 1u) << (bit & 7));
+		}
+	};
+
+	float SrgbToLinear(const float c) {
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(const float c) {
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	uint32_t Distance(const uint8_t* a, const uint8_t* b, const uint32_t channels) {
+		uint32_t d = 0;
+		for (uint32_t c = 0; c < channels; c++)
+			d += (static_cast<int32_t>(a[c]) - b[c]) * (static_cast<int32_t>(a[c]) - b[c]);
+		return d;
+	}
+
+	/* End points of the principal axis through the pixels, in the first channels of each. */
+	void FitEndpoints(const uint8_t pixels[16][4], const uint32_t channels, float lo[4], float hi[4]) {
+		float mean[4] = {};
+		for (uint32_t i = 0; i < 16; i++)
+			for (uint32_t c = 0; c < channels; c++)
+				mean[c] += pixels[i][c] / 16.0f;
+
+		float covariance[4][4] = {};
+		for (uint32_t i = 0; i < 16; i++)
+			for (uint32_t a = 0; a < channels; a++)
+				for (uint32_t b = 0; b < channels; b++)
+					covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+
+		float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		for (uint32_t iteration = 0; iteration < 8; iteration++) {
+			float next[4] = {};
+			float length = 0.0f;
+			for (uint32_t a = 0; a < channels; a++) {
+				for (uint32_t b = 0; b < channels; b++)
+					next[a] += covariance[a][b] * axis[b];
+				length = std::max(length, std::abs(next[a]));
+			}
+
+			if (length <= 0.0f)
+				break;
+			for (uint32_t c = 0; c < channels; c++)
+				axis[c] = next[c] / length;
+		}
+
+		float tMin = FLT_MAX, tMax = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; i++) {
+			float t = 0.0f;
+			for (uint32_t c = 0; c < channels; c++)
+				t += (pixels[i][c] - mean[c]) * axis[c];
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+
+		float axisLengthSq = 0.0f;
+		for (uint32_t c = 0; c < channels; c++)
+			axisLengthSq += axis[c] * axis[c];
+		if (axisLengthSq > 0.0f) {
+			tMin /= axisLengthSq;
+			tMax /= axisLengthSq;
+		}
+
+		for (uint32_t c = 0; c < channels; c++) {
+			lo[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+			hi[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+		}
+	}
+
+	uint16_t PackRgb565(const float color[3]) {
+		const uint32_t r = static_cast<uint32_t>(std::round(color[0] * 31.0f / 255.0f));
+		const uint32_t g = static_cast<uint32_t>(std::round(color[1] * 63.0f / 255.0f));
+		const uint32_t b = static_cast<uint32_t>(std::round(color[2] * 31.0f / 255.0f));
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRgb565(const uint16_t packed, uint8_t color[4]) {
+		const uint32_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+		color[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+		color[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+		color[3] = 255;
+	}
+
+	/* Four color BC1 block, also the color half of BC3. */
+	void EncodeBC1(const uint8_t pixels[16][4], uint8_t* block) {
+		float lo[4], hi[4];
+		FitEndpoints(pixels, 3, lo, hi);
+
+		uint16_t color0 = PackRgb565(hi);
+		uint16_t color1 = PackRgb565(lo);
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		uint8_t palette[4][4];
+		UnpackRgb565(color0, palette[0]);
+		UnpackRgb565(color1, palette[1]);
+		for (uint32_t c = 0; c < 3; c++) {
+			palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+			palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+		}
+
+		// equal end points decode in three color mode, where index 0 is still color0
+		uint32_t indices = 0;
+		if (color0 != color1) {
+			for (uint32_t i = 0; i < 16; i++) {
+				uint32_t best = 0, bestDistance = UINT32_MAX;
+				for (uint32_t p = 0; p < 4; p++) {
+					const uint32_t d = Distance(pixels[i], palette[p], 3);
+					if (d < bestDistance) {
+						bestDistance = d;
+						best = p;
+					}
+				}
+				indices |= best << (2 * i);
+			}
+		}
+
+		std::memcpy(block, &color0, 2);
+		std::memcpy(block + 2, &color1, 2);
+		std::memcpy(block + 4, &indices, 4);
+	}
+
+	/* Eight value BC4 block over one channel, also the alpha half of BC3 and each half of BC5. */
+	void EncodeBC4(const uint8_t pixels[16][4], const uint32_t channel, uint8_t* block) {
+		uint8_t lo = 255, hi = 0;
+		for (uint32_t i = 0; i < 16; i++) {
+			lo = std::min(lo, pixels[i][channel]);
+			hi = std::max(hi, pixels[i][channel]);
+		}
+
+		uint8_t palette[8] = { hi, lo };
+		for (uint32_t p = 2; p < 8; p++)
+			palette[p] = static_cast<uint8_t>(((8 - p) * hi + (p - 1) * lo + 3) / 7);
+
+		std::memset(block, 0, 8);
+		block[0] = hi;
+		block[1] = lo;
+
+		BlockWriter writer{ block, 16 };
+		for (uint32_t i = 0; i < 16; i++) {
+			uint32_t best = 0, bestDistance = UINT32_MAX;
+			if (hi != lo) {
+				for (uint32_t p = 0; p < 8; p++) {
+					const uint32_t d = std::abs(static_cast<int32_t>(pixels[i][channel]) - palette[p]);
+					if (d < bestDistance) {
+						bestDistance = d;
+						best = p;
+					}
+				}
+			}
+			writer.Write(best, 3);
+		}
+	}
+
+	/* BC7 mode 6: one subset, rgba end points with 7 bits and a shared low bit each, 4 bit indices. */
+	void EncodeBC7(const uint8_t pixels[16][4], uint8_t* block) {
+		static constexpr uint32_t weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		float ends[2][4];
+		FitEndpoints(pixels, 4, ends[0], ends[1]);
+
+		// pick the low bit of each end point that loses the least
+		uint32_t quantized[2][4];
+		uint32_t pBits[2];
+		uint8_t endpoints[2][4];
+		for (uint32_t e = 0; e < 2; e++) {
+			float bestError = FLT_MAX;
+			for (uint32_t p = 0; p < 2; p++) {
+				float error = 0.0f;
+				uint32_t q[4];
+				for (uint32_t c = 0; c < 4; c++) {
+					q[c] = static_cast<uint32_t>(std::clamp(std::round((ends[e][c] - p) / 2.0f), 0.0f, 127.0f));
+					const float d = static_cast<float>((q[c] << 1) | p) - ends[e][c];
+					error += d * d;
+				}
+
+				if (error < bestError) {
+					bestError = error;
+					pBits[e] = p;
+					for (uint32_t c = 0; c < 4; c++) {
+						quantized[e][c] = q[c];
+						endpoints[e][c] = static_cast<uint8_t>((q[c] << 1) | p);
+					}
+				}
+			}
+		}
+
+		uint8_t palette[16][4];
+		for (uint32_t p = 0; p < 16; p++)
+			for (uint32_t c = 0; c < 4; c++)
+				palette[p][c] = static_cast<uint8_t>(((64 - weights[p]) * endpoints[0][c] + weights[p] * endpoints[1][c] + 32) >> 6);
+
+		uint32_t indices[16];
+		for (uint32_t i = 0; i < 16; i++) {
+			uint32_t bestDistance = UINT32_MAX;
+			for (uint32_t p = 0; p < 16; p++) {
+				const uint32_t d = Distance(pixels[i], palette[p], 4);
+				if (d < bestDistance) {
+					bestDistance = d;
+					indices[i] = p;
+				}
+			}
+		}
+
+		// the first index is stored without its top bit, swapping the end points clears it
+		if (indices[0] >= 8) {
+			std::swap(quantized[0], quantized[1]);
+			std::swap(pBits[0], pBits[1]);
+			for (uint32_t& index : indices)
+				index = 15 - index;
+		}
+
+		std::memset(block, 0, 16);
+		BlockWriter writer{ block };
+		writer.Write(1u << 6, 7);
+		for (uint32_t c = 0; c < 4; c++) {
+			writer.Write(quantized[0][c], 7);
+			writer.Write(quantized[1][c], 7);
+		}
+		writer.Write(pBits[0], 1);
+		writer.Write(pBits[1], 1);
+		writer.Write(indices[0], 3);
+		for (uint32_t i = 1; i < 16; i++)
+			writer.Write(indices[i], 4);
+	}
+
+	/* Half size level with a box filter, color averaged in linear space for sRGB textures. */
+	std::vector<uint8_t> Downsample(const std::vector<uint8_t>& source, const uint32_t width, const uint32_t height, const bool srgb) {
+		static const std::array<float, 256> toLinear = [] {
+			std::array<float, 256> table{};
+			for (uint32_t i = 0; i < 256; i++)
+				table[i] = SrgbToLinear(i / 255.0f);
+			return table;
+		}();
+
+		const uint32_t mipWidth = std::max(1u, width / 2);
+		const uint32_t mipHeight = std::max(1u, height / 2);
+		std::vector<uint8_t> result(static_cast<size_t>(mipWidth) * mipHeight * 4);
+
+		for (uint32_t y = 0; y < mipHeight; y++) {
+			for (uint32_t x = 0; x < mipWidth; x++) {
+				float sum[4] = {};
+				for (uint32_t s = 0; s < 4; s++) {
+					const uint32_t sx = std::min(x * 2 + (s & 1), width - 1);
+					const uint32_t sy = std::min(y * 2 + (s >> 1), height - 1);
+					const uint8_t* texel = &source[(static_cast<size_t>(sy) * width + sx) * 4];
+					for (uint32_t c = 0; c < 4; c++)
+						sum[c] += (srgb && c < 3) ? toLinear[texel[c]] : texel[c] / 255.0f;
+				}
+
+				uint8_t* out = &result[(static_cast<size_t>(y) * mipWidth + x) * 4];
+				for (uint32_t c = 0; c < 4; c++) {
+					const float value = (srgb && c < 3) ? LinearToSrgb(sum[c] * 0.25f) : sum[c] * 0.25f;
+					out[c] = static_cast<uint8_t>(std::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f));
+				}
+			}
+		}
+
+		return result;
+	}
+}
+
+void TextureCooker::Cook(Texture& texture, const uint8_t* rgba, const bool useBC7) {
+	const bool srgb = texture.type == TextureAssetType::Albedo && !texture.inLinearSpace;
+	const size_t texelCount = static_cast<size_t>(texture.width) * texture.height;
+
+	texture.hasAlphaChannel = false;
+	if (texture.type == TextureAssetType::Albedo) {
+		for (size_t i = 0; i < texelCount && !texture.hasAlphaChannel; i++)
+			texture.hasAlphaChannel = rgba[i * 4 + 3] != 255;
+	}
+
+	uint32_t blockSize = 16;
+	if (texture.type == TextureAssetType::Albedo) {
+		if (useBC7)
+			texture.compressedFormat = srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+		else if (texture.hasAlphaChannel)
+			texture.compressedFormat = srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		else {
+			texture.compressedFormat = srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			blockSize = 8;
+		}
+	}
+	else if (texture.type == TextureAssetType::Normal) {
+		texture.compressedFormat = GL_COMPRESSED_RG_RGTC2;
+	}
+	else {
+		texture.compressedFormat = GL_COMPRESSED_RED_RGTC1;
+		blockSize = 8;
+	}
+
+	texture.compressedData.clear();
+	texture.mips.clear();
+
+	std::vector<uint8_t> level(rgba, rgba + texelCount * 4);
+	uint32_t width = texture.width;
+	uint32_t height = texture.height;
+	while (true) {
+		const uint32_t blocksX = (width + 3) / 4;
+		const uint32_t blocksY = (height + 3) / 4;
+
+		TextureMip mip;
+		mip.width = width;
+		mip.height = height;
+		mip.offset = texture.compressedData.size();
+		mip.size = static_cast<size_t>(blocksX) * blocksY * blockSize;
+		texture.compressedData.resize(mip.offset + mip.size);
+
+		for (uint32_t by = 0; by < blocksY; by++) {
+			for (uint32_t bx = 0; bx < blocksX; bx++) {
+				// blocks hanging over the edge repeat the last row and column
+				uint8_t pixels[16][4];
+				for (uint32_t i = 0; i < 16; i++) {
+					const uint32_t x = std::min(bx * 4 + (i & 3), width - 1);
+					const uint32_t y = std::min(by * 4 + (i >> 2), height - 1);
+					std::memcpy(pixels[i], &level[(static_cast<size_t>(y) * width + x) * 4], 4);
+				}
+
+				uint8_t* block = &texture.compressedData[mip.offset + (static_cast<size_t>(by) * blocksX + bx) * blockSize];
+				switch (texture.compressedFormat) {
+				case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+				case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+					EncodeBC1(pixels, block);
+					break;
+				case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+				case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+					EncodeBC4(pixels, 3, block);
+					EncodeBC1(pixels, block + 8);
+					break;
+				case GL_COMPRESSED_RGBA_BPTC_UNORM:
+				case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+					EncodeBC7(pixels, block);
+					break;
+				case GL_COMPRESSED_RG_RGTC2:
+					EncodeBC4(pixels, 0, block);
+					EncodeBC4(pixels, 1, block + 8);
+					break;
+				default:
+					EncodeBC4(pixels, 0, block);
+					break;
+				}
+			}
+		}
+
+		texture.mips.push_back(mip);
+		if (width == 1 && height == 1)
+			break;
+
+		level = Downsample(level, width, height, srgb);
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+	}
+}
+
+/* Keyed by the source file itself like the physics cache, editing a texture re-cooks it. */
+std::string TextureCooker::GetCachePath(const std::vector<uint8_t>& sourceFile, const TextureAssetType type, const bool useBC7) {
+	uint64_t hash = Utils::HashBytes(sourceFile.data(), sourceFile.size());
+	const uint8_t options[2] = { static_cast<uint8_t>(type), static_cast<uint8_t>(useBC7) };
+	hash = Utils::HashBytes(options, sizeof(options), hash);
+	return std::format("{}{:016x}_v{}.jtex", TEXTURE_CACHE_DIR, hash, TEXTURE_CACHE_VERSION);
+}
+
+namespace {
+	/* Reads the header and mip table and checks them against the file size, leaves the file at the first mip. */
+	bool ReadCacheTable(std::ifstream& file, Texture& texture) {
+		file.seekg(0, std::ios::end);
+		const size_t fileSize = static_cast<size_t>(file.tellg());
+		file.seekg(0);
+
+		TextureCacheHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+			header.magic != TEXTURE_CACHE_MAGIC || header.version != TEXTURE_CACHE_VERSION || header.mipCount == 0 || header.mipCount > 32)
+			return false;
+
+		std::vector<TextureMip> mips(header.mipCount);
+		if (!file.read(reinterpret_cast<char*>(mips.data()), mips.size() * sizeof(TextureMip)))
+			return false;
+
+		const size_t dataSize = mips.back().offset + mips.back().size;
+		if (sizeof(header) + mips.size() * sizeof(TextureMip) + dataSize != fileSize)
+			return false;
+
+		texture.compressedFormat = header.format;
+		texture.width = header.width;
+		texture.height = header.height;
+		texture.hasAlphaChannel = header.hasAlpha != 0;
+		texture.mips = std::move(mips);
+		return true;
+	}
+}
+
+bool TextureCooker::ReadCache(const std::string& path, Texture& texture) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open() || !ReadCacheTable(file, texture))
+		return false;
+
+	const size_t dataSize = texture.mips.back().offset + texture.mips.back().size;
+	texture.compressedData.resize(dataSize);
+	return static_cast<bool>(file.read(reinterpret_cast<char*>(texture.compressedData.data()), dataSize));
+}
+
+bool TextureCooker::ReadCacheHeader(const std::string& path, Texture& texture) {
+	std::ifstream file(path, std::ios::binary);
+	return file.is_open() && ReadCacheTable(file, texture);
+}
+
+/* Levels are stored largest first, so a range of them is one contiguous read. */
+bool TextureCooker::ReadCacheLevels(const std::string& path, const Texture& texture, const uint32_t firstLevel, const uint32_t lastLevel, std::vector<uint8_t>& data) {
+	if (firstLevel > lastLevel || lastLevel >= texture.mips.size())
+		return false;
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	const size_t tableSize = sizeof(TextureCacheHeader) + texture.mips.size() * sizeof(TextureMip);
+	const size_t begin = texture.mips[firstLevel].offset;
+	const size_t end = texture.mips[lastLevel].offset + texture.mips[lastLevel].size;
+
+	data.resize(end - begin);
+	file.seekg(static_cast<std::streamoff>(tableSize + begin));
+	return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), data.size()));
+}
+
+bool TextureCooker::CookSource(const std::vector<uint8_t>& sourceFile, Texture& texture, const bool useBC7) {
+	int width, height, nrChannels;
+	unsigned char* rgba = stbi_load_from_memory(sourceFile.data(), static_cast<int>(sourceFile.size()), &width, &height, &nrChannels, 4);
+	if (!rgba || width == 0) {
+		stbi_image_free(rgba);
+		return false;
+	}
+
+	texture.width = width;
+	texture.height = height;
+	Cook(texture, rgba, useBC7);
+	stbi_image_free(rgba);
+	return true;
+}
+
+bool TextureCooker::WriteCache(const std::string& path, const Texture& texture) {
+	try {
+		std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+	}
+	catch (const std::filesystem::filesystem_error&) {
+		return false;
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	TextureCacheHeader header;
+	header.format = texture.compressedFormat;
+	header.width = texture.width;
+	header.height = texture.height;
+	header.mipCount = static_cast<uint32_t>(texture.mips.size());
+	header.hasAlpha = texture.hasAlphaChannel ? 1 : 0;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(texture.mips.data()), texture.mips.size() * sizeof(TextureMip));
+	file.write(reinterpret_cast<const char*>(texture.compressedData.data()), texture.compressedData.size());
+	return file.good();
+}
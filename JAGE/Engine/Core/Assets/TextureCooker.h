@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Common.h>
+#include "Texture.h"
+
+#define TEXTURE_CACHE_DIR "Cache/Textures/"
+#define TEXTURE_CACHE_VERSION 1
+
+// S3TC is not core, every desktop driver exposes it through EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+/* Turns decoded images into block compressed mip chains and keeps them in a cache keyed by
+the source file's contents, so a texture is only decoded and compressed once.
+Albedo maps become BC1, or BC3 when some texel is not opaque, or BC7 for both when asked.
+Normal maps keep x and y in BC5 and single channel maps go to BC4. */
+namespace TextureCooker {
+	/* Fills compressedFormat, compressedData and mips of texture from width * height rgba8
+	pixels. Uses the texture's type, size and color space. */
+	void Cook(Texture& texture, const uint8_t* rgba, const bool useBC7);
+
+	/* Decodes an image file's contents and cooks it. Returns false when it can not be decoded. */
+	bool CookSource(const std::vector<uint8_t>& sourceFile, Texture& texture, const bool useBC7);
+
+	std::string GetCachePath(const std::vector<uint8_t>& sourceFile, const TextureAssetType type, const bool useBC7);
+	bool ReadCache(const std::string& path, Texture& texture);
+
+	/* Fills everything but compressedData, for textures that are streamed level by level. */
+	bool ReadCacheHeader(const std::string& path, Texture& texture);
+
+	/* Reads levels firstLevel to lastLevel of a texture filled by ReadCacheHeader into data. */
+	bool ReadCacheLevels(const std::string& path, const Texture& texture, const uint32_t firstLevel, const uint32_t lastLevel, std::vector<uint8_t>& data);
+	bool WriteCache(const std::string& path, const Texture& texture);
+}
@@ -1,7 +1,12 @@
 #pragma once
 
 #include <Core/Log/Logging.h>
+#include <Core/FileWatcher.h>
 #include <string>
+#include <vector>
+#include <memory>
+#include <variant>
+#include <functional>
 #include <iostream>
 #include <fstream>
 #include <inih/ini.h>
@@ -14,70 +19,127 @@ namespace cfg {
     constexpr const char* CFG_RENDERING_PATH = "Config/Rendering.ini";
     constexpr const char* CFG_INPUT_PATH = "Config/Input.ini";
 
+    using Value = std::variant<float, uint32_t, size_t, bool, std::string>;
+
+    class CfgBase;
+
+    /* Typed slot in a parsed config file. Reading it is an index into memory,
+    and it picks up new values whenever the file is reloaded. */
+    template <typename T>
+    class Handle {
+    public:
+        Handle() = default;
+        Handle(const CfgBase* cfg, const uint32_t index) : cfg(cfg), index(index) {};
+
+        const T& Get() const;
+
+    private:
+        const CfgBase* cfg = nullptr;
+        uint32_t index = 0;
+    };
+
+    /* Parses its file once and serves every read from memory. Reload() parses
+    it again, refreshes all handles and notifies subscribers. */
     class CfgBase {
     public:
         CfgBase(const std::string& fpath) : fpath(fpath) {};
 
         template <typename T>
-        T Read(const std::string& section, const std::string& key, const T deft) const;
-
-        template <>
-		float Read<float>(const std::string& section, const std::string& key, const float deft) const {
-            INIReader reader(fpath);
-            if (reader.ParseError() != 0) {
-                LOG(ConfigLog, LOG_CRITICAL, std::format("Failed to parse config file {}", fpath));
-            }
+        T Read(const std::string& section, const std::string& key, const T deft) const {
+            return Convert<T>(GetReader(), section, key, deft);
+        }
 
-            return reader.GetFloat(section, key, deft);
+        template <typename T>
+        Handle<T> GetHandle(const std::string& section, const std::string& key, const T deft) {
+            entries.push_back({ section, key, Value(deft), Value(Read<T>(section, key, deft)) });
+            return Handle<T>(this, static_cast<uint32_t>(entries.size() - 1));
         }
 
-        template <>
-        uint32_t Read<uint32_t>(const std::string& section, const std::string& key, const uint32_t deft) const {
-            INIReader reader(fpath);
-            if (reader.ParseError() != 0) {
-                LOG(ConfigLog, LOG_CRITICAL, std::format("Failed to parse config file {}", fpath));
-            }
+        template <typename T>
+        const T& GetValue(const uint32_t index) const {
+            return std::get<T>(entries[index].value);
+        }
 
-            return reader.GetInteger(section, key, deft);
+        uint32_t Subscribe(std::function<void()> callback) {
+            subscribers.push_back({ nextSubscriberId, std::move(callback) });
+            return nextSubscriberId++;
         }
 
-		template <>
-        size_t Read<size_t>(const std::string& section, const std::string& key, const size_t deft) const {
-			INIReader reader(fpath);
-			if (reader.ParseError() != 0) {
-				LOG(ConfigLog, LOG_CRITICAL, std::format("Failed to parse config file {}", fpath));
-			}
+        void Unsubscribe(const uint32_t id) {
+            std::erase_if(subscribers, [id](const auto& subscriber) { return subscriber.first == id; });
+        }
 
-			return static_cast<size_t>(reader.GetInteger(section, key, deft));
-		}
+        void Reload() {
+            Parse();
 
-        template <>
-        bool Read<bool>(const std::string& section, const std::string& key, const bool deft) const {
-            INIReader reader(fpath);
-            if (reader.ParseError() != 0) {
-                LOG(ConfigLog, LOG_CRITICAL, std::format("Failed to parse config file {}", fpath));
+            for (Entry& entry : entries) {
+                entry.value = std::visit([&](const auto& deft) -> Value {
+                    return Convert<std::decay_t<decltype(deft)>>(*reader, entry.section, entry.key, deft);
+                }, entry.deft);
             }
 
-            return reader.GetBoolean(section, key, deft);
+            LOG(ConfigLog, LOG_INFO, std::format("Reloaded config file {}", fpath));
+            for (const auto& [id, callback] : subscribers)
+                callback();
+        }
+
+        const std::string& GetPath() const { return fpath; }
+
+    private:
+        struct Entry {
+            std::string section;
+            std::string key;
+            Value deft;
+            Value value;
+        };
+
+        const INIReader& GetReader() const {
+            if (!reader)
+                Parse();
+
+            return *reader;
         }
 
-        template <>
-        std::string Read<std::string>(const std::string& section, const std::string& key, const std::string deft) const {
-            INIReader reader(fpath);
-            if (reader.ParseError() != 0) {
+        void Parse() const {
+            reader = std::make_unique<INIReader>(fpath);
+            if (reader->ParseError() != 0) {
                 LOG(ConfigLog, LOG_CRITICAL, std::format("Failed to parse config file {}", fpath));
             }
+        }
 
-            return reader.Get(section, key, deft);
+        template <typename T>
+        static T Convert(const INIReader& reader, const std::string& section, const std::string& key, const T deft) {
+            if constexpr (std::is_same_v<T, float>)
+                return reader.GetFloat(section, key, deft);
+            else if constexpr (std::is_same_v<T, bool>)
+                return reader.GetBoolean(section, key, deft);
+            else if constexpr (std::is_same_v<T, std::string>)
+                return reader.Get(section, key, deft);
+            else
+                return static_cast<T>(reader.GetInteger(section, key, static_cast<long>(deft)));
         }
 
-    private:
         std::string fpath;
+        mutable std::unique_ptr<INIReader> reader;		// parsed lazily on first read
+        std::vector<Entry> entries;
+        std::vector<std::pair<uint32_t, std::function<void()>>> subscribers;
+        uint32_t nextSubscriberId = 0;
     };
 
-    inline const CfgBase Engine(CFG_ENGINE_PATH);
-    inline const CfgBase Rendering(CFG_RENDERING_PATH);
-    inline const CfgBase Input(CFG_INPUT_PATH);
+    template <typename T>
+    const T& Handle<T>::Get() const {
+        return cfg->GetValue<T>(index);
+    }
 
-}
+    inline CfgBase Engine(CFG_ENGINE_PATH);
+    inline CfgBase Rendering(CFG_RENDERING_PATH);
+    inline CfgBase Input(CFG_INPUT_PATH);
+
+    /* Reloads the config files when they change on disk. Reloads run from FileWatcher::Poll. */
+    inline void WatchForChanges() {
+        FileWatcher::Get().Watch(CFG_ENGINE_PATH, []() { Engine.Reload(); });
+        FileWatcher::Get().Watch(CFG_RENDERING_PATH, []() { Rendering.Reload(); });
+        FileWatcher::Get().Watch(CFG_INPUT_PATH, []() { Input.Reload(); });
+    }
 
+}
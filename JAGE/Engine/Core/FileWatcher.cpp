@@ -0,0 +1,70 @@
+#include "FileWatcher.h"
+
+void FileWatcher::Start(const uint32_t intervalMs)
+{
+	if (thread.joinable())
+		return;
+
+	thread = std::jthread([this, intervalMs](std::stop_token stopToken) { Run(stopToken, intervalMs); });
+}
+
+void FileWatcher::Stop()
+{
+	if (!thread.joinable())
+		return;
+
+	thread.request_stop();
+	wakeUp.notify_all();
+	thread.join();
+}
+
+void FileWatcher::Watch(const std::string& path, std::function<void()> callback)
+{
+	std::error_code error;
+	const std::filesystem::file_time_type lastWriteTime = std::filesystem::last_write_time(path, error);
+
+	std::lock_guard<std::mutex> lock(filesMutex);
+	files.push_back({ path, lastWriteTime, std::move(callback) });
+}
+
+void FileWatcher::Poll()
+{
+	if (!anyChanged.exchange(false))
+		return;
+
+	std::vector<std::function<void()>> callbacks;
+	{
+		std::lock_guard<std::mutex> lock(filesMutex);
+		for (WatchedFile& file : files) {
+			if (file.changed) {
+				file.changed = false;
+				callbacks.push_back(file.callback);
+			}
+		}
+	}
+
+	// run outside the lock, callbacks are free to watch more files
+	for (const auto& callback : callbacks)
+		callback();
+}
+
+void FileWatcher::Run(std::stop_token stopToken, const uint32_t intervalMs)
+{
+	std::unique_lock<std::mutex> lock(filesMutex);
+	while (!stopToken.stop_requested()) {
+		wakeUp.wait_for(lock, stopToken, std::chrono::milliseconds(intervalMs), [] { return false; });
+		if (stopToken.stop_requested())
+			break;
+
+		for (WatchedFile& file : files) {
+			std::error_code error;
+			const std::filesystem::file_time_type lastWriteTime = std::filesystem::last_write_time(file.path, error);
+			if (error || lastWriteTime == file.lastWriteTime)
+				continue;
+
+			file.lastWriteTime = lastWriteTime;
+			file.changed = true;
+			anyChanged = true;
+		}
+	}
+}
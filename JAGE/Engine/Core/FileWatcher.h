@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <filesystem>
+#include <condition_variable>
+
+/* Polls file timestamps on a background thread. Callbacks for files that
+changed only run from Poll(), so they always execute on the calling thread. */
+class FileWatcher {
+public:
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	static FileWatcher& Get() {
+		static FileWatcher instance;
+		return instance;
+	}
+
+	void Start(const uint32_t intervalMs);
+	void Stop();
+	void Watch(const std::string& path, std::function<void()> callback);
+	void Poll();
+
+private:
+	FileWatcher() = default;
+	~FileWatcher() { Stop(); }
+
+	struct WatchedFile {
+		std::string path;
+		std::filesystem::file_time_type lastWriteTime;
+		std::function<void()> callback;
+		bool changed = false;
+	};
+
+	void Run(std::stop_token stopToken, const uint32_t intervalMs);
+
+	std::mutex filesMutex;
+	std::condition_variable_any wakeUp;
+	std::vector<WatchedFile> files;
+	std::atomic<bool> anyChanged = false;
+	std::jthread thread;
+};
@@ -0,0 +1,113 @@
+#include <thread>
+#include <cstring>
+#include <Core/Log/Logging.h>
+#include "Profiler.h"
+
+Profiler::ThreadZones& Profiler::GetThreadZones()
+{
+	thread_local std::shared_ptr<ThreadZones> threadZones;
+	if (!threadZones) {
+		threadZones = std::make_shared<ThreadZones>();
+		threadZones->threadId = std::hash<std::thread::id>{}(std::this_thread::get_id());
+		threadZones->zones.reserve(256);
+
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		threads.push_back(threadZones);
+	}
+
+	return *threadZones;
+}
+
+void Profiler::BeginFrame()
+{
+	frameStartNs = Now();
+
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (const auto& thread : threads) {
+		std::lock_guard<std::mutex> threadLock(thread->mutex);
+		thread->zones.clear();
+		thread->totals.clear();
+	}
+}
+
+void Profiler::EndFrame()
+{
+	const uint64_t frameEndNs = Now();
+	lastFrameTimeMs = static_cast<double>(frameEndNs - frameStartNs) / 1e6;
+	lastFrameZones.clear();
+	lastFrameTotals.clear();
+
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (const auto& thread : threads) {
+		std::lock_guard<std::mutex> threadLock(thread->mutex);
+
+		// totals stay exact even when the timeline is full
+		for (const auto& [category, ms] : thread->totals)
+			lastFrameTotals[category] += ms;
+
+		const size_t room = PROFILER_MAX_ZONES_PER_FRAME - lastFrameZones.size();
+		lastFrameZones.insert(lastFrameZones.end(), thread->zones.begin(), thread->zones.begin() + std::min(room, thread->zones.size()));
+		thread->zones.clear();
+		thread->totals.clear();
+	}
+
+	// threads that exited only hold what was just merged
+	threads.erase(std::remove_if(threads.begin(), threads.end(), [](const auto& thread) { return thread.use_count() == 1; }), threads.end());
+	frameIndex++;
+}
+
+uint64_t Profiler::Now() const
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+void Profiler::RecordZone(const char* name, const char* category, const uint64_t startNs, const uint64_t endNs)
+{
+	ThreadZones& thread = GetThreadZones();
+	const double ms = static_cast<double>(endNs - startNs) / 1e6;
+
+	std::lock_guard<std::mutex> lock(thread.mutex);
+	auto it = std::find_if(thread.totals.begin(), thread.totals.end(), [category](const auto& total) { return total.first == category; });
+	if (it != thread.totals.end())
+		it->second += ms;
+	else
+		thread.totals.emplace_back(category, ms);
+
+	if (thread.zones.size() < PROFILER_MAX_ZONES_PER_FRAME)
+		thread.zones.push_back({ name, category, startNs, endNs, thread.threadId });
+}
+
+double Profiler::GetCategoryTotalMs(const std::string& category) const
+{
+	auto it = lastFrameTotals.find(category);
+	return it != lastFrameTotals.end() ? it->second : 0.0;
+}
+
+/* Walks every thread of the frame in flight, meant for the odd query rather than every zone. */
+double Profiler::GetCurrentCategoryTotalMs(const std::string& category)
+{
+	double total = 0.0;
+
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (const auto& thread : threads) {
+		std::lock_guard<std::mutex> threadLock(thread->mutex);
+		for (const auto& [threadCategory, ms] : thread->totals) {
+			if (std::strcmp(threadCategory, category.c_str()) == 0)
+				total += ms;
+		}
+	}
+
+	return total;
+}
+
+void Profiler::LogFrameTotals() const
+{
+	std::vector<std::pair<std::string, double>> sorted(lastFrameTotals.begin(), lastFrameTotals.end());
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+	std::string summary = std::format("Frame {} took {:.3f} ms.", frameIndex, lastFrameTimeMs);
+	for (const auto& [category, ms] : sorted)
+		summary += std::format(" {}: {:.3f} ms.", category, ms);
+
+	LOG(LogProfiler, LOG_INFO, summary);
+}
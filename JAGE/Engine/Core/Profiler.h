@@ -0,0 +1,92 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <Common.h>
+
+constexpr const char* LogProfiler = "Profiler";
+
+/* Zones recorded past this count in a single frame are dropped. */
+#define PROFILER_MAX_ZONES_PER_FRAME 8192
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name, category) ScopedProfileZone PROFILER_CONCAT(profileZone, __LINE__)(name, category)
+
+/* Names and categories must outlive the frame (string literals or
+static strings such as the event names PhysX hands out). */
+struct ProfilerZone {
+	const char* name;
+	const char* category;
+	uint64_t startNs;
+	uint64_t endNs;
+	size_t threadId;
+};
+
+/* Frame based timeline. Zones can be recorded from any thread, each thread collects its own
+and EndFrame merges them, so the previous frame is kept around together with per-category totals. */
+class Profiler {
+public:
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	static Profiler& Get() {
+		static Profiler instance;
+		return instance;
+	}
+
+	void BeginFrame();
+	void EndFrame();
+
+	uint64_t Now() const;
+	void RecordZone(const char* name, const char* category, const uint64_t startNs, const uint64_t endNs);
+
+	double GetCategoryTotalMs(const std::string& category) const;
+	double GetCurrentCategoryTotalMs(const std::string& category);
+	void LogFrameTotals() const;
+
+	const std::vector<ProfilerZone>& GetFrameZones() const { return lastFrameZones; }
+	const std::unordered_map<std::string, double>& GetFrameTotals() const { return lastFrameTotals; }
+	double GetFrameTimeMs() const { return lastFrameTimeMs; }
+	uint64_t GetFrameIndex() const { return frameIndex; }
+
+private:
+	Profiler() = default;
+
+	/* Zones and totals of one thread, keyed by the category pointer so recording never allocates.
+	Its mutex is only contended while a frame is merged. */
+	struct ThreadZones {
+		std::mutex mutex;
+		size_t threadId = 0;
+		std::vector<ProfilerZone> zones;
+		std::vector<std::pair<const char*, double>> totals;	// category -> ms, few enough for a linear scan
+	};
+
+	ThreadZones& GetThreadZones();
+
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	std::mutex threadsMutex;
+	std::vector<std::shared_ptr<ThreadZones>> threads;	// a thread's own reference keeps it off the prune list
+
+	uint64_t frameIndex = 0;
+	uint64_t frameStartNs = 0;
+
+	double lastFrameTimeMs = 0.0;
+	std::vector<ProfilerZone> lastFrameZones;
+	std::unordered_map<std::string, double> lastFrameTotals;
+};
+
+class ScopedProfileZone {
+public:
+	ScopedProfileZone(const char* name, const char* category)
+		: name(name), category(category), startNs(Profiler::Get().Now()) {}
+
+	~ScopedProfileZone() {
+		Profiler::Get().RecordZone(name, category, startNs, Profiler::Get().Now());
+	}
+
+private:
+	const char* name;
+	const char* category;
+	uint64_t startNs;
+};
@@ -6,6 +6,7 @@
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <random>
+#include <string_view>
 #include <Common.h>
 
 namespace Utils {
@@ -22,6 +23,28 @@ namespace Utils {
 		return id;
 	}
 
+	/* FNV-1a over raw bytes. Pass a previous result as seed to chain buffers. */
+	inline static uint64_t HashBytes(const void* data, const size_t size, uint64_t seed = 14695981039346656037ull) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++) {
+			seed ^= bytes[i];
+			seed *= 1099511628211ull;
+		}
+
+		return seed;
+	}
+
+	/* 32-bit FNV-1a over a string, usable at compile time for name lookups. */
+	constexpr uint32_t HashString(const std::string_view str) {
+		uint32_t hash = 2166136261u;
+		for (const char c : str) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
 	inline static Vec3 RandomPointInSphere(const float radius, const Vec3& origin = Vec3(0.0f)) {
 		std::random_device rd;
 		std::mt19937 gen(rd());
@@ -6,7 +6,7 @@
 enum class ColliderType {
 	Cube,
 	Sphere,
-	Mesh,
+	Mesh,		// convex hull on rigid bodies, cooked triangle mesh on static colliders
 	COUNT
 };
 
@@ -19,7 +19,7 @@ struct Collider {
 	float height = 1.0f;
 	float depth = 1.0f;
 	std::vector<Vec3> vertices;
-	std::vector<Asset> meshes;
+	std::vector<Asset> meshes;		// static colliders fall back to the StaticMeshRenderer meshes when empty
 
 	Collider() = default;
 	Collider(ColliderType type) : type(type) {};
@@ -13,4 +13,5 @@ struct StaticMeshRenderer {
 	Mat4 inverseModelMatrix = Id4;
 	AABBRender aabb;
 	bool isInView = false;
+	bool isOccluder = false;	// rasterized into the CPU occlusion buffer
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <World/World.h>
+#include <Physics/Physics.h>
 #include "CharacterSystem.h"
 
 void CharacterSystem::Update(float dt) {
@@ -17,7 +18,8 @@ void CharacterSystem::Update(float dt) {
 		Camera& characterCamera = world.GetComponent<Camera>(character.camera);
 		Transform& characterCameraTransform = world.GetComponent<Transform>(character.camera);
 
-		float mouseSens = 10 * cfg::Input.Read<float>("Mouse", "input.mouse.sensitivity", 1.0f);
+		static const cfg::Handle<float> mouseSensitivity = cfg::Input.GetHandle<float>("Mouse", "input.mouse.sensitivity", 1.0f);
+		float mouseSens = 10 * mouseSensitivity.Get();
 		const Vec2 mouseDelta = mouseSens * Input::Get().GetMouseDelta();
 
 		if (mouseDelta.x) {
@@ -77,5 +79,8 @@ void CharacterSystem::FixedUpdate(float dt)
 
 	characterTransform.position += character.velocity * dt;
 	moveInput = Vec3(0.0f);
+
+	// the character anchors the streamed play area
+	Physics::UpdateBroadPhaseRegions(characterTransform.position);
 }
 ;
\ No newline at end of file
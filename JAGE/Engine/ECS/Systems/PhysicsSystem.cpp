@@ -1,21 +1,116 @@
 
 #include <ECS/Components/Transform.h>
 #include <ECS/Components/RigidBody.h>
+#include <ECS/Components/StaticMeshRenderer.h>
 #include <World/World.h>
 #include <Physics/Physics.h>
+#include <cstring>
 #include "PhysicsSystem.h"
 
+void PhysicsSystem::OnEntityAdded(const Entity entity) {
+	pendingEntities.push_back(entity);
+}
+
+/* Colliders without a rigid body are static world geometry, built once when the entity joins.
+The entity may have picked up a rigid body or left the system since then. */
+void PhysicsSystem::AddStaticBodies() {
+	World& world = World::Get();
+	Signature rigidBodySignature = world.MakeSignature<RigidBody>();
+	Signature staticMeshSignature = world.MakeSignature<StaticMeshRenderer>();
+
+	for (const Entity entity : pendingEntities) {
+		if (entities.find(entity) == entities.end())
+			continue;
+
+		Signature entitySignature = world.GetEntitySignature(entity);
+		if ((entitySignature & rigidBodySignature) == rigidBodySignature)
+			continue;
+
+		Collider& collider = world.GetComponent<Collider>(entity);
+		Transform& transform = world.GetComponent<Transform>(entity);
+
+		if ((entitySignature & staticMeshSignature) == staticMeshSignature)
+			Physics::AddStaticBody(entity, transform, collider, world.GetComponent<StaticMeshRenderer>(entity).meshes);
+		else
+			Physics::AddStaticBody(entity, transform, collider);
+	}
+
+	pendingEntities.clear();
+}
+
+uint64_t PhysicsSystem::GetLayoutHash() {
+	World& world = World::Get();
+	Signature colliderSignature = world.MakeSignature<Collider>();
+	Signature rigidBodySignature = world.MakeSignature<RigidBody>();
+	Signature staticMeshSignature = world.MakeSignature<StaticMeshRenderer>();
+
+	struct BodyLayout {
+		Entity entity = 0;
+		uint32_t isStatic = 0;
+		float position[3] = {};
+		float rotation[4] = {};
+		float scale[3] = {};
+		int32_t colliderType = -1;
+		float colliderSize[4] = {};
+	};
+
+	uint64_t hash = 0;
+	for (const Entity entity : entities) {
+		Signature entitySignature = world.GetEntitySignature(entity);
+		const Transform& transform = world.GetComponent<Transform>(entity);
+
+		BodyLayout layout;
+		layout.entity = entity;
+		layout.isStatic = (entitySignature & rigidBodySignature) != rigidBodySignature;
+		std::memcpy(layout.position, &transform.position, sizeof(layout.position));
+		std::memcpy(layout.rotation, &transform.rotation, sizeof(layout.rotation));
+		std::memcpy(layout.scale, &transform.scale, sizeof(layout.scale));
+
+		const std::vector<Asset>* meshes = nullptr;
+		if ((entitySignature & colliderSignature) == colliderSignature) {
+			const Collider& collider = world.GetComponent<Collider>(entity);
+			layout.colliderType = static_cast<int32_t>(collider.type);
+			layout.colliderSize[0] = collider.radius;
+			layout.colliderSize[1] = collider.width;
+			layout.colliderSize[2] = collider.height;
+			layout.colliderSize[3] = collider.depth;
+
+			meshes = &collider.meshes;
+			if (meshes->empty() && layout.isStatic && (entitySignature & staticMeshSignature) == staticMeshSignature)
+				meshes = &world.GetComponent<StaticMeshRenderer>(entity).meshes;
+		}
+
+		hash = Utils::HashBytes(&layout, sizeof(layout), hash);
+		if (meshes == nullptr)
+			continue;
+
+		// guids, asset ids depend on the order models finish loading in
+		for (const Asset meshId : *meshes) {
+			const Mesh* mesh = AssetManager::Get().GetAssetById<Mesh>(meshId);
+			const AssetGuid guid = mesh ? mesh->assetGuid : 0;
+			hash = Utils::HashBytes(&guid, sizeof(guid), hash);
+		}
+	}
+
+	return hash;
+}
+
 void PhysicsSystem::FixedUpdate(float dt) {
 	World& world = World::Get();
 	Signature colliderSignature = world.MakeSignature<Collider>();
+	Signature rigidBodySignature = world.MakeSignature<RigidBody>();
+
+	if (!pendingEntities.empty())
+		AddStaticBodies();
 
 	for (const Entity& entity : entities) {
+		Signature entitySignature = world.GetEntitySignature(entity);
+		if ((entitySignature & rigidBodySignature) != rigidBodySignature)
+			continue;
 
 		RigidBody& rigidBody = World::Get().GetComponent<RigidBody>(entity);
 		Transform& transform = World::Get().GetComponent<Transform>(entity);
 
-		Signature entitySignature = world.GetEntitySignature(entity);
-
 		if ((entitySignature & colliderSignature) == colliderSignature) {
 			Collider& collider = World::Get().GetComponent<Collider>(entity);
 			Physics::AddRigidBody(entity, rigidBody, transform, collider);
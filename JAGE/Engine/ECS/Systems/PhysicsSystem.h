@@ -10,4 +10,13 @@ public:
 	}
 
 	void FixedUpdate(float dt) override;
+	void OnEntityAdded(const Entity entity) override;
+
+	/* Hashes what the physics scene is built from: every entity's kind of body, transform and collider. */
+	uint64_t GetLayoutHash();
+
+private:
+	std::vector<Entity> pendingEntities;	// joined since the last step, static ones get their body then
+
+	void AddStaticBodies();
 };
\ No newline at end of file
@@ -58,7 +58,7 @@ void RenderSystem::HandleStaticMeshes(const Entity entity)
 	model = glm::scale(model, transform.scale);
 	smRenderer.modelMatrix = model;
 
-	renderAPI->UpsertMeshEntity(entity, &smRenderer, &transform);
+	renderAPI->UpsertMeshEntity(entity, &smRenderer);
 }
 
 void RenderSystem::HandleCameras(const Entity entity)
@@ -104,6 +104,7 @@ void RenderSystem::CallRenderPass()
 	renderAPI->LightingPass();
 	renderAPI->PostFxPass();
 	renderAPI->OutputToScreen(SceneTexture::ST_POST_FX);
+	renderAPI->EndFrame();
 }
 
 void RenderSystem::SetActiveCamera(const Entity camera) {
@@ -151,4 +152,9 @@ void RenderSystem::Update(float dt) {
 
 	OffloadToGPU();
 	CallRenderPass();
+}
+
+void RenderSystem::OnEntityRemoved(const Entity entity) {
+	if (renderAPI != nullptr)
+		renderAPI->RemoveMeshEntity(entity);
 }
\ No newline at end of file
@@ -24,4 +24,5 @@ public:
 	void CallRenderPass();
 
 	void Update(float dt) override;
+	void OnEntityRemoved(const Entity entity) override;
 };
\ No newline at end of file
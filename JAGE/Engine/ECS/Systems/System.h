@@ -39,13 +39,26 @@ public:
 	inline void Register(const Entity entity) {
 		auto [it, res] = entities.insert(entity);
 		entitiesChanged = res;
+
+		if (res)
+			OnEntityAdded(entity);
 	}
 
 	inline void UnRegister(const Entity entity) {
 		size_t erased = entities.erase(entity);
 		entitiesChanged = erased > 0;
+
+		if (erased > 0)
+			OnEntityRemoved(entity);
 	}
 
+	/* Called when an entity joins the system. Its other components may still be on their way,
+	so anything that reads them is better deferred to the next update. */
+	virtual void OnEntityAdded(const Entity entity) {};
+
+	/* Called when an entity leaves the system, either destroyed or no longer matching its signature. */
+	virtual void OnEntityRemoved(const Entity entity) {};
+
 	inline const size_t GetEntityCount() const { return entities.size(); }
 	inline const std::set<Entity>& GetEntities() const { return entities; }
 
@@ -1,6 +1,7 @@
 #include <World/World.h>
 #include <Renderer/OpenGlApi.h>
 #include <Core/Config.h>
+#include <Core/Profiler.h>
 #include <Physics/Physics.h>
 #include "Engine.h"
 
@@ -11,27 +12,51 @@ void Engine::Init() {
 	World&     world         = World::Get();
 	Input&     input         = Input::Get();
 	OpenGlApi& openglApi     = OpenGlApi::Get();
+	Profiler&  profiler      = Profiler::Get();
 
 	shouldExit = !windowManager.Initialize();
 	shouldExit = !openglApi.Initialize();
 	shouldExit = !input.Initialize();
 	shouldExit = !world.Initialize();
-	shouldExit = !Physics::Initialize();
+	shouldExit = !Physics::Initialize(world.GetPhysicsLayoutHash());
 
 	if (shouldExit) LOG(LogEngine, LOG_ERROR, "Something went wrong.");
 
+	if (cfg::Engine.Read<bool>("Config", "config.hot_reload", true)) {
+		cfg::WatchForChanges();
+		FileWatcher::Get().Start(cfg::Engine.Read<uint32_t>("Config", "config.watch_interval_ms", 500));
+	}
+
+	// frames between profiler summaries, 0 disables them
+	const cfg::Handle<uint32_t> profilerLogInterval = cfg::Engine.GetHandle<uint32_t>("Profiler", "profiler.log_interval", 0);
+
 	while (!shouldExit) {
 		frameTime = static_cast<float>(glfwGetTime());
 		float dt = frameTime - frameTimePrev;
 		frameTimePrev = frameTime;
 
+		profiler.BeginFrame();
+		FileWatcher::Get().Poll();
+		AssetLoader::Get().Poll();
 		windowManager.BeginFrame();
 
-		world.Update(dt);
+		{
+			PROFILE_SCOPE("World::Update", "World");
+			world.Update(dt);
+		}
+
+		// a scene cached while models are still loading would miss their bodies for good
+		if (AssetLoader::Get().IsIdle())
+			Physics::ExportPendingScene();
+
 		input.PollKeys();
 		input.PollMouse();
 
 		windowManager.EndFrame();
+		profiler.EndFrame();
+
+		if (profilerLogInterval.Get() > 0 && profiler.GetFrameIndex() % profilerLogInterval.Get() == 0)
+			profiler.LogFrameTotals();
 
 		shouldExit = windowManager.ShouldClose();
 	}
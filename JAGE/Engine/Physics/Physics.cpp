@@ -1,4 +1,10 @@
 #include <thread>
+#include <atomic>
+#include <filesystem>
+#include <cstring>
+#include <Core/Utils.h>
+#include <Core/Config.h>
+#include <physx/extensions/PxCollectionExt.h>
 #include "Physics.h"
 
 /* These callbacks are required by PhysX sdk. */
@@ -28,22 +34,104 @@ static PxFilterFlags contactReportFilterShader(PxFilterObjectAttributes attribut
 	return PxFilterFlags();
 }
 
-/* Global variables from physx. */
-#define PVD_HOST "127.0.0.1"
+/* Forwards to the default allocator and keeps a running count of the bytes
+PhysX holds, so benchmarks can report simulation memory. */
+class TrackingAllocator : public physx::PxAllocatorCallback
+{
+public:
+	void* allocate(size_t size, const char* typeName, const char* filename, int line)
+	{
+		// the header keeps the payload on the 16 byte alignment PhysX expects
+		uint8_t* ptr = static_cast<uint8_t*>(mAllocator.allocate(size + 16, typeName, filename, line));
+		if (ptr == nullptr)
+			return nullptr;
+
+		*reinterpret_cast<size_t*>(ptr) = size;
+		const size_t allocated = mAllocatedBytes.fetch_add(size) + size;
+		size_t peak = mPeakBytes.load();
+		while (allocated > peak && !mPeakBytes.compare_exchange_weak(peak, allocated));
+		return ptr + 16;
+	}
+
+	void deallocate(void* ptr)
+	{
+		if (ptr == nullptr)
+			return;
+
+		uint8_t* base = static_cast<uint8_t*>(ptr) - 16;
+		mAllocatedBytes.fetch_sub(*reinterpret_cast<size_t*>(base));
+		mAllocator.deallocate(base);
+	}
+
+	size_t GetAllocatedBytes() const { return mAllocatedBytes.load(); }
+	size_t GetPeakBytes() const { return mPeakBytes.load(); }
+	void ResetPeak() { mPeakBytes.store(mAllocatedBytes.load()); }
+
+private:
+	PxDefaultAllocator mAllocator;
+	std::atomic<size_t> mAllocatedBytes = 0;
+	std::atomic<size_t> mPeakBytes = 0;
+};
 
+/* Global variables from physx. */
 PxFoundation* gFoundation;
 PxPvd* gPvd;
+PxPvdTransport* gPvdTransport;
+ProfilerCallback gProfilerCallback;
 ContactReportCallback gContactReportCallback;
+BroadPhaseCallback gBroadPhaseCallback;
 UserErrorCallback gErrorCallback;
-PxDefaultAllocator gAllocator;
+TrackingAllocator gAllocator;
 PxPhysics* gPhysics;
 PxScene* gScene;
 PxMaterial* gDefaultMaterial;
 PxRigidStatic* gGroundPlaneDebug;
 PxDefaultCpuDispatcher* gCpuDispatcher;
+PxSerializationRegistry* gSerializationRegistry;
+
+/* Deserialized objects live inside the block they were loaded from, so the
+blocks are kept for as long as the objects can be referenced. */
+struct SerializedBlockDeleter {
+	void operator()(uint8_t* block) const { ::operator delete[](block, std::align_val_t(PX_SERIAL_FILE_ALIGN)); }
+};
+std::vector<std::unique_ptr<uint8_t[], SerializedBlockDeleter>> gSerializedBlocks;
+std::string gPendingSceneExportPath;
+uint64_t gSceneLayoutHash = 0;
+
+/* Precedes the PhysX collection in the scene cache, padded so that the collection stays aligned. */
+struct SceneCacheHeader {
+	uint32_t magic = 0x4E43534A;	// "JSCN"
+	uint32_t version = PHYSICS_SCENE_CACHE_VERSION;
+	uint64_t contentHash = 0;
+};
+static_assert(sizeof(SceneCacheHeader) <= PX_SERIAL_FILE_ALIGN);
+
+/* Actors are keyed by entity, with the kind in the high bits. Cooked meshes are keyed by their
+mesh's guid, salted per kind, so a cache still maps to the right meshes when asset ids shift. */
+enum class SerialIdKind : uint64_t {
+	Actor = 1,							// entity
+	ConvexShape = 0x9E3779B97F4A7C15,	// mesh guid of an mShapes entry
+	TriangleMesh = 0xC2B2AE3D27D4EB4F,	// mesh guid of an mTriangleMeshes entry
+};
+
+static PxSerialObjectId MakeSerialId(const SerialIdKind kind, const int32_t value)
+{
+	return (static_cast<uint64_t>(kind) << 32) | static_cast<uint32_t>(value);
+}
+
+static PxSerialObjectId MakeMeshSerialId(const SerialIdKind kind, const AssetGuid guid)
+{
+	return static_cast<uint64_t>(kind) ^ guid;
+}
 
-bool Physics::Initialize()
+static AssetGuid GetMeshSerialGuid(const SerialIdKind kind, const PxSerialObjectId id)
 {
+	return static_cast<uint64_t>(kind) ^ id;
+}
+
+bool Physics::Initialize(const uint64_t sceneLayoutHash)
+{
+	gSceneLayoutHash = sceneLayoutHash;
 	gFoundation = PxCreateFoundation(PX_PHYSICS_VERSION, gAllocator,
 		gErrorCallback);
 	if (!gFoundation) {
@@ -51,26 +139,51 @@ bool Physics::Initialize()
 		return false;
 	}
 
-	gPvd = PxCreatePvd(*gFoundation);
-	PxPvdTransport* transport = PxDefaultPvdSocketTransportCreate(PVD_HOST, 5425, 10);
-	gPvd->connect(*transport, PxPvdInstrumentationFlag::eALL);
+	/* PVD is opt-in. Profiling goes through our own callback instead, so the
+	connection only carries debug and memory data. */
+	if (cfg::Engine.Read<bool>("Physics", "physics.pvd.enabled", false)) {
+		const std::string transportName = cfg::Engine.Read<std::string>("Physics", "physics.pvd.transport", "socket");
+		if (transportName == "file") {
+			const std::string pvdFile = cfg::Engine.Read<std::string>("Physics", "physics.pvd.file", "Logs/physics.pxd2");
+			std::filesystem::path pvdDir = std::filesystem::path(pvdFile).parent_path();
+			if (!pvdDir.empty())
+				std::filesystem::create_directories(pvdDir);
+			gPvdTransport = PxDefaultPvdFileTransportCreate(pvdFile.c_str());
+		}
+		else {
+			const std::string pvdHost = cfg::Engine.Read<std::string>("Physics", "physics.pvd.host", "127.0.0.1");
+			const uint32_t pvdPort = cfg::Engine.Read<uint32_t>("Physics", "physics.pvd.port", 5425);
+			gPvdTransport = PxDefaultPvdSocketTransportCreate(pvdHost.c_str(), static_cast<int>(pvdPort), 10);
+		}
+
+		gPvd = PxCreatePvd(*gFoundation);
+		if (!gPvdTransport || !gPvd->connect(*gPvdTransport, PxPvdInstrumentationFlag::eDEBUG | PxPvdInstrumentationFlag::eMEMORY))
+			LOG(LogPhysics, LOG_WARNING, std::format("Could not connect PVD using the {} transport.", transportName));
+	}
+
+	if (cfg::Engine.Read<bool>("Physics", "physics.profiler.enabled", true))
+		PxSetProfilerCallback(&gProfilerCallback);
 
 	gPhysics = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale(), true, gPvd);
 	gDefaultMaterial = gPhysics->createMaterial(0.5f, 0.5f, 0.6f);
 	gGroundPlaneDebug = PxCreatePlane(*gPhysics, PxPlane(0, 1, 0, 1.5f), *gDefaultMaterial);
 
-	PxU32 numThreads = static_cast<PxU32>(std::thread::hardware_concurrency());
+	const uint32_t threadCount = cfg::Engine.Read<uint32_t>("Physics", "physics.threads", 0);
+	PxU32 numThreads = threadCount > 0 ? threadCount : static_cast<PxU32>(std::thread::hardware_concurrency());
 	gCpuDispatcher = PxDefaultCpuDispatcherCreate(numThreads);
-	PxSceneDesc sceneDesc(gPhysics->getTolerancesScale());
-	sceneDesc.gravity = PxVec3(0.0f, -9.81f, 0.0f);
-	sceneDesc.cpuDispatcher = gCpuDispatcher;
-	sceneDesc.filterShader = contactReportFilterShader;
-	sceneDesc.simulationEventCallback = &gContactReportCallback;
-	gScene = gPhysics->createScene(sceneDesc);
 
-#ifdef _DEBUG
-	gScene->addActor(*gGroundPlaneDebug);
-#endif
+	const std::string broadPhaseName = cfg::Engine.Read<std::string>("Physics", "physics.broadphase", "PABP");
+	gScene = CreateScene(ParseBroadPhaseType(broadPhaseName));
+	UpdateBroadPhaseRegions(WOrigin);
+
+	/* A cached scene replaces the runtime construction of every body it contains.
+	Without one, the scene is exported once the physics system has built it. */
+	gSerializationRegistry = PxSerialization::createSerializationRegistry(*gPhysics);
+	if (cfg::Engine.Read<bool>("Physics", "physics.scene_cache.enabled", false)) {
+		const std::string scenePath = cfg::Engine.Read<std::string>("Physics", "physics.scene_cache.path", PHYSICS_CACHE_DIR "scene.pxb");
+		if (!ImportScene(scenePath))
+			gPendingSceneExportPath = scenePath;
+	}
 
 	PxPvdSceneClient* pvdClient = gScene->getScenePvdClient();
 	if (pvdClient) {
@@ -83,6 +196,144 @@ bool Physics::Initialize()
 	return true;
 }
 
+PxBroadPhaseType::Enum Physics::ParseBroadPhaseType(const std::string& name)
+{
+	if (name == "SAP")	return PxBroadPhaseType::eSAP;
+	if (name == "MBP")	return PxBroadPhaseType::eMBP;
+	if (name == "ABP")	return PxBroadPhaseType::eABP;
+	if (name == "PABP")	return PxBroadPhaseType::ePABP;
+
+	LOG(LogPhysics, LOG_WARNING, std::format("Unknown broad-phase type {}. Falling back to PABP.", name));
+	return PxBroadPhaseType::ePABP;
+}
+
+PxScene* Physics::CreateScene(const PxBroadPhaseType::Enum broadPhaseType)
+{
+	PxSceneDesc sceneDesc(gPhysics->getTolerancesScale());
+	sceneDesc.gravity = PxVec3(0.0f, -9.81f, 0.0f);
+	sceneDesc.cpuDispatcher = gCpuDispatcher;
+	sceneDesc.filterShader = contactReportFilterShader;
+	sceneDesc.simulationEventCallback = &gContactReportCallback;
+	sceneDesc.broadPhaseType = broadPhaseType;
+	sceneDesc.broadPhaseCallback = &gBroadPhaseCallback;
+	return gPhysics->createScene(sceneDesc);
+}
+
+/* Releases every actor, cached shape and cooked mesh and recreates the scene on a new
+dispatcher, so a run starts from the same heap as the first one. Materials are kept. */
+void Physics::ResetScene(const uint32_t numThreads)
+{
+	const PxBroadPhaseType::Enum broadPhaseType = gScene->getBroadPhaseType();
+
+	FlushPendingStaticBodies();
+
+	// releasing the scene leaves its actors alive, and the actors hold references to the shapes
+	for (const auto& [entity, body] : mRigidBodies)
+		body->release();
+	for (const auto& [entity, body] : mStaticBodies)
+		body->release();
+	for (const auto& [meshId, shape] : mShapes)
+		shape->release();
+	for (const auto& [meshId, triangleMesh] : mTriangleMeshes)
+		triangleMesh->release();
+	for (const auto& [meshId, convexMesh] : mConvexMeshes)
+		convexMesh->release();
+
+	mRigidBodies.clear();
+	mStaticBodies.clear();
+	mShapes.clear();
+	mTriangleMeshes.clear();
+	mConvexMeshes.clear();
+	mCollisions.clear();
+	mBroadPhaseRegions.clear();
+
+	// a reset scene is scratch space, it must not become the game's scene cache
+	gPendingSceneExportPath.clear();
+
+	gScene->release();
+	gCpuDispatcher->release();
+
+	gCpuDispatcher = PxDefaultCpuDispatcherCreate(numThreads);
+	gScene = CreateScene(broadPhaseType);
+	UpdateBroadPhaseRegions(WOrigin);
+}
+
+size_t Physics::GetAllocatedBytes()
+{
+	return gAllocator.GetAllocatedBytes();
+}
+
+size_t Physics::GetPeakAllocatedBytes()
+{
+	return gAllocator.GetPeakBytes();
+}
+
+void Physics::ResetPeakAllocatedBytes()
+{
+	gAllocator.ResetPeak();
+}
+
+/* MBP only tracks objects inside its regions, so we keep a square grid of
+regions centered on the streamed play area and swap cells in and out as it moves. */
+void Physics::UpdateBroadPhaseRegions(const Vec3& center)
+{
+	if (gScene == nullptr || gScene->getBroadPhaseType() != PxBroadPhaseType::eMBP)
+		return;
+
+	static const cfg::Handle<float> regionSizeCfg = cfg::Engine.GetHandle<float>("Physics", "physics.mbp.region_size", 256.0f);
+	static const cfg::Handle<float> regionHeightCfg = cfg::Engine.GetHandle<float>("Physics", "physics.mbp.region_height", 1000.0f);
+	static const cfg::Handle<uint32_t> regionRadiusCfg = cfg::Engine.GetHandle<uint32_t>("Physics", "physics.mbp.region_radius", 2);
+	static float builtRegionSize = 0.0f;
+	static float builtRegionHeight = 0.0f;
+
+	const float regionSize = std::max(regionSizeCfg.Get(), 1.0f);
+	const float regionHeight = regionHeightCfg.Get();
+	const int32_t regionRadius = static_cast<int32_t>(regionRadiusCfg.Get());
+
+	// a reload that resized the cells invalidates every region built so far
+	if (regionSize != builtRegionSize || regionHeight != builtRegionHeight) {
+		for (const auto& [key, regionIndex] : mBroadPhaseRegions)
+			gScene->removeBroadPhaseRegion(regionIndex);
+		mBroadPhaseRegions.clear();
+		builtRegionSize = regionSize;
+		builtRegionHeight = regionHeight;
+	}
+
+	const int32_t centerX = static_cast<int32_t>(std::floor(center.x / regionSize));
+	const int32_t centerZ = static_cast<int32_t>(std::floor(center.z / regionSize));
+	auto cellKey = [](const int32_t x, const int32_t z) {
+		return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+	};
+
+	// drop regions that fell outside the play area
+	for (auto it = mBroadPhaseRegions.begin(); it != mBroadPhaseRegions.end();) {
+		const int32_t x = static_cast<int32_t>(it->first >> 32);
+		const int32_t z = static_cast<int32_t>(it->first & 0xFFFFFFFF);
+		if (std::abs(x - centerX) > regionRadius || std::abs(z - centerZ) > regionRadius) {
+			gScene->removeBroadPhaseRegion(it->second);
+			it = mBroadPhaseRegions.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	for (int32_t x = centerX - regionRadius; x <= centerX + regionRadius; x++) {
+		for (int32_t z = centerZ - regionRadius; z <= centerZ + regionRadius; z++) {
+			const uint64_t key = cellKey(x, z);
+			if (mBroadPhaseRegions.find(key) != mBroadPhaseRegions.end())
+				continue;
+
+			PxBroadPhaseRegion region;
+			region.mBounds = PxBounds3(
+				PxVec3(x * regionSize, -regionHeight, z * regionSize),
+				PxVec3((x + 1) * regionSize, regionHeight, (z + 1) * regionSize));
+			region.mUserData = nullptr;
+			mBroadPhaseRegions[key] = gScene->addBroadPhaseRegion(region, true);
+		}
+	}
+}
+
 PxScene* Physics::GetScene()
 {
 	return gScene;
@@ -105,14 +356,14 @@ Vec3 Physics::QuatToEuler(const PxQuat& quat)
 	PxMat33 mat(quat);
 	float yaw, pitch, roll;
 
-	// Check for gimbal lock (pitch close to 90 degrees)
-	if (mat[2][0] >= 0.9999f)  // Singularity at +90
+	// Check for gimbal lock (pitch close to ±90 degrees)
+	if (mat[2][0] >= 0.9999f)  // Singularity at +90°
 	{
 		pitch = PxPi / 2.0f;
 		yaw = 0.0f;
 		roll = atan2(mat[1][2], mat[1][1]); // Roll derived from other axes
 	}
-	else if (mat[2][0] <= -0.9999f)  // Singularity at -90
+	else if (mat[2][0] <= -0.9999f)  // Singularity at -90°
 	{
 		pitch = -PxPi / 2.0f;
 		yaw = 0.0f;
@@ -163,6 +414,105 @@ PxShape* Physics::CreateMeshShape(const std::vector<Vertex>& vertices, Vec3 offs
 	return shape;
 }
 
+/* PhysX caps a scene at 64k materials, so bodies with the same surface share one. */
+static uint64_t GetMaterialKey(const float staticFriction, const float dynamicFriction, const float restitution)
+{
+	uint64_t key = Utils::HashBytes(&staticFriction, sizeof(float));
+	key = Utils::HashBytes(&dynamicFriction, sizeof(float), key);
+	return Utils::HashBytes(&restitution, sizeof(float), key);
+}
+
+PxMaterial* Physics::GetOrCreateMaterial(const float staticFriction, const float dynamicFriction, const float restitution)
+{
+	const uint64_t key = GetMaterialKey(staticFriction, dynamicFriction, restitution);
+
+	auto it = mMaterials.find(key);
+	if (it != mMaterials.end())
+		return it->second;
+
+	PxMaterial* material = gPhysics->createMaterial(staticFriction, dynamicFriction, restitution);
+	mMaterials[key] = material;
+	return material;
+}
+
+/* Cache files are keyed by the mesh geometry itself, so re-exported assets
+invalidate their cooked data without any bookkeeping. */
+static std::string GetTriangleMeshCachePath(const Mesh* mesh)
+{
+	uint64_t hash = Utils::HashBytes(mesh->vertices.data(), mesh->vertices.size() * sizeof(Vertex));
+	hash = Utils::HashBytes(mesh->indices.data(), mesh->indices.size() * sizeof(uint32_t), hash);
+	return std::format("{}{:016x}_v{}.pxtm", PHYSICS_CACHE_DIR, hash, PHYSICS_TRIANGLE_MESH_CACHE_VERSION);
+}
+
+PxTriangleMesh* Physics::GetOrCookTriangleMesh(const Mesh* mesh)
+{
+	auto it = mTriangleMeshes.find(mesh->assetId);
+	if (it != mTriangleMeshes.end())
+		return it->second;
+
+	const std::string cachePath = GetTriangleMeshCachePath(mesh);
+	PxTriangleMesh* triangleMesh = nullptr;
+
+	if (std::filesystem::exists(cachePath)) {
+		PxDefaultFileInputData cachedData(cachePath.c_str());
+		if (cachedData.isValid())
+			triangleMesh = gPhysics->createTriangleMesh(cachedData);
+
+		if (!triangleMesh)
+			LOG(LogPhysics, LOG_WARNING, std::format("Discarding invalid cooked triangle mesh cache {}.", cachePath));
+	}
+
+	if (!triangleMesh) {
+		PxTriangleMeshDesc meshDesc;
+		meshDesc.points.count = static_cast<PxU32>(mesh->vertices.size());
+		meshDesc.points.stride = sizeof(Vertex);
+		meshDesc.points.data = mesh->vertices.data();
+		meshDesc.triangles.count = static_cast<PxU32>(mesh->indices.size() / 3);
+		meshDesc.triangles.stride = 3 * sizeof(uint32_t);
+		meshDesc.triangles.data = mesh->indices.data();
+
+		// level geometry is cooked once and cached, so favour query speed over cook time
+		PxCookingParams cookingParams(gPhysics->getTolerancesScale());
+		cookingParams.midphaseDesc.setToDefault(PxMeshMidPhase::eBVH34);
+		cookingParams.midphaseDesc.mBVH34Desc.numPrimsPerLeaf = 4;
+		cookingParams.midphaseDesc.mBVH34Desc.buildStrategy = PxBVH34BuildStrategy::eSAH;
+
+		PxDefaultMemoryOutputStream buf;
+		PxTriangleMeshCookingResult::Enum result;
+		if (!PxCookTriangleMesh(cookingParams, meshDesc, buf, &result)) {
+			LOG(LogPhysics, LOG_ERROR, std::format("Failed to cook triangle mesh for {}.", mesh->assetPath));
+			return nullptr;
+		}
+
+		try {
+			std::filesystem::create_directories(PHYSICS_CACHE_DIR);
+			PxDefaultFileOutputStream cacheFile(cachePath.c_str());
+			if (cacheFile.isValid())
+				cacheFile.write(buf.getData(), buf.getSize());
+		}
+		catch (const std::filesystem::filesystem_error& e) {
+			LOG(LogPhysics, LOG_WARNING, std::format("Could not write cooked triangle mesh cache. Error: {}", e.what()));
+		}
+
+		PxDefaultMemoryInputData input(buf.getData(), buf.getSize());
+		triangleMesh = gPhysics->createTriangleMesh(input);
+	}
+
+	mTriangleMeshes[mesh->assetId] = triangleMesh;
+	return triangleMesh;
+}
+
+PxShape* Physics::CreateTriangleMeshShape(const Mesh* mesh, const Vec3& scale, PxMaterial* material)
+{
+	PxTriangleMesh* triangleMesh = GetOrCookTriangleMesh(mesh);
+	if (!triangleMesh)
+		return nullptr;
+
+	PxMaterial* shapeMaterial = material ? material : gDefaultMaterial;
+	PxTriangleMeshGeometry geometry(triangleMesh, PxMeshScale(PxVec3(scale.x, scale.y, scale.z)));
+	return gPhysics->createShape(geometry, *shapeMaterial, true);
+}
+
 PxMaterial* Physics::GetDefaultMaterial()
 {
 	return gDefaultMaterial;
@@ -176,9 +526,216 @@ PxRigidStatic* Physics::GetDebugPlane()
 void Physics::Update(float dt)
 {
 	mCollisions.clear();
+	FlushPendingStaticBodies();
+
+	static const cfg::Handle<float> budgetHandle = cfg::Engine.GetHandle<float>("Physics", "physics.profiler.budget_ms", 0.0f);
+	const float budgetMs = budgetHandle.Get();
+	Profiler& profiler = Profiler::Get();
+	const uint64_t stepStart = profiler.Now();
 
 	gScene->simulate(dt);
 	gScene->fetchResults(true);
+
+	const uint64_t stepEnd = profiler.Now();
+	profiler.RecordZone("Physics::Update", "Physics.Step", stepStart, stepEnd);
+
+	const double stepMs = static_cast<double>(stepEnd - stepStart) / 1e6;
+	if (budgetMs > 0.0f && stepMs > budgetMs) {
+		LOG(LogPhysics, LOG_WARNING, std::format("Physics step took {:.3f} ms (budget {:.3f} ms). Broad-phase {:.3f} ms, narrow-phase {:.3f} ms, solver {:.3f} ms, integration {:.3f} ms.",
+			stepMs, budgetMs,
+			profiler.GetCurrentCategoryTotalMs("Physics.BroadPhase"),
+			profiler.GetCurrentCategoryTotalMs("Physics.NarrowPhase"),
+			profiler.GetCurrentCategoryTotalMs("Physics.Solver"),
+			profiler.GetCurrentCategoryTotalMs("Physics.Integration")));
+	}
+}
+
+/* Call once nothing is left loading, the cache is only checked against the assets it was built from. */
+void Physics::ExportPendingScene()
+{
+	if (gPendingSceneExportPath.empty() || (mRigidBodies.empty() && mStaticBodies.empty()))
+		return;
+
+	ExportScene(gPendingSceneExportPath);
+	gPendingSceneExportPath.clear();
+}
+
+/* The sorted guids of every loaded mesh and the entity layout given to Initialize, a cache
+built over other meshes or from other transforms and colliders is stale. */
+uint64_t Physics::GetSceneContentHash()
+{
+	const std::vector<AssetGuid> guids = AssetManager::Get().GetAssetGuids<Mesh>();
+	const uint64_t hash = Utils::HashBytes(guids.data(), guids.size() * sizeof(AssetGuid));
+	return Utils::HashBytes(&gSceneLayoutHash, sizeof(gSceneLayoutHash), hash);
+}
+
+bool Physics::ExportScene(const std::string& path)
+{
+	FlushPendingStaticBodies();
+
+	PxCollection* collection = PxCreateCollection();
+	for (const auto& [entity, body] : mRigidBodies)
+		collection->add(*body, MakeSerialId(SerialIdKind::Actor, entity));
+	for (const auto& [entity, body] : mStaticBodies)
+		collection->add(*body, MakeSerialId(SerialIdKind::Actor, entity));
+	for (const auto& [meshId, shape] : mShapes) {
+		const Mesh* mesh = AssetManager::Get().GetAssetById<Mesh>(meshId);
+		if (shape != nullptr && mesh != nullptr)
+			collection->add(*shape, MakeMeshSerialId(SerialIdKind::ConvexShape, mesh->assetGuid));
+	}
+	for (const auto& [meshId, triangleMesh] : mTriangleMeshes) {
+		if (const Mesh* mesh = AssetManager::Get().GetAssetById<Mesh>(meshId))
+			collection->add(*triangleMesh, MakeMeshSerialId(SerialIdKind::TriangleMesh, mesh->assetGuid));
+	}
+
+	// pulls in the materials, per-body shapes and cooked meshes the actors reference
+	PxSerialization::complete(*collection, *gSerializationRegistry);
+
+	std::filesystem::path directory = std::filesystem::path(path).parent_path();
+	if (!directory.empty())
+		std::filesystem::create_directories(directory);
+
+	uint8_t headerBlock[PX_SERIAL_FILE_ALIGN] = {};
+	SceneCacheHeader header;
+	header.contentHash = GetSceneContentHash();
+	std::memcpy(headerBlock, &header, sizeof(header));
+
+	PxDefaultFileOutputStream stream(path.c_str());
+	const bool exported = stream.isValid() && stream.write(headerBlock, sizeof(headerBlock)) == sizeof(headerBlock) &&
+		PxSerialization::serializeCollectionToBinary(stream, *collection, *gSerializationRegistry);
+	if (exported)
+		LOG(LogPhysics, LOG_INFO, std::format("Exported {} physics object(s) to {}.", collection->getNbObjects(), path));
+	else
+		LOG(LogPhysics, LOG_WARNING, std::format("Failed to export the physics scene to {}.", path));
+
+	collection->release();
+	return exported;
+}
+
+bool Physics::ImportScene(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	const size_t size = static_cast<size_t>(file.tellg());
+	file.seekg(0);
+
+	if (size <= PX_SERIAL_FILE_ALIGN)
+		return false;
+
+	std::unique_ptr<uint8_t[], SerializedBlockDeleter> block(static_cast<uint8_t*>(::operator new[](size, std::align_val_t(PX_SERIAL_FILE_ALIGN))));
+	if (!file.read(reinterpret_cast<char*>(block.get()), size))
+		return false;
+
+	SceneCacheHeader header;
+	std::memcpy(&header, block.get(), sizeof(header));
+	if (header.magic != SceneCacheHeader().magic || header.version != PHYSICS_SCENE_CACHE_VERSION || header.contentHash != GetSceneContentHash()) {
+		LOG(LogPhysics, LOG_INFO, std::format("The physics scene at {} was built from other assets, it will be rebuilt.", path));
+		return false;
+	}
+
+	// fails on files written by a different PhysX version or platform
+	PxCollection* collection = PxSerialization::createCollectionFromBinary(block.get() + PX_SERIAL_FILE_ALIGN, *gSerializationRegistry);
+	if (collection == nullptr) {
+		LOG(LogPhysics, LOG_WARNING, std::format("Could not read the physics scene at {}, it will be rebuilt.", path));
+		return false;
+	}
+
+	// nothing is registered until every cooked mesh maps back to a loaded mesh
+	std::unordered_map<Entity, PxRigidDynamic*> rigidBodies;
+	std::unordered_map<Entity, PxRigidStatic*> staticBodies;
+	std::unordered_map<Asset, PxShape*> shapes;
+	std::unordered_map<Asset, PxTriangleMesh*> triangleMeshes;
+	bool resolved = true;
+	for (PxU32 i = 0; i < collection->getNbObjects() && resolved; i++) {
+		PxBase& object = collection->getObject(i);
+		const PxSerialObjectId id = collection->getId(object);
+		if (id == PX_SERIAL_OBJECT_ID_INVALID)
+			continue;
+
+		if (PxRigidDynamic* body = object.is<PxRigidDynamic>())
+			rigidBodies[static_cast<Entity>(id & 0xFFFFFFFF)] = body;
+		else if (PxRigidStatic* body = object.is<PxRigidStatic>())
+			staticBodies[static_cast<Entity>(id & 0xFFFFFFFF)] = body;
+		else if (PxShape* shape = object.is<PxShape>()) {
+			const Mesh* mesh = AssetManager::Get().GetAssetByGuid<Mesh>(GetMeshSerialGuid(SerialIdKind::ConvexShape, id));
+			resolved = mesh != nullptr;
+			if (resolved)
+				shapes[mesh->assetId] = shape;
+		}
+		else if (PxTriangleMesh* triangleMesh = object.is<PxTriangleMesh>()) {
+			const Mesh* mesh = AssetManager::Get().GetAssetByGuid<Mesh>(GetMeshSerialGuid(SerialIdKind::TriangleMesh, id));
+			resolved = mesh != nullptr;
+			if (resolved)
+				triangleMeshes[mesh->assetId] = triangleMesh;
+		}
+	}
+
+	if (!resolved) {
+		LOG(LogPhysics, LOG_INFO, std::format("The physics scene at {} references a mesh that is not loaded, it will be rebuilt.", path));
+		PxCollectionExt::releaseObjects(*collection);
+		collection->release();
+		return false;
+	}
+
+	for (PxU32 i = 0; i < collection->getNbObjects(); i++) {
+		if (PxMaterial* material = collection->getObject(i).is<PxMaterial>())
+			mMaterials.emplace(GetMaterialKey(material->getStaticFriction(), material->getDynamicFriction(), material->getRestitution()), material);
+	}
+	mRigidBodies.insert(rigidBodies.begin(), rigidBodies.end());
+	mStaticBodies.insert(staticBodies.begin(), staticBodies.end());
+	mShapes.insert(shapes.begin(), shapes.end());
+	mTriangleMeshes.insert(triangleMeshes.begin(), triangleMeshes.end());
+
+	gScene->addCollection(*collection);
+	LOG(LogPhysics, LOG_INFO, std::format("Imported {} rigid and {} static bodies from {}.", mRigidBodies.size(), mStaticBodies.size(), path));
+
+	collection->release();
+	gSerializedBlocks.push_back(std::move(block));
+	return true;
+}
+
+/* PhysX zone names are static strings, so the category lookup is cached per
+name pointer. Zone start time travels in the opaque profiler data. */
+static const char* GetPhysicsZoneCategory(const char* eventName)
+{
+	thread_local std::unordered_map<const char*, const char*> categories;
+	auto it = categories.find(eventName);
+	if (it != categories.end())
+		return it->second;
+
+	std::string name = eventName ? eventName : "";
+	std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	const char* category = "Physics.Other";
+	if (name.find("broadphase") != std::string::npos || name.find("aabbmanager") != std::string::npos)
+		category = "Physics.BroadPhase";
+	else if (name.find("solve") != std::string::npos || name.find("constraint") != std::string::npos || name.find("island") != std::string::npos)
+		category = "Physics.Solver";
+	else if (name.find("integrat") != std::string::npos || name.find("updatebodies") != std::string::npos)
+		category = "Physics.Integration";
+	else if (name.find("narrowphase") != std::string::npos || name.find("contact") != std::string::npos || name.find("collide") != std::string::npos)
+		category = "Physics.NarrowPhase";
+
+	categories[eventName] = category;
+	return category;
+}
+
+void* ProfilerCallback::zoneStart(const char* eventName, bool detached, uint64_t contextId)
+{
+	PX_UNUSED(eventName);
+	PX_UNUSED(detached);
+	PX_UNUSED(contextId);
+	return reinterpret_cast<void*>(static_cast<uintptr_t>(Profiler::Get().Now()));
+}
+
+void ProfilerCallback::zoneEnd(void* profilerData, const char* eventName, bool detached, uint64_t contextId)
+{
+	PX_UNUSED(detached);
+	PX_UNUSED(contextId);
+	const uint64_t startNs = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(profilerData));
+	Profiler::Get().RecordZone(eventName, GetPhysicsZoneCategory(eventName), startNs, Profiler::Get().Now());
 }
 
 void Physics::AddRigidBody(const Entity entity, const RigidBody& rb, const Transform& transform) {
@@ -200,9 +757,7 @@ void Physics::AddRigidBody(const Entity entity, const RigidBody& rb, const Trans
 		PxQuat q = PxQuat(transform.rotation.x, transform.rotation.y, transform.rotation.z, transform.rotation.w);
 		PxTransform t(PxVec3(transform.position.x, transform.position.y, transform.position.z), q);
 		PxRigidDynamic* body = gPhysics->createRigidDynamic(t);
-		PxMaterial* physMaterial = gPhysics->createMaterial(rb.staticFriction, rb.dynamicFriction, rb.restitution);
-		body->setMass(rb.mass);
-		PxRigidBodyExt::updateMassAndInertia(*body, 10.0f);
+		PxMaterial* physMaterial = GetOrCreateMaterial(rb.staticFriction, rb.dynamicFriction, rb.restitution);
 		
 		PxShape* shape = nullptr;
 		
@@ -210,14 +765,15 @@ void Physics::AddRigidBody(const Entity entity, const RigidBody& rb, const Trans
 			for (auto meshId : collider.meshes) {
 				auto it = mShapes.find(meshId);
 				if (it == mShapes.end()) {
-					std::cout << "Generating convex hull collision for mesh " << meshId << std::endl;
+					LOG(LogPhysics, LOG_VERBOSE, std::format("Generating convex hull collision for mesh {}.", meshId));
 					Mesh* loadedMesh = AssetManager::Get().GetAssetById<Mesh>(meshId);
-					mShapes[meshId] = CreateMeshShape(loadedMesh->vertices, Vec3(0), physMaterial);
+					it = mShapes.emplace(meshId, CreateMeshShape(loadedMesh->vertices, Vec3(0), physMaterial)).first;
 				}
 				
-				shape = mShapes[meshId];
-				body->attachShape(*shape);
-				shape->release();
+				// cached hulls are shared between bodies, the cache keeps its own reference
+				shape = it->second;
+				if (shape != nullptr)
+					body->attachShape(*shape);
 			}	
 		}
 		else if (collider.type == ColliderType::Cube) {
@@ -231,11 +787,67 @@ void Physics::AddRigidBody(const Entity entity, const RigidBody& rb, const Trans
 			shape->release();
 		}
 		
+		// inertia has to come from the attached shapes
+		PxRigidBodyExt::setMassAndUpdateInertia(*body, rb.mass);
+
 		gScene->addActor(*body);
 		mRigidBodies[entity] = body;
 	}
 }
 
+/* Static bodies are queued and inserted in one batch on the next update,
+which lets the scene build its pruning structures once per level load. */
+void Physics::AddStaticBody(const Entity entity, const Transform& transform, const Collider& collider, const std::vector<Asset>& renderMeshes)
+{
+	if (mStaticBodies.find(entity) != mStaticBodies.end())
+		return;
+
+	PxQuat q = PxQuat(transform.rotation.x, transform.rotation.y, transform.rotation.z, transform.rotation.w);
+	PxTransform t(PxVec3(transform.position.x, transform.position.y, transform.position.z), q);
+	PxRigidStatic* body = gPhysics->createRigidStatic(t);
+
+	PxShape* shape = nullptr;
+
+	if (collider.type == ColliderType::Mesh) {
+		const std::vector<Asset>& meshes = collider.meshes.empty() ? renderMeshes : collider.meshes;
+		for (auto meshId : meshes) {
+			Mesh* mesh = AssetManager::Get().GetAssetById<Mesh>(meshId);
+			if (mesh == nullptr)
+				continue;
+
+			shape = CreateTriangleMeshShape(mesh, transform.scale, gDefaultMaterial);
+			if (shape == nullptr)
+				continue;
+
+			body->attachShape(*shape);
+			shape->release();
+		}
+	}
+	else if (collider.type == ColliderType::Cube) {
+		shape = CreateBoxShape(collider.width, collider.height, collider.depth, Vec3(0.0f), gDefaultMaterial);
+		body->attachShape(*shape);
+		shape->release();
+	}
+	else if (collider.type == ColliderType::Sphere) {
+		shape = gPhysics->createShape(PxSphereGeometry(collider.radius), *gDefaultMaterial);
+		body->attachShape(*shape);
+		shape->release();
+	}
+
+	mStaticBodies[entity] = body;
+	mPendingStaticActors.push_back(body);
+}
+
+void Physics::FlushPendingStaticBodies()
+{
+	if (mPendingStaticActors.empty())
+		return;
+
+	gScene->addActors(mPendingStaticActors.data(), static_cast<PxU32>(mPendingStaticActors.size()));
+	LOG(LogPhysics, LOG_VERBOSE, std::format("Inserted {} static actor(s) into the scene.", mPendingStaticActors.size()));
+	mPendingStaticActors.clear();
+}
+
 Vec3 Physics::GetRigidBodyPosition(const int32_t index)
 {
 	auto it = mRigidBodies.find(index);
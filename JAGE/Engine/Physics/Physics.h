@@ -3,6 +3,7 @@
 #include <physx/PxPhysicsAPI.h>
 #include <physx/cooking/PxCooking.h>
 #include <Core/Log/Logging.h>
+#include <Core/Profiler.h>
 #include <ECS/Components/Transform.h>
 #include <ECS/Components/Collider.h>
 #include <ECS/Components/RigidBody.h>
@@ -12,31 +13,54 @@
 using namespace physx;
 constexpr const char* LogPhysics = "Physics";
 
+/* Cooked triangle meshes are written here so warm starts skip cooking. */
+#define PHYSICS_CACHE_DIR "Cache/Physics/"
+#define PHYSICS_TRIANGLE_MESH_CACHE_VERSION 1
+#define PHYSICS_SCENE_CACHE_VERSION 2
+
 struct CollisionData {
 	PxActor* actorA;
 	PxActor* actorB;
 };
 
 namespace Physics {
-	bool Initialize();
+	/* sceneLayoutHash describes the entities the scene is built for, a cached scene built for others is rebuilt. */
+	bool Initialize(const uint64_t sceneLayoutHash = 0);
+	PxScene* CreateScene(const PxBroadPhaseType::Enum broadPhaseType);
+	PxBroadPhaseType::Enum ParseBroadPhaseType(const std::string& name);
+	void ResetScene(const uint32_t numThreads);
+	bool ExportScene(const std::string& path);
+	bool ImportScene(const std::string& path);
+	void ExportPendingScene();
+	uint64_t GetSceneContentHash();
 
 	/* Aux vars. */
 	inline std::unordered_map<int, PxConvexMesh*> mConvexMeshes;
 	inline std::unordered_map<int, PxTriangleMesh*> mTriangleMeshes;
 	inline std::vector<CollisionData> mCollisions;
 	inline std::unordered_map<Entity, PxRigidDynamic*> mRigidBodies;
+	inline std::unordered_map<Entity, PxRigidStatic*> mStaticBodies;
+	inline std::vector<PxActor*> mPendingStaticActors;
 	inline std::unordered_map<Asset, PxShape*> mShapes;
+	inline std::unordered_map<uint64_t, PxMaterial*> mMaterials;	// hashed (static friction, dynamic friction, restitution)
+	inline std::unordered_map<uint64_t, PxU32> mBroadPhaseRegions;	// grid cell -> MBP region handle
 
 	/* Global getters. */
 	PxScene* GetScene();
 	PxPhysics* GetPhysics();
 	PxMaterial* GetDefaultMaterial();
 	PxRigidStatic* GetDebugPlane();
+	size_t GetAllocatedBytes();
+	size_t GetPeakAllocatedBytes();
+	void ResetPeakAllocatedBytes();
 
 	/* General functions. */
 	void Update(float dt);
 	void AddRigidBody(const Entity entity, const RigidBody& rb, const Transform& transform, const Collider& collider);
 	void AddRigidBody(const Entity entity, const RigidBody& rb, const Transform& transform);
+	void AddStaticBody(const Entity entity, const Transform& transform, const Collider& collider, const std::vector<Asset>& renderMeshes = {});
+	void FlushPendingStaticBodies();
+	void UpdateBroadPhaseRegions(const Vec3& center);
 	Vec3 GetRigidBodyPosition(const int32_t index);
 	Vec3 GetRigidBodyVelocity(const int32_t index);
 	Quat GetRigidBodyRotation(const int32_t index);
@@ -44,6 +68,27 @@ namespace Physics {
 	Vec3 QuatToEuler(const PxQuat& quat);
 	PxQuat EulerToQuat(const Vec3& euler);
 	PxShape* CreateMeshShape(const std::vector<Vertex>& vertices, Vec3 offset, PxMaterial* material = nullptr);
+	PxMaterial* GetOrCreateMaterial(const float staticFriction, const float dynamicFriction, const float restitution);
+	PxTriangleMesh* GetOrCookTriangleMesh(const Mesh* mesh);
+	PxShape* CreateTriangleMeshShape(const Mesh* mesh, const Vec3& scale, PxMaterial* material = nullptr);
+};
+
+class BroadPhaseCallback : public PxBroadPhaseCallback {
+	void onObjectOutOfBounds(PxShape& shape, PxActor& actor)
+	{
+		PX_UNUSED(shape);
+		LOG(LogPhysics, LOG_WARNING, std::format("Actor {} left the streamed broad-phase regions.", actor.getName() ? actor.getName() : "<unnamed>"));
+	}
+
+	void onObjectOutOfBounds(PxAggregate& aggregate) { PX_UNUSED(aggregate); }
+};
+
+/* Forwards PhysX profiling zones into the engine profiler. Zones are only
+emitted by the profile, checked and debug builds of the SDK. */
+class ProfilerCallback : public PxProfilerCallback {
+public:
+	void* zoneStart(const char* eventName, bool detached, uint64_t contextId);
+	void zoneEnd(void* profilerData, const char* eventName, bool detached, uint64_t contextId);
 };
 
 class ContactReportCallback : public PxSimulationEventCallback {
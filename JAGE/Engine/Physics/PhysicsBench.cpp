@@ -0,0 +1,313 @@
+#include <chrono>
+#include <random>
+#include <thread>
+#include "PhysicsBench.h"
+
+constexpr const char* LogPhysicsBench = "PhysicsBench";
+
+#define BENCH_BROADPHASE_STEPS 120
+#define BENCH_BROADPHASE_WORLD_EXTENT 4000.0f	// half size, i.e. an 8km x 8km map
+#define BENCH_BROADPHASE_MBP_SUBDIV 16
+
+#define BENCH_STRESS_COLUMNS 50			// bodies per row, a layer holds COLUMNS^2 bodies
+#define BENCH_STRESS_SPACING 3.0f
+#define BENCH_STRESS_DROP_HEIGHT 5.0f
+
+struct BroadPhaseResult {
+	double stepMs = 0.0;
+	double broadPhaseMs = 0.0;	// the PhysX broad-phase zones alone
+};
+
+static BroadPhaseResult BenchBroadPhase(const PxBroadPhaseType::Enum type, const uint32_t bodyCount)
+{
+	PxPhysics* physics = Physics::GetPhysics();
+	PxScene* scene = Physics::CreateScene(type);
+	scene->setGravity(PxVec3(0.0f));
+
+	const float extent = BENCH_BROADPHASE_WORLD_EXTENT;
+	if (type == PxBroadPhaseType::eMBP) {
+		PxBounds3 regionBounds[BENCH_BROADPHASE_MBP_SUBDIV * BENCH_BROADPHASE_MBP_SUBDIV];
+		const PxBounds3 worldBounds(PxVec3(-extent), PxVec3(extent));
+		const PxU32 regionCount = PxBroadPhaseExt::createRegionsFromWorldBounds(regionBounds, worldBounds, BENCH_BROADPHASE_MBP_SUBDIV);
+
+		for (PxU32 i = 0; i < regionCount; i++) {
+			PxBroadPhaseRegion region;
+			region.mBounds = regionBounds[i];
+			region.mUserData = nullptr;
+			scene->addBroadPhaseRegion(region);
+		}
+	}
+
+	// fixed seed so every broad-phase sees the exact same world
+	std::mt19937 gen(1337);
+	std::uniform_real_distribution<float> posDist(-extent, extent);
+	std::uniform_real_distribution<float> heightDist(0.0f, 50.0f);
+	std::uniform_real_distribution<float> velDist(-10.0f, 10.0f);
+
+	PxShape* shape = physics->createShape(PxBoxGeometry(0.5f, 0.5f, 0.5f), *Physics::GetDefaultMaterial());
+	std::vector<PxActor*> actors;
+	actors.reserve(bodyCount);
+
+	for (uint32_t i = 0; i < bodyCount; i++) {
+		PxRigidDynamic* body = physics->createRigidDynamic(PxTransform(PxVec3(posDist(gen), heightDist(gen), posDist(gen))));
+		body->attachShape(*shape);
+		body->setLinearVelocity(PxVec3(velDist(gen), 0.0f, velDist(gen)));
+		body->setSleepThreshold(0.0f);	// keep every body moving so bounds are updated each step
+		actors.push_back(body);
+	}
+
+	shape->release();
+	scene->addActors(actors.data(), static_cast<PxU32>(actors.size()));
+
+	// first step pays for the initial insertion, keep it out of the timing
+	const float dt = 1.0f / 60.0f;
+	scene->simulate(dt);
+	scene->fetchResults(true);
+
+	// the whole step also pays for the narrow-phase and the solver, only the broad-phase zones compare the types
+	Profiler& profiler = Profiler::Get();
+	BroadPhaseResult result;
+	for (uint32_t i = 0; i < BENCH_BROADPHASE_STEPS; i++) {
+		profiler.BeginFrame();
+		const uint64_t start = profiler.Now();
+		scene->simulate(dt);
+		scene->fetchResults(true);
+		const uint64_t end = profiler.Now();
+		profiler.EndFrame();
+
+		result.stepMs += static_cast<double>(end - start) / 1e6;
+		result.broadPhaseMs += profiler.GetCategoryTotalMs("Physics.BroadPhase");
+	}
+	result.stepMs /= BENCH_BROADPHASE_STEPS;
+	result.broadPhaseMs /= BENCH_BROADPHASE_STEPS;
+
+	// releasing the scene leaves its actors alive, the next run would start on a dirty heap
+	for (PxActor* actor : actors)
+		actor->release();
+	scene->release();
+
+	return result;
+}
+
+bool PhysicsBench::RunBroadPhase()
+{
+	const std::array<std::pair<const char*, PxBroadPhaseType::Enum>, 4> types = { {
+		{ "SAP", PxBroadPhaseType::eSAP },
+		{ "MBP", PxBroadPhaseType::eMBP },
+		{ "ABP", PxBroadPhaseType::eABP },
+		{ "PABP", PxBroadPhaseType::ePABP },
+	} };
+	const std::array<uint32_t, 3> bodyCounts = { 1000, 10000, 100000 };
+
+	std::cout << std::format("{:<8}{:>12}{:>12}{:>16}", "Type", "Bodies", "BP ms", "step ms") << std::endl;
+	for (const uint32_t bodyCount : bodyCounts) {
+		for (const auto& [name, type] : types) {
+			const BroadPhaseResult result = BenchBroadPhase(type, bodyCount);
+			std::cout << std::format("{:<8}{:>12}{:>12.3f}{:>16.3f}", name, bodyCount, result.broadPhaseMs, result.stepMs) << std::endl;
+		}
+	}
+
+	LOG(LogPhysicsBench, LOG_INFO, "Broad-phase benchmark finished. The BP column stays at zero unless PhysX is a profile, checked or debug build.");
+	return true;
+}
+
+struct StressResult {
+	double meanMs = 0.0;
+	double p99Ms = 0.0;
+	double broadPhaseMs = 0.0;
+	double narrowPhaseMs = 0.0;
+	double solverMs = 0.0;
+	uint32_t peakContactPairs = 0;
+	size_t peakBytes = 0;
+};
+
+/* Only vertex positions are needed for a convex hull, so the bench reads them
+straight from the obj instead of going through the asset loader and its GL uploads. */
+static Asset LoadHullMesh(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		LOG(LogPhysicsBench, LOG_WARNING, std::format("Could not open {}, only boxes will be dropped.", path));
+		return -1;
+	}
+
+	Mesh& mesh = AssetManager::Get().CreateAsset<Mesh>(path);
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.rfind("v ", 0) != 0)
+			continue;
+
+		Vertex vertex;
+		std::istringstream stream(line.substr(2));
+		stream >> vertex.Position.x >> vertex.Position.y >> vertex.Position.z;
+		mesh.vertices.push_back(vertex);
+	}
+
+	return mesh.assetId;
+}
+
+static StressResult BenchStress(const uint32_t bodyCount, const uint32_t threadCount, const uint32_t steps, const Asset hullMesh)
+{
+	Physics::ResetScene(threadCount);
+	Physics::ResetPeakAllocatedBytes();
+
+	const uint32_t layerSize = BENCH_STRESS_COLUMNS * BENCH_STRESS_COLUMNS;
+	const float halfWidth = BENCH_STRESS_COLUMNS * BENCH_STRESS_SPACING * 0.5f;
+
+	Entity entity = 0;
+	Collider ground(ColliderType::Cube);
+	ground.width = halfWidth + 20.0f;
+	ground.height = 0.5f;
+	ground.depth = halfWidth + 20.0f;
+	Physics::AddStaticBody(entity++, Transform{ Vec3(0.0f, -0.5f, 0.0f), Vec3(0.0f) }, ground);
+
+	Collider box(ColliderType::Cube);
+	box.width = box.height = box.depth = 0.5f;
+	Collider hull(ColliderType::Mesh);
+	hull.SetMeshes({ hullMesh });
+
+	// fixed seed so every run builds the same pile
+	std::mt19937 gen(1337);
+	std::uniform_real_distribution<float> jitterDist(-0.25f, 0.25f);
+	std::uniform_real_distribution<float> angleDist(-180.0f, 180.0f);
+
+	RigidBody rb;
+	for (uint32_t i = 0; i < bodyCount; i++) {
+		const uint32_t layer = i / layerSize;
+		const uint32_t row = (i % layerSize) / BENCH_STRESS_COLUMNS;
+		const uint32_t column = i % BENCH_STRESS_COLUMNS;
+		const Vec3 position(
+			column * BENCH_STRESS_SPACING - halfWidth + jitterDist(gen),
+			BENCH_STRESS_DROP_HEIGHT + layer * BENCH_STRESS_SPACING,
+			row * BENCH_STRESS_SPACING - halfWidth + jitterDist(gen));
+		const Transform transform(position, Vec3(angleDist(gen), angleDist(gen), angleDist(gen)));
+
+		// every other body is a hull when the mesh is available
+		const bool useHull = hullMesh >= 0 && (i % 2) == 1;
+		Physics::AddRigidBody(entity++, rb, transform, useHull ? hull : box);
+	}
+
+	Profiler& profiler = Profiler::Get();
+	std::vector<double> stepTimes;
+	stepTimes.reserve(steps);
+
+	StressResult result;
+	const float dt = 1.0f / 60.0f;
+	for (uint32_t i = 0; i < steps; i++) {
+		profiler.BeginFrame();
+		const uint64_t start = profiler.Now();
+		Physics::Update(dt);
+		const uint64_t end = profiler.Now();
+		profiler.EndFrame();
+
+		stepTimes.push_back(static_cast<double>(end - start) / 1e6);
+		result.broadPhaseMs += profiler.GetCategoryTotalMs("Physics.BroadPhase");
+		result.narrowPhaseMs += profiler.GetCategoryTotalMs("Physics.NarrowPhase");
+		result.solverMs += profiler.GetCategoryTotalMs("Physics.Solver");
+
+		PxSimulationStatistics stats;
+		Physics::GetScene()->getSimulationStatistics(stats);
+		result.peakContactPairs = std::max(result.peakContactPairs, stats.nbDiscreteContactPairsWithContacts);
+	}
+
+	for (const double ms : stepTimes)
+		result.meanMs += ms;
+	result.meanMs /= steps;
+	result.broadPhaseMs /= steps;
+	result.narrowPhaseMs /= steps;
+	result.solverMs /= steps;
+
+	const size_t p99Index = std::min(stepTimes.size() - 1, static_cast<size_t>(stepTimes.size() * 0.99));
+	std::nth_element(stepTimes.begin(), stepTimes.begin() + p99Index, stepTimes.end());
+	result.p99Ms = stepTimes[p99Index];
+	result.peakBytes = Physics::GetPeakAllocatedBytes();
+
+	return result;
+}
+
+bool PhysicsBench::RunStress(const StressSettings& settings)
+{
+	if (settings.steps == 0 || settings.bodyCounts.empty()) {
+		LOG(LogPhysicsBench, LOG_ERROR, "Stress benchmark needs at least one step and one body count.");
+		return false;
+	}
+
+	std::vector<uint32_t> threadCounts = settings.threadCounts;
+	if (threadCounts.empty()) {
+		const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+			threadCounts.push_back(threads);
+		threadCounts.push_back(maxThreads);
+	}
+
+	const Asset hullMesh = LoadHullMesh(settings.hullPath);
+
+	std::cout << std::format("{:>8}{:>9}{:>11}{:>11}{:>9}{:>9}{:>9}{:>11}{:>11}",
+		"Bodies", "Threads", "mean ms", "p99 ms", "BP ms", "NP ms", "Sol ms", "Contacts", "Peak MB") << std::endl;
+	for (const uint32_t bodyCount : settings.bodyCounts) {
+		for (const uint32_t threadCount : threadCounts) {
+			const StressResult result = BenchStress(bodyCount, threadCount, settings.steps, hullMesh);
+			std::cout << std::format("{:>8}{:>9}{:>11.3f}{:>11.3f}{:>9.3f}{:>9.3f}{:>9.3f}{:>11}{:>11.1f}",
+				bodyCount, threadCount, result.meanMs, result.p99Ms,
+				result.broadPhaseMs, result.narrowPhaseMs, result.solverMs,
+				result.peakContactPairs, result.peakBytes / (1024.0 * 1024.0)) << std::endl;
+		}
+	}
+
+	LOG(LogPhysicsBench, LOG_INFO, "Stress benchmark finished. Stage columns stay at zero unless PhysX is a profile, checked or debug build.");
+	return true;
+}
+
+static bool ParseCountList(const std::string& list, std::vector<uint32_t>& counts)
+{
+	counts.clear();
+	std::istringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		try {
+			counts.push_back(static_cast<uint32_t>(std::stoul(item)));
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+
+	return !counts.empty();
+}
+
+bool PhysicsBench::ParseStressSettings(const int argc, char** argv, const int first, StressSettings& settings)
+{
+	for (int i = first; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			LOG(LogPhysicsBench, LOG_ERROR, std::format("Missing value for {}.", arg));
+			return false;
+		}
+
+		const std::string value = argv[++i];
+		bool valid = true;
+		// a run needs at least one body, one thread and one step
+		if (arg == "--bodies")
+			valid = ParseCountList(value, settings.bodyCounts) && std::ranges::find(settings.bodyCounts, 0u) == settings.bodyCounts.end();
+		else if (arg == "--threads")
+			valid = ParseCountList(value, settings.threadCounts) && std::ranges::find(settings.threadCounts, 0u) == settings.threadCounts.end();
+		else if (arg == "--steps") {
+			std::vector<uint32_t> steps;
+			valid = ParseCountList(value, steps) && steps.size() == 1 && steps[0] > 0;
+			if (valid)
+				settings.steps = steps[0];
+		}
+		else if (arg == "--hull")
+			settings.hullPath = value;
+		else
+			valid = false;
+
+		if (!valid) {
+			LOG(LogPhysicsBench, LOG_ERROR, std::format("Invalid stress benchmark argument {} {}.", arg, value));
+			return false;
+		}
+	}
+
+	return true;
+}
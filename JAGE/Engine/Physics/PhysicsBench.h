@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Physics.h"
+
+/* Headless physics benchmarks. These only need the PhysX SDK, no window or GL context. */
+struct StressSettings {
+	std::vector<uint32_t> bodyCounts = { 100, 1000, 5000, 10000, 25000, 50000 };
+	std::vector<uint32_t> threadCounts;		// empty means 1, 2, 4 ... up to the hardware thread count
+	uint32_t steps = 300;
+	std::string hullPath = "Assets/Meshes/ak47/ak47.obj";
+};
+
+namespace PhysicsBench {
+	/* Times every broad-phase algorithm with moving bodies scattered over a large open world. */
+	bool RunBroadPhase();
+
+	/* Drops boxes and convex hulls onto static ground through Physics::AddRigidBody and
+	Physics::Update, and reports step time, contacts and PhysX memory for every body/thread count. */
+	bool RunStress(const StressSettings& settings);
+
+	/* Reads --bodies 100,1000 --threads 1,4 --steps 300 --hull path, starting at argv[first]. */
+	bool ParseStressSettings(const int argc, char** argv, const int first, StressSettings& settings);
+};
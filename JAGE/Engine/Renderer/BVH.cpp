@@ -0,0 +1,262 @@
+#include "BVH.h"
+
+static float SurfaceArea(const Vec3& min, const Vec3& max) {
+	const Vec3 d = max - min;
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+int32_t BVH::Insert(const Vec3& min, const Vec3& max, const uint32_t userData) {
+	std::unique_lock lock(mutex);
+
+	const int32_t leaf = AllocateNode();
+	nodes[leaf].min = min - Vec3(BVH_FAT_MARGIN);
+	nodes[leaf].max = max + Vec3(BVH_FAT_MARGIN);
+	nodes[leaf].height = 0;
+	nodes[leaf].userData = userData;
+
+	InsertLeaf(leaf);
+	return leaf;
+}
+
+void BVH::Remove(const int32_t proxy) {
+	std::unique_lock lock(mutex);
+	assert(proxy >= 0 && proxy < static_cast<int32_t>(nodes.size()) && nodes[proxy].IsLeaf() && "BVH: Invalid proxy.");
+
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+}
+
+bool BVH::Update(const int32_t proxy, const Vec3& min, const Vec3& max) {
+	std::unique_lock lock(mutex);
+	assert(proxy >= 0 && proxy < static_cast<int32_t>(nodes.size()) && nodes[proxy].IsLeaf() && "BVH: Invalid proxy.");
+
+	Node& leaf = nodes[proxy];
+	if (glm::all(glm::greaterThanEqual(min, leaf.min)) && glm::all(glm::lessThanEqual(max, leaf.max)))
+		return false;
+
+	RemoveLeaf(proxy);
+	nodes[proxy].min = min - Vec3(BVH_FAT_MARGIN);
+	nodes[proxy].max = max + Vec3(BVH_FAT_MARGIN);
+	InsertLeaf(proxy);
+	return true;
+}
+
+int32_t BVH::AllocateNode() {
+	if (freeList == BVH_NULL_NODE) {
+		nodes.emplace_back();
+		return static_cast<int32_t>(nodes.size() - 1);
+	}
+
+	const int32_t index = freeList;
+	freeList = nodes[index].parent;
+	nodes[index] = Node();
+	return index;
+}
+
+void BVH::FreeNode(const int32_t index) {
+	nodes[index].parent = freeList;
+	nodes[index].left = BVH_NULL_NODE;
+	nodes[index].right = BVH_NULL_NODE;
+	nodes[index].height = -1;
+	freeList = index;
+}
+
+void BVH::SetUnion(Node& node, const Node& a, const Node& b) const {
+	node.min = glm::min(a.min, b.min);
+	node.max = glm::max(a.max, b.max);
+}
+
+/* Walks down picking the sibling with the smallest surface area increase,
+the leaf and that sibling then share a new parent. */
+void BVH::InsertLeaf(const int32_t leaf) {
+	if (root == BVH_NULL_NODE) {
+		root = leaf;
+		nodes[root].parent = BVH_NULL_NODE;
+		return;
+	}
+
+	const Vec3 leafMin = nodes[leaf].min;
+	const Vec3 leafMax = nodes[leaf].max;
+
+	int32_t index = root;
+	while (!nodes[index].IsLeaf()) {
+		const Node& node = nodes[index];
+		const float area = SurfaceArea(node.min, node.max);
+		const float combinedArea = SurfaceArea(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+		// pairing with this node pushes the leaf's area into every ancestor
+		const float cost = 2.0f * combinedArea;
+		const float inheritanceCost = 2.0f * (combinedArea - area);
+
+		auto childCost = [&](const Node& child) {
+			const float childArea = SurfaceArea(glm::min(child.min, leafMin), glm::max(child.max, leafMax));
+			return child.IsLeaf() ? childArea + inheritanceCost
+								  : childArea - SurfaceArea(child.min, child.max) + inheritanceCost;
+		};
+
+		const float leftCost = childCost(nodes[node.left]);
+		const float rightCost = childCost(nodes[node.right]);
+		if (cost < leftCost && cost < rightCost)
+			break;
+
+		index = leftCost < rightCost ? node.left : node.right;
+	}
+
+	const int32_t sibling = index;
+	const int32_t oldParent = nodes[sibling].parent;
+	const int32_t newParent = AllocateNode();
+
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].left = sibling;
+	nodes[newParent].right = leaf;
+	SetUnion(nodes[newParent], nodes[sibling], nodes[leaf]);
+
+	if (oldParent != BVH_NULL_NODE) {
+		if (nodes[oldParent].left == sibling)
+			nodes[oldParent].left = newParent;
+		else
+			nodes[oldParent].right = newParent;
+	}
+	else {
+		root = newParent;
+	}
+
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	FixUpwards(nodes[leaf].parent);
+}
+
+void BVH::RemoveLeaf(const int32_t leaf) {
+	if (leaf == root) {
+		root = BVH_NULL_NODE;
+		return;
+	}
+
+	const int32_t parent = nodes[leaf].parent;
+	const int32_t grandParent = nodes[parent].parent;
+	const int32_t sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+	// the sibling takes the parent's place
+	nodes[sibling].parent = grandParent;
+	FreeNode(parent);
+
+	if (grandParent == BVH_NULL_NODE) {
+		root = sibling;
+		return;
+	}
+
+	if (nodes[grandParent].left == parent)
+		nodes[grandParent].left = sibling;
+	else
+		nodes[grandParent].right = sibling;
+
+	FixUpwards(grandParent);
+}
+
+void BVH::FixUpwards(int32_t index) {
+	while (index != BVH_NULL_NODE) {
+		index = Balance(index);
+
+		Node& node = nodes[index];
+		node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+		SetUnion(node, nodes[node.left], nodes[node.right]);
+
+		index = node.parent;
+	}
+}
+
+/* Rotates the taller child up when the subtrees of a node differ in height by
+more than one. Returns the node now at the top of the subtree. */
+int32_t BVH::Balance(const int32_t iA) {
+	Node& A = nodes[iA];
+	if (A.IsLeaf() || A.height < 2)
+		return iA;
+
+	const int32_t iB = A.left;
+	const int32_t iC = A.right;
+	Node& B = nodes[iB];
+	Node& C = nodes[iC];
+
+	const int32_t balance = C.height - B.height;
+
+	auto replaceInParent = [&](const int32_t oldChild, const int32_t newChild, const int32_t parent) {
+		if (parent == BVH_NULL_NODE)
+			root = newChild;
+		else if (nodes[parent].left == oldChild)
+			nodes[parent].left = newChild;
+		else
+			nodes[parent].right = newChild;
+	};
+
+	// rotate C up
+	if (balance > 1) {
+		const int32_t iF = C.left;
+		const int32_t iG = C.right;
+		Node& F = nodes[iF];
+		Node& G = nodes[iG];
+
+		C.left = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+		replaceInParent(iA, iC, C.parent);
+
+		if (F.height > G.height) {
+			C.right = iF;
+			A.right = iG;
+			G.parent = iA;
+			SetUnion(A, B, G);
+			SetUnion(C, A, F);
+			A.height = 1 + std::max(B.height, G.height);
+			C.height = 1 + std::max(A.height, F.height);
+		}
+		else {
+			C.right = iG;
+			A.right = iF;
+			F.parent = iA;
+			SetUnion(A, B, F);
+			SetUnion(C, A, G);
+			A.height = 1 + std::max(B.height, F.height);
+			C.height = 1 + std::max(A.height, G.height);
+		}
+
+		return iC;
+	}
+
+	// rotate B up
+	if (balance < -1) {
+		const int32_t iD = B.left;
+		const int32_t iE = B.right;
+		Node& D = nodes[iD];
+		Node& E = nodes[iE];
+
+		B.left = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+		replaceInParent(iA, iB, B.parent);
+
+		if (D.height > E.height) {
+			B.right = iD;
+			A.left = iE;
+			E.parent = iA;
+			SetUnion(A, C, E);
+			SetUnion(B, A, D);
+			A.height = 1 + std::max(C.height, E.height);
+			B.height = 1 + std::max(A.height, D.height);
+		}
+		else {
+			B.right = iE;
+			A.left = iD;
+			D.parent = iA;
+			SetUnion(A, C, D);
+			SetUnion(B, A, E);
+			A.height = 1 + std::max(C.height, D.height);
+			B.height = 1 + std::max(A.height, E.height);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <Core/Core.h>
+#include <mutex>
+#include <shared_mutex>
+#include "Culling.h"
+
+#define BVH_NULL_NODE -1
+#define BVH_STACK_SIZE 128		// traversal stack, the tree is height balanced
+#define BVH_FAT_MARGIN 0.1f		// leaves only reinsert once their bounds leave the fat bounds
+
+/* Dynamic AABB tree over world bounds. Leaves keep fat bounds so small moves are
+free, larger ones reinsert the leaf and rebalance its ancestors with rotations.
+Proxies are leaf node indices and stay valid until removed. Queries take a shared
+lock and can run from any thread, edits take an exclusive one. */
+class BVH {
+public:
+	int32_t Insert(const Vec3& min, const Vec3& max, const uint32_t userData);
+	void Remove(const int32_t proxy);
+
+	/* Returns true when the leaf left its fat bounds and was reinserted. */
+	bool Update(const int32_t proxy, const Vec3& min, const Vec3& max);
+
+	/* Calls callback(userData) for every leaf at least partially inside the frustum. */
+	template <typename F>
+	void QueryFrustum(const Frustum& frustum, F&& callback) const;
+
+	template <typename F>
+	void QuerySphere(const Vec3& center, const float radius, F&& callback) const;
+
+	/* Calls callback(userData) for every leaf the ray hits before maxDistance. */
+	template <typename F>
+	void QueryRay(const Vec3& origin, const Vec3& direction, const float maxDistance, F&& callback) const;
+
+private:
+	struct Node {
+		Vec3 min{ 0.0f };
+		Vec3 max{ 0.0f };
+		int32_t parent = BVH_NULL_NODE;	// next free node while on the free list
+		int32_t left = BVH_NULL_NODE;
+		int32_t right = BVH_NULL_NODE;
+		int32_t height = -1;			// 0 for leaves, -1 for free nodes
+		uint32_t userData = 0;
+
+		bool IsLeaf() const { return left == BVH_NULL_NODE; }
+	};
+
+	std::vector<Node> nodes;
+	int32_t root = BVH_NULL_NODE;
+	int32_t freeList = BVH_NULL_NODE;
+	mutable std::shared_mutex mutex;
+
+	int32_t AllocateNode();
+	void FreeNode(const int32_t index);
+	void InsertLeaf(const int32_t leaf);
+	void RemoveLeaf(const int32_t leaf);
+	void FixUpwards(int32_t index);
+	int32_t Balance(const int32_t index);
+	void SetUnion(Node& node, const Node& a, const Node& b) const;
+};
+
+template <typename F>
+void BVH::QueryFrustum(const Frustum& frustum, F&& callback) const {
+	std::shared_lock lock(mutex);
+	if (root == BVH_NULL_NODE)
+		return;
+
+	const Plane* planes[6] = { &frustum.leftFace, &frustum.rightFace, &frustum.topFace,
+							   &frustum.bottomFace, &frustum.nearFace, &frustum.farFace };
+
+	// each entry carries the planes its bounds still cross, nodes inside all of them are accepted whole
+	std::pair<int32_t, uint8_t> stack[BVH_STACK_SIZE];
+	size_t size = 0;
+	stack[size++] = { root, 0x3F };
+
+	while (size > 0) {
+		auto [index, planeMask] = stack[--size];
+		const Node& node = nodes[index];
+
+		if (planeMask != 0) {
+			const Vec3 center = (node.min + node.max) * 0.5f;
+			const Vec3 extent = (node.max - node.min) * 0.5f;
+			bool outside = false;
+			for (uint32_t p = 0; p < 6; p++) {
+				if (!(planeMask & (1u << p)))
+					continue;
+
+				const float distance = glm::dot(planes[p]->normal, center) - planes[p]->distance;
+				const float radius = glm::dot(glm::abs(planes[p]->normal), extent);
+				if (distance + radius <= 0.0f) {
+					outside = true;
+					break;
+				}
+				if (distance - radius > 0.0f)
+					planeMask &= static_cast<uint8_t>(~(1u << p));
+			}
+
+			if (outside)
+				continue;
+		}
+
+		if (node.IsLeaf()) {
+			callback(node.userData);
+			continue;
+		}
+
+		assert(size + 2 <= BVH_STACK_SIZE && "BVH: Traversal stack overflow.");
+		stack[size++] = { node.left, planeMask };
+		stack[size++] = { node.right, planeMask };
+	}
+}
+
+template <typename F>
+void BVH::QuerySphere(const Vec3& center, const float radius, F&& callback) const {
+	std::shared_lock lock(mutex);
+	if (root == BVH_NULL_NODE)
+		return;
+
+	int32_t stack[BVH_STACK_SIZE];
+	size_t size = 0;
+	stack[size++] = root;
+
+	while (size > 0) {
+		const Node& node = nodes[stack[--size]];
+		const Vec3 closest = glm::clamp(center, node.min, node.max);
+		const Vec3 delta = closest - center;
+		if (glm::dot(delta, delta) > radius * radius)
+			continue;
+
+		if (node.IsLeaf()) {
+			callback(node.userData);
+			continue;
+		}
+
+		assert(size + 2 <= BVH_STACK_SIZE && "BVH: Traversal stack overflow.");
+		stack[size++] = node.left;
+		stack[size++] = node.right;
+	}
+}
+
+template <typename F>
+void BVH::QueryRay(const Vec3& origin, const Vec3& direction, const float maxDistance, F&& callback) const {
+	std::shared_lock lock(mutex);
+	if (root == BVH_NULL_NODE)
+		return;
+
+	// slab test, infinities from zero components compare correctly
+	const Vec3 invDir = 1.0f / direction;
+
+	int32_t stack[BVH_STACK_SIZE];
+	size_t size = 0;
+	stack[size++] = root;
+
+	while (size > 0) {
+		const Node& node = nodes[stack[--size]];
+		const Vec3 t0 = (node.min - origin) * invDir;
+		const Vec3 t1 = (node.max - origin) * invDir;
+		const Vec3 tMin = glm::min(t0, t1);
+		const Vec3 tMax = glm::max(t0, t1);
+		const float enter = std::max({ tMin.x, tMin.y, tMin.z, 0.0f });
+		const float exit = std::min({ tMax.x, tMax.y, tMax.z, maxDistance });
+		if (enter > exit)
+			continue;
+
+		if (node.IsLeaf()) {
+			callback(node.userData);
+			continue;
+		}
+
+		assert(size + 2 <= BVH_STACK_SIZE && "BVH: Traversal stack overflow.");
+		stack[size++] = node.left;
+		stack[size++] = node.right;
+	}
+}
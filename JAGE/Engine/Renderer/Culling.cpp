@@ -0,0 +1,156 @@
+#include "Culling.h"
+#include <immintrin.h>
+
+void BoundsSoA::Resize(const size_t count) {
+	const size_t padded = (count + CULL_BATCH_SIZE - 1) / CULL_BATCH_SIZE * CULL_BATCH_SIZE;
+	if (padded <= Size())
+		return;
+
+	for (std::vector<float>* v : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+		v->resize(padded, 0.0f);
+}
+
+void BoundsSoA::Set(const size_t index, const Vec3& min, const Vec3& max) {
+	const Vec3 center = (min + max) * 0.5f;
+	const Vec3 extent = (max - min) * 0.5f;
+
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	extentX[index] = extent.x;
+	extentY[index] = extent.y;
+	extentZ[index] = extent.z;
+}
+
+void Culling::TransformAABB(const Vec3& min, const Vec3& max, const Mat4& transform, Vec3& outMin, Vec3& outMax) {
+	const Vec3 center = Vec3(transform * Vec4((min + max) * 0.5f, 1.0f));
+	const Vec3 extent = (max - min) * 0.5f;
+
+	// each world axis gets the abs projection of the local extents (Arvo)
+	const glm::mat3 absRot = glm::mat3(glm::abs(Vec3(transform[0])), glm::abs(Vec3(transform[1])), glm::abs(Vec3(transform[2])));
+	const Vec3 worldExtent = absRot * extent;
+
+	outMin = center - worldExtent;
+	outMax = center + worldExtent;
+}
+
+Frustum Culling::FrustumFromMatrix(const Mat4& viewProj) {
+	// Gribb/Hartmann, each plane is the last row plus or minus another row
+	const Vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+	const Vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+	const Vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+	const Vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+	auto toPlane = [](const Vec4& p) {
+		const float length = glm::length(Vec3(p));
+		Plane plane;
+		plane.normal = Vec3(p) / length;
+		plane.distance = -p.w / length;
+		return plane;
+	};
+
+	Frustum frustum;
+	frustum.leftFace = toPlane(row3 + row0);
+	frustum.rightFace = toPlane(row3 - row0);
+	frustum.bottomFace = toPlane(row3 + row1);
+	frustum.topFace = toPlane(row3 - row1);
+	frustum.nearFace = toPlane(row3 + row2);
+	frustum.farFace = toPlane(row3 - row2);
+	return frustum;
+}
+
+bool Culling::IntersectsFrustum(const Frustum& frustum, const Vec3& center, const Vec3& extent) {
+	for (const Plane* plane : { &frustum.leftFace, &frustum.rightFace, &frustum.topFace,
+								&frustum.bottomFace, &frustum.nearFace, &frustum.farFace }) {
+		if (glm::dot(plane->normal, center) + glm::dot(glm::abs(plane->normal), extent) <= plane->distance)
+			return false;
+	}
+
+	return true;
+}
+
+void Culling::FrustumCull(const Frustum& frustum, const BoundsSoA& bounds, const size_t count, std::vector<uint8_t>& mask) {
+	const Plane* planes[6] = { &frustum.leftFace, &frustum.rightFace, &frustum.topFace,
+							   &frustum.bottomFace, &frustum.nearFace, &frustum.farFace };
+
+	const size_t batches = (count + CULL_BATCH_SIZE - 1) / CULL_BATCH_SIZE;
+	mask.resize(batches);
+	assert(batches * CULL_BATCH_SIZE <= bounds.Size() && "Culling: bounds are not padded to the batch size.");
+
+	// a box is outside a plane when dot(n, c) + dot(|n|, e) <= d
+#if defined(__AVX__)
+	__m256 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], d[6];
+	for (size_t p = 0; p < 6; p++) {
+		nx[p] = _mm256_set1_ps(planes[p]->normal.x);
+		ny[p] = _mm256_set1_ps(planes[p]->normal.y);
+		nz[p] = _mm256_set1_ps(planes[p]->normal.z);
+		ax[p] = _mm256_set1_ps(std::abs(planes[p]->normal.x));
+		ay[p] = _mm256_set1_ps(std::abs(planes[p]->normal.y));
+		az[p] = _mm256_set1_ps(std::abs(planes[p]->normal.z));
+		d[p]  = _mm256_set1_ps(planes[p]->distance);
+	}
+
+	for (size_t b = 0; b < batches; b++) {
+		const size_t i = b * CULL_BATCH_SIZE;
+		const __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+		const __m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+		const __m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+		const __m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+		const __m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+		const __m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (size_t p = 0; p < 6; p++) {
+			__m256 dist = _mm256_mul_ps(cx, nx[p]);
+			dist = _mm256_add_ps(dist, _mm256_mul_ps(cy, ny[p]));
+			dist = _mm256_add_ps(dist, _mm256_mul_ps(cz, nz[p]));
+			dist = _mm256_add_ps(dist, _mm256_mul_ps(ex, ax[p]));
+			dist = _mm256_add_ps(dist, _mm256_mul_ps(ey, ay[p]));
+			dist = _mm256_add_ps(dist, _mm256_mul_ps(ez, az[p]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, d[p], _CMP_GT_OQ));
+		}
+
+		mask[b] = static_cast<uint8_t>(_mm256_movemask_ps(inside));
+	}
+#else
+	// SSE path, each batch is two groups of four
+	__m128 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], d[6];
+	for (size_t p = 0; p < 6; p++) {
+		nx[p] = _mm_set1_ps(planes[p]->normal.x);
+		ny[p] = _mm_set1_ps(planes[p]->normal.y);
+		nz[p] = _mm_set1_ps(planes[p]->normal.z);
+		ax[p] = _mm_set1_ps(std::abs(planes[p]->normal.x));
+		ay[p] = _mm_set1_ps(std::abs(planes[p]->normal.y));
+		az[p] = _mm_set1_ps(std::abs(planes[p]->normal.z));
+		d[p]  = _mm_set1_ps(planes[p]->distance);
+	}
+
+	for (size_t b = 0; b < batches; b++) {
+		uint8_t bits = 0;
+		for (size_t half = 0; half < 2; half++) {
+			const size_t i = b * CULL_BATCH_SIZE + half * 4;
+			const __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+			const __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+			const __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+			const __m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+			const __m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+			const __m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (size_t p = 0; p < 6; p++) {
+				__m128 dist = _mm_mul_ps(cx, nx[p]);
+				dist = _mm_add_ps(dist, _mm_mul_ps(cy, ny[p]));
+				dist = _mm_add_ps(dist, _mm_mul_ps(cz, nz[p]));
+				dist = _mm_add_ps(dist, _mm_mul_ps(ex, ax[p]));
+				dist = _mm_add_ps(dist, _mm_mul_ps(ey, ay[p]));
+				dist = _mm_add_ps(dist, _mm_mul_ps(ez, az[p]));
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(dist, d[p]));
+			}
+
+			bits |= static_cast<uint8_t>(_mm_movemask_ps(inside) << (half * 4));
+		}
+
+		mask[b] = bits;
+	}
+#endif
+}
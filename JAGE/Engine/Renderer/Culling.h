@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Core/Core.h>
+
+// number of bounds tested per kernel iteration, one byte of visibility mask
+#define CULL_BATCH_SIZE 8
+
+struct Plane {
+	Vec3 normal = { 0.f, 1.f, 0.f };
+	float distance = 0.f;
+
+	Plane() = default;
+
+	Plane(const Vec3& p1, const Vec3& norm)
+		: normal(glm::normalize(norm)),
+		  distance(glm::dot(normal, p1)) {};
+
+	float getSignedDistanceToPlane(const glm::vec3& point) const
+	{
+		return glm::dot(normal, point) - distance;
+	}
+};
+
+struct Frustum {
+	Plane topFace;
+	Plane bottomFace;
+
+	Plane rightFace;
+	Plane leftFace;
+
+	Plane farFace;
+	Plane nearFace;
+};
+
+/* World space AABBs in SoA layout, stored as center and half extents so that
+a plane test is a dot product plus an abs dot product. Sized in whole batches. */
+struct BoundsSoA {
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+	void Resize(const size_t count);
+	void Set(const size_t index, const Vec3& min, const Vec3& max);
+	size_t Size() const { return centerX.size(); }
+};
+
+namespace Culling {
+	/* AABB of a local AABB after a transform. */
+	void TransformAABB(const Vec3& min, const Vec3& max, const Mat4& transform, Vec3& outMin, Vec3& outMax);
+
+	/* Planes of the clip volume of a projection * view matrix, facing inwards. */
+	Frustum FrustumFromMatrix(const Mat4& viewProj);
+
+	/* True when the box is at least partially inside the frustum, same rule as FrustumCull. */
+	bool IntersectsFrustum(const Frustum& frustum, const Vec3& center, const Vec3& extent);
+
+	/* Tests the first count bounds against the frustum, eight at a time. Bit i of
+	the mask is set when bounds i is at least partially inside. */
+	void FrustumCull(const Frustum& frustum, const BoundsSoA& bounds, const size_t count, std::vector<uint8_t>& mask);
+}
@@ -0,0 +1,152 @@
+#include "LightClusters.h"
+#include <algorithm>
+
+LightClusters::LightClusters(const uint32_t gridX, const uint32_t gridY, const uint32_t gridZ, const uint32_t maxLightsPerCluster)
+	: gridX(std::max(1u, gridX)), gridY(std::max(1u, gridY)), gridZ(std::max(1u, gridZ)), maxLightsPerCluster(maxLightsPerCluster) {
+	gridData.gridX = this->gridX;
+	gridData.gridY = this->gridY;
+	gridData.gridZ = this->gridZ;
+
+	clusterMin.resize(GetClusterCount());
+	clusterMax.resize(GetClusterCount());
+	ranges.resize(GetClusterCount());
+}
+
+void LightClusters::SetProjection(const Mat4& projection, const float nearPlane, const float farPlane) {
+	if (projection == this->projection && nearPlane == this->nearPlane && farPlane == this->farPlane)
+		return;
+
+	this->projection = projection;
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane;
+
+	const float logRatio = std::log(farPlane / nearPlane);
+	gridData.sliceScale = gridZ / logRatio;
+	gridData.sliceBias = -(gridZ * std::log(nearPlane)) / logRatio;
+
+	const Mat4 invProjection = glm::inverse(projection);
+	auto unproject = [&](const float x, const float y, const float z) {
+		const Vec4 p = invProjection * Vec4(x, y, z, 1.0f);
+		return Vec3(p) / p.w;
+	};
+
+	for (uint32_t y = 0; y < gridY; y++) {
+		for (uint32_t x = 0; x < gridX; x++) {
+			// the four corner rays of the tile, as points on the near and far clip planes
+			Vec3 rayNear[4];
+			Vec3 rayFar[4];
+			for (uint32_t corner = 0; corner < 4; corner++) {
+				const float ndcX = -1.0f + 2.0f * (x + (corner & 1)) / gridX;
+				const float ndcY = -1.0f + 2.0f * (y + (corner >> 1)) / gridY;
+				rayNear[corner] = unproject(ndcX, ndcY, -1.0f);
+				rayFar[corner] = unproject(ndcX, ndcY, 1.0f);
+			}
+
+			for (uint32_t z = 0; z < gridZ; z++) {
+				const float sliceNear = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z) / gridZ);
+				const float sliceFar = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z + 1) / gridZ);
+
+				Vec3 boundsMin(FLT_MAX);
+				Vec3 boundsMax(-FLT_MAX);
+				for (uint32_t corner = 0; corner < 4; corner++) {
+					const Vec3 ray = rayFar[corner] - rayNear[corner];
+					for (const float depth : { sliceNear, sliceFar }) {
+						const float t = (-depth - rayNear[corner].z) / ray.z;
+						const Vec3 p = rayNear[corner] + t * ray;
+						boundsMin = glm::min(boundsMin, p);
+						boundsMax = glm::max(boundsMax, p);
+					}
+				}
+
+				const uint32_t cluster = x + gridX * (y + gridY * z);
+				clusterMin[cluster] = boundsMin;
+				clusterMax[cluster] = boundsMax;
+			}
+		}
+	}
+}
+
+void LightClusters::Begin() {
+	pairs.clear();
+}
+
+void LightClusters::AddLight(const uint32_t lightIndex, const Vec3& viewCenter, const float radius) {
+	const float depth = -viewCenter.z;
+	const float depthMin = depth - radius;
+	const float depthMax = depth + radius;
+	if (depthMax < nearPlane || depthMin > farPlane)
+		return;
+
+	const uint32_t sliceMin = GetSlice(std::max(depthMin, nearPlane));
+	const uint32_t sliceMax = GetSlice(std::min(depthMax, farPlane));
+
+	// screen rect of the sphere's box, a sphere crossing the near plane may cover any tile
+	uint32_t tileMinX = 0, tileMinY = 0;
+	uint32_t tileMaxX = gridX - 1, tileMaxY = gridY - 1;
+	if (depthMin > nearPlane) {
+		Vec2 ndcMin(FLT_MAX);
+		Vec2 ndcMax(-FLT_MAX);
+		for (uint32_t corner = 0; corner < 8; corner++) {
+			const Vec3 offset((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius);
+			const Vec4 clip = projection * Vec4(viewCenter + offset, 1.0f);
+			const Vec2 ndc = Vec2(clip) / clip.w;
+			ndcMin = glm::min(ndcMin, ndc);
+			ndcMax = glm::max(ndcMax, ndc);
+		}
+
+		if (ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f)
+			return;
+
+		auto toTile = [](const float ndc, const uint32_t tiles) {
+			return static_cast<uint32_t>(std::clamp((ndc * 0.5f + 0.5f) * tiles, 0.0f, static_cast<float>(tiles - 1)));
+		};
+		tileMinX = toTile(ndcMin.x, gridX);
+		tileMaxX = toTile(ndcMax.x, gridX);
+		tileMinY = toTile(ndcMin.y, gridY);
+		tileMaxY = toTile(ndcMax.y, gridY);
+	}
+
+	const float radiusSq = radius * radius;
+	for (uint32_t z = sliceMin; z <= sliceMax; z++) {
+		for (uint32_t y = tileMinY; y <= tileMaxY; y++) {
+			for (uint32_t x = tileMinX; x <= tileMaxX; x++) {
+				const uint32_t cluster = x + gridX * (y + gridY * z);
+				const Vec3 closest = glm::clamp(viewCenter, clusterMin[cluster], clusterMax[cluster]);
+				const Vec3 d = closest - viewCenter;
+				if (glm::dot(d, d) <= radiusSq)
+					pairs.emplace_back(cluster, lightIndex);
+			}
+		}
+	}
+}
+
+uint32_t LightClusters::End() {
+	std::sort(pairs.begin(), pairs.end());
+
+	std::fill(ranges.begin(), ranges.end(), LightClusterRange{});
+	lightIndices.clear();
+
+	uint32_t dropped = 0;
+	for (size_t i = 0; i < pairs.size();) {
+		const uint32_t cluster = pairs[i].first;
+		LightClusterRange& range = ranges[cluster];
+		range.offset = static_cast<GLuint>(lightIndices.size());
+
+		for (; i < pairs.size() && pairs[i].first == cluster; i++) {
+			if (range.count < maxLightsPerCluster) {
+				lightIndices.push_back(pairs[i].second);
+				range.count++;
+			}
+			else {
+				dropped++;
+			}
+		}
+	}
+
+	return dropped;
+}
+
+uint32_t LightClusters::GetSlice(const float viewDepth) const {
+	const float slice = std::floor(std::log(viewDepth) * gridData.sliceScale + gridData.sliceBias);
+	return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(gridZ - 1)));
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Core/Core.h>
+
+/* Grid layout read by the lighting shader, std140. */
+struct LightClusterGridData {
+	GLuint gridX = 0;
+	GLuint gridY = 0;
+	GLuint gridZ = 0;
+	GLuint padding0 = 0;
+	float  sliceScale = 0.0f;	// slice = log(view depth) * scale + bias
+	float  sliceBias = 0.0f;
+	float  padding1[2];
+};
+
+/* Where a cluster's lights start in the index list and how many there are, std430. */
+struct LightClusterRange {
+	GLuint offset = 0;
+	GLuint count = 0;
+};
+
+/* View space froxel grid: screen tiles in x and y, exponential depth slices in z between
+the camera planes. Lights are added as view space spheres and every cluster gets a compact
+list of the lights touching it, capped so that the cost per pixel stays bounded. */
+class LightClusters {
+public:
+	LightClusters() = default;
+	LightClusters(const uint32_t gridX, const uint32_t gridY, const uint32_t gridZ, const uint32_t maxLightsPerCluster);
+
+	/* Recomputes the cluster bounds when the projection or the depth range changed. */
+	void SetProjection(const Mat4& projection, const float nearPlane, const float farPlane);
+
+	void Begin();
+	void AddLight(const uint32_t lightIndex, const Vec3& viewCenter, const float radius);
+
+	/* Packs the lists added since Begin, returns the number of lights dropped by the cap. */
+	uint32_t End();
+
+	const LightClusterGridData& GetGridData() const { return gridData; }
+	const std::vector<LightClusterRange>& GetRanges() const { return ranges; }
+	const std::vector<GLuint>& GetLightIndices() const { return lightIndices; }
+	uint32_t GetClusterCount() const { return gridX * gridY * gridZ; }
+	uint32_t GetMaxLightsPerCluster() const { return maxLightsPerCluster; }
+
+private:
+	uint32_t gridX = 0;
+	uint32_t gridY = 0;
+	uint32_t gridZ = 0;
+	uint32_t maxLightsPerCluster = 0;
+
+	Mat4 projection{ 0.0f };
+	float nearPlane = 0.0f;
+	float farPlane = 0.0f;
+	LightClusterGridData gridData;
+
+	// view space bounds of every cluster, x fastest then y then z
+	std::vector<Vec3> clusterMin;
+	std::vector<Vec3> clusterMax;
+
+	std::vector<std::pair<uint32_t, uint32_t>> pairs;	// cluster, light index
+	std::vector<LightClusterRange> ranges;
+	std::vector<GLuint> lightIndices;
+
+	uint32_t GetSlice(const float viewDepth) const;
+};
@@ -0,0 +1,210 @@
+#include "OcclusionBuffer.h"
+#include <execution>
+#include <numeric>
+#include <immintrin.h>
+
+// vertices this close to the eye plane are not projected, the triangle is skipped
+constexpr float OCCLUSION_MIN_W = 1e-4f;
+
+OcclusionBuffer::OcclusionBuffer(const uint32_t width, const uint32_t height) {
+	tilesX = std::max(1u, (width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH);
+	tilesY = std::max(1u, (height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT);
+	this->width = tilesX * OCCLUSION_TILE_WIDTH;
+	this->height = tilesY * OCCLUSION_TILE_HEIGHT;
+
+	depth.assign(static_cast<size_t>(this->width) * this->height, 1.0f);
+	tileMaxDepth.assign(static_cast<size_t>(tilesX) * tilesY, 1.0f);
+}
+
+void OcclusionBuffer::Clear(const Mat4& viewProj) {
+	this->viewProj = viewProj;
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	std::fill(tileMaxDepth.begin(), tileMaxDepth.end(), 1.0f);
+}
+
+uint32_t OcclusionBuffer::RenderOccluder(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const Mat4& model) {
+	const Mat4 mvp = viewProj * model;
+
+	// screen x, y and depth, w <= 0 marks vertices behind the eye
+	std::vector<Vec4> screen(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		const Vec4 clip = mvp * Vec4(vertices[i].Position, 1.0f);
+		if (clip.w <= OCCLUSION_MIN_W) {
+			screen[i].w = 0.0f;
+			continue;
+		}
+
+		const Vec3 ndc = Vec3(clip) / clip.w;
+		screen[i] = Vec4((ndc.x * 0.5f + 0.5f) * width,
+						 (ndc.y * 0.5f + 0.5f) * height,
+						 std::clamp(ndc.z * 0.5f + 0.5f, 0.0f, 1.0f),
+						 1.0f);
+	}
+
+	uint32_t triangles = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		const Vec4& a = screen[indices[i]];
+		const Vec4& b = screen[indices[i + 1]];
+		const Vec4& c = screen[indices[i + 2]];
+
+		// near plane crossing triangles are dropped, which only makes the culling less aggressive
+		if (a.w == 0.0f || b.w == 0.0f || c.w == 0.0f)
+			continue;
+
+		RasterizeTriangle(Vec3(a), Vec3(b), Vec3(c));
+		triangles++;
+	}
+
+	return triangles;
+}
+
+void OcclusionBuffer::RasterizeTriangle(Vec3 a, Vec3 b, Vec3 c) {
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (std::abs(area) < 1e-6f)
+		return;
+
+	// both windings are drawn, flip clockwise ones so inside is positive
+	if (area < 0.0f) {
+		std::swap(b, c);
+		area = -area;
+	}
+
+	int32_t minX = std::max(0, static_cast<int32_t>(std::floor(std::min({ a.x, b.x, c.x }))));
+	int32_t maxX = std::min(static_cast<int32_t>(width) - 1, static_cast<int32_t>(std::floor(std::max({ a.x, b.x, c.x }))));
+	int32_t minY = std::max(0, static_cast<int32_t>(std::floor(std::min({ a.y, b.y, c.y }))));
+	int32_t maxY = std::min(static_cast<int32_t>(height) - 1, static_cast<int32_t>(std::floor(std::max({ a.y, b.y, c.y }))));
+	if (minX > maxX || minY > maxY)
+		return;
+
+	// rows are walked in groups of four, the width is a multiple of four
+	minX &= ~3;
+
+	// edge functions E(x, y) = A * x + B * y + C, each one weights the opposite vertex
+	const float A0 = b.y - c.y, B0 = c.x - b.x, C0 = b.x * c.y - c.x * b.y;
+	const float A1 = c.y - a.y, B1 = a.x - c.x, C1 = c.x * a.y - a.x * c.y;
+	const float A2 = a.y - b.y, B2 = b.x - a.x, C2 = a.x * b.y - b.x * a.y;
+
+	// depth is linear in screen space after the divide
+	const float invArea = 1.0f / area;
+	const float zA = (A0 * a.z + A1 * b.z + A2 * c.z) * invArea;
+	const float zB = (B0 * a.z + B1 * b.z + B2 * c.z) * invArea;
+	const float zC = (C0 * a.z + C1 * b.z + C2 * c.z) * invArea;
+
+	const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 a0 = _mm_set1_ps(A0), a1 = _mm_set1_ps(A1), a2 = _mm_set1_ps(A2), az = _mm_set1_ps(zA);
+
+	for (int32_t y = minY; y <= maxY; y++) {
+		const float py = static_cast<float>(y) + 0.5f;
+		const __m128 row0 = _mm_set1_ps(B0 * py + C0);
+		const __m128 row1 = _mm_set1_ps(B1 * py + C1);
+		const __m128 row2 = _mm_set1_ps(B2 * py + C2);
+		const __m128 rowZ = _mm_set1_ps(zB * py + zC);
+		float* row = &depth[static_cast<size_t>(y) * width];
+
+		for (int32_t x = minX; x <= maxX; x += 4) {
+			const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+			const __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), row0);
+			const __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), row1);
+			const __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), row2);
+			const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+
+			const __m128 z = _mm_add_ps(_mm_mul_ps(az, px), rowZ);
+			const __m128 old = _mm_loadu_ps(row + x);
+			const __m128 nearest = _mm_min_ps(old, z);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+		}
+	}
+}
+
+void OcclusionBuffer::UpdateTiles() {
+	for (uint32_t ty = 0; ty < tilesY; ty++) {
+		for (uint32_t tx = 0; tx < tilesX; tx++) {
+			__m128 farthest = _mm_setzero_ps();
+			for (uint32_t y = 0; y < OCCLUSION_TILE_HEIGHT; y++) {
+				const float* row = &depth[static_cast<size_t>(ty * OCCLUSION_TILE_HEIGHT + y) * width + tx * OCCLUSION_TILE_WIDTH];
+				for (uint32_t x = 0; x < OCCLUSION_TILE_WIDTH; x += 4)
+					farthest = _mm_max_ps(farthest, _mm_loadu_ps(row + x));
+			}
+
+			alignas(16) float lanes[4];
+			_mm_store_ps(lanes, farthest);
+			tileMaxDepth[static_cast<size_t>(ty) * tilesX + tx] = std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+		}
+	}
+}
+
+bool OcclusionBuffer::IsOccluded(const Vec3& center, const Vec3& extent) const {
+	float minX = std::numeric_limits<float>::max();
+	float minY = std::numeric_limits<float>::max();
+	float maxX = std::numeric_limits<float>::lowest();
+	float maxY = std::numeric_limits<float>::lowest();
+	float nearest = 1.0f;
+
+	for (uint32_t i = 0; i < 8; i++) {
+		const Vec3 corner = center + extent * Vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+		const Vec4 clip = viewProj * Vec4(corner, 1.0f);
+		if (clip.w <= OCCLUSION_MIN_W)
+			return false;
+
+		const Vec3 ndc = Vec3(clip) / clip.w;
+		minX = std::min(minX, (ndc.x * 0.5f + 0.5f) * width);
+		maxX = std::max(maxX, (ndc.x * 0.5f + 0.5f) * width);
+		minY = std::min(minY, (ndc.y * 0.5f + 0.5f) * height);
+		maxY = std::max(maxY, (ndc.y * 0.5f + 0.5f) * height);
+		nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+	}
+
+	if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+		return false;
+
+	const uint32_t x0 = static_cast<uint32_t>(std::max(0.0f, std::floor(minX)));
+	const uint32_t y0 = static_cast<uint32_t>(std::max(0.0f, std::floor(minY)));
+	const uint32_t x1 = std::min(width - 1, static_cast<uint32_t>(std::floor(maxX)));
+	const uint32_t y1 = std::min(height - 1, static_cast<uint32_t>(std::floor(maxY)));
+
+	for (uint32_t ty = y0 / OCCLUSION_TILE_HEIGHT; ty <= y1 / OCCLUSION_TILE_HEIGHT; ty++) {
+		for (uint32_t tx = x0 / OCCLUSION_TILE_WIDTH; tx <= x1 / OCCLUSION_TILE_WIDTH; tx++) {
+			// the whole tile is nearer than the bounds
+			if (tileMaxDepth[static_cast<size_t>(ty) * tilesX + tx] < nearest)
+				continue;
+
+			const uint32_t px0 = std::max(x0, tx * OCCLUSION_TILE_WIDTH);
+			const uint32_t px1 = std::min(x1, tx * OCCLUSION_TILE_WIDTH + OCCLUSION_TILE_WIDTH - 1);
+			const uint32_t py0 = std::max(y0, ty * OCCLUSION_TILE_HEIGHT);
+			const uint32_t py1 = std::min(y1, ty * OCCLUSION_TILE_HEIGHT + OCCLUSION_TILE_HEIGHT - 1);
+			for (uint32_t y = py0; y <= py1; y++)
+				for (uint32_t x = px0; x <= px1; x++)
+					if (depth[static_cast<size_t>(y) * width + x] >= nearest)
+						return false;
+		}
+	}
+
+	return true;
+}
+
+void OcclusionBuffer::CullBounds(const BoundsSoA& bounds, const size_t count, std::vector<uint8_t>& mask) {
+	const size_t batches = (count + CULL_BATCH_SIZE - 1) / CULL_BATCH_SIZE;
+	if (batchIndices.size() < batches) {
+		batchIndices.resize(batches);
+		std::iota(batchIndices.begin(), batchIndices.end(), 0u);
+	}
+
+	// every batch owns one mask byte, so they can run on any thread
+	std::for_each(std::execution::par, batchIndices.begin(), batchIndices.begin() + batches, [&](const uint32_t batch) {
+		uint8_t bits = mask[batch];
+		for (uint32_t lane = 0; lane < CULL_BATCH_SIZE; lane++) {
+			if (!(bits & (1u << lane)))
+				continue;
+
+			const size_t i = static_cast<size_t>(batch) * CULL_BATCH_SIZE + lane;
+			const Vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+			const Vec3 extent(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+			if (IsOccluded(center, extent))
+				bits &= static_cast<uint8_t>(~(1u << lane));
+		}
+		mask[batch] = bits;
+	});
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Core/Core.h>
+#include <Core/Assets/Mesh.h>
+#include "Culling.h"
+
+// pixels per tile, a tile row is a whole number of SIMD groups
+#define OCCLUSION_TILE_WIDTH 8
+#define OCCLUSION_TILE_HEIGHT 4
+
+/* Low resolution depth buffer that occluder meshes are rasterized into on the CPU.
+Depth is z/w mapped to [0, 1]. Each tile also keeps the farthest depth it holds,
+so most bounds are accepted or rejected without looking at single pixels. */
+class OcclusionBuffer {
+public:
+	OcclusionBuffer() = default;
+	OcclusionBuffer(const uint32_t width, const uint32_t height);
+
+	void Clear(const Mat4& viewProj);
+
+	/* Rasterizes a mesh with the given model matrix, returns the number of triangles drawn. */
+	uint32_t RenderOccluder(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const Mat4& model);
+
+	/* Call after the last occluder, before testing bounds. */
+	void UpdateTiles();
+
+	bool IsOccluded(const Vec3& center, const Vec3& extent) const;
+
+	/* Clears the mask bit of every bounds hidden behind the occluders, batches run in parallel. */
+	void CullBounds(const BoundsSoA& bounds, const size_t count, std::vector<uint8_t>& mask);
+
+private:
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t tilesX = 0;
+	uint32_t tilesY = 0;
+	Mat4 viewProj{ 1.0f };
+
+	std::vector<float> depth;
+	std::vector<float> tileMaxDepth;
+	std::vector<uint32_t> batchIndices;
+
+	void RasterizeTriangle(Vec3 a, Vec3 b, Vec3 c);
+};
@@ -6,6 +6,8 @@
 #include <Core/Assets/AssetManager.h>
 #include <Core/Log/LogDisplay.h>
 #include <Core/Config.h>
+#include <Core/Profiler.h>
+#include <bit>
 #include "ShaderPreProcessor.h"
 #include "Core/Utils.h"
 #include <physx/PxPhysicsAPI.h>
@@ -15,6 +17,27 @@ using namespace physx;
 
 void EnableOpenGLDebugOutput();
 
+static bool HasGLExtension(const std::string_view name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++) {
+		if (name == reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)))
+			return true;
+	}
+
+	return false;
+}
+
+static const char* PointShadowPathName(const PointShadowPath path) {
+	switch (path) {
+	case PointShadowPath::GeometryShader:	return "geometry";
+	case PointShadowPath::Layered:			return "layered";
+	case PointShadowPath::PerFace:			return "per_face";
+	}
+
+	return "unknown";
+}
+
 bool OpenGlApi::Initialize() {
 
 	EnableOpenGLDebugOutput();
@@ -37,14 +60,43 @@ bool OpenGlApi::Initialize() {
 	vBlurShadowMapShader      = Shader(spp.GetCodeStr("screen.vert"),
 								       spp.GetCodeStr("gaussian_blur_v.frag"));
 	shadowMapShader           = Shader(spp.GetCodeStr("csm.vert"),
-							           spp.GetCodeStr("csm.frag"),
-							           spp.GetCodeStr("csm.geom"));
+							           spp.GetCodeStr("csm.frag"));
 	ssaoShader                = Shader(spp.GetCodeStr("ssao.vert"),
 					                   spp.GetCodeStr("ssao.frag"));
 	ssaoBlurShader            = Shader(spp.GetCodeStr("ssao.vert"),
 							           spp.GetCodeStr("ssao_blur.frag"));
 	postFxShader              = Shader(spp.GetCodeStr("screen.vert"),
 						               spp.GetCodeStr("post_fx.frag"));
+	pointLightShadowFaceShader = Shader(spp.GetCodeStr("point_shadow_map_face.vert"),
+										spp.GetCodeStr("point_shadow_map.frag"));
+	cullShader                = Shader(spp.GetCodeStr("cull.comp"));
+	drawCompactShader         = Shader(spp.GetCodeStr("draw_compact.comp"));
+	hiZBuildShader            = Shader(spp.GetCodeStr("hiz_build.comp"));
+
+	// catch renamed uniforms and drifting block bindings at startup
+	gBufferShader.RequireBlock("MeshInstanceDataArray", SSBO_MESH_INSTANCE_DATA);
+	gBufferShader.RequireBlock("DrawCmdsDataArray", SSBO_MESH_INDIRECT_DRAW_COMMAND);
+	gBufferShader.RequireBlock("VisibleInstanceSlots", SSBO_VISIBLE_INSTANCE_SLOTS);
+	lightingShader.RequireUniforms({ "cascadeCount" });
+	lightingShader.RequireBlock("CascadeDataArray", UBO_SHADOW_CASCADE_DATA);
+	lightingShader.RequireBlock("LightClusterGrid", UBO_LIGHT_CLUSTER_DATA);
+	lightingShader.RequireBlock("LightClusters", SSBO_LIGHT_CLUSTERS);
+	lightingShader.RequireBlock("LightIndices", SSBO_LIGHT_INDICES);
+	pointLightShadowMapShader.RequireUniforms({ "uPointLightIndex" });
+	pointLightShadowMapShader.RequireBlock("PointLightDataArray", SSBO_POINT_LIGHT_DATA_ARRAY);
+	pointLightShadowMapShader.RequireBlock("ShadowCasterSlots", SSBO_SHADOW_CASTER_SLOTS);
+	shadowMapShader.RequireUniforms({ "uCascadeIndex" });
+	shadowMapShader.RequireBlock("CascadeDataArray", UBO_SHADOW_CASCADE_DATA);
+	shadowMapShader.RequireBlock("ShadowCasterSlots", SSBO_SHADOW_CASTER_SLOTS);
+	pointLightShadowFaceShader.RequireUniforms({ "uPointLightIndex" });
+	pointLightShadowFaceShader.RequireBlock("ShadowCasterSlots", SSBO_SHADOW_CASTER_SLOTS);
+	ssaoShader.RequireBlock("SSAO_SettingsData", UBO_SSAO_SETTINGS_DATA);
+	postFxShader.RequireUniforms({ "uGamma" });
+	cullShader.RequireUniforms({ "uSlotCount", "uFrustumPlanes", "uHiZEnabled", "uHiZViewProj", "uHiZLevels", "uCameraPosition", "uLodFactor" });
+	cullShader.RequireBlock("DrawCmdsSourceArray", SSBO_MESH_DRAW_COMMAND_SOURCE);
+	drawCompactShader.RequireUniforms({ "uDrawCmdCount" });
+	drawCompactShader.RequireBlock("DrawCount", SSBO_MESH_DRAW_COUNT);
+	hiZBuildShader.RequireUniforms({ "uSourceLevel", "uCopy" });
 
 	meshVBO = VertexArrayBuffer(
 		5000 * cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_meshes", 10000), 
@@ -52,32 +104,96 @@ bool OpenGlApi::Initialize() {
 	meshEBO = ElementArrayBuffer(
 		3 * 5000 * cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_meshes", 10000), 
 		GL_DYNAMIC_STORAGE_BIT);
-	meshDIB = DrawIndirectBuffer(
+	meshDIB = StreamingBuffer(
+		GL_DRAW_INDIRECT_BUFFER,
 		SSBO_MESH_INDIRECT_DRAW_COMMAND, 
-		cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_meshes", 10000) * sizeof(MeshDrawCmdData), 
-		GL_DYNAMIC_STORAGE_BIT);
+		cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_meshes", 10000) * sizeof(MeshDrawCmdData));
 
-	meshSSBO = ShaderStorageBuffer(
+	maxMeshInstances = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_mesh_instances", 20000);
+	meshInstanceSSBO = ShaderStorageBuffer(
 		SSBO_MESH_INSTANCE_DATA, 
-		cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_meshes", 10000) * sizeof(MeshInstanceData));
+		maxMeshInstances * sizeof(MeshInstanceData));
+	visibleSlotsSSBO = StreamingBuffer(
+		GL_SHADER_STORAGE_BUFFER,
+		SSBO_VISIBLE_INSTANCE_SLOTS, 
+		maxMeshInstances * sizeof(GLuint));
+
+	drawCmdSourceSSBO = StreamingBuffer(
+		GL_SHADER_STORAGE_BUFFER,
+		SSBO_MESH_DRAW_COMMAND_SOURCE,
+		cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_meshes", 10000) * sizeof(MeshDrawCmdData));
+	// every lod of a mesh reserves room for all of its instances
+	gpuVisibleSlotsSSBO = ShaderStorageBuffer(
+		SSBO_VISIBLE_INSTANCE_SLOTS, 
+		MESH_MAX_LODS * maxMeshInstances * sizeof(GLuint), 
+		0);
+	gpuMeshDIB = DrawIndirectBuffer(
+		SSBO_MESH_INDIRECT_DRAW_COMMAND,
+		MESH_MAX_LODS * cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_meshes", 10000) * sizeof(MeshDrawCmdData),
+		0);
+	drawCountBuffer = ParameterBuffer(SSBO_MESH_DRAW_COUNT, sizeof(GLuint));
+	shadowCasterSlotsSSBO = StreamingBuffer(
+		GL_SHADER_STORAGE_BUFFER,
+		SSBO_SHADOW_CASTER_SLOTS,
+		maxMeshInstances * sizeof(GLuint));
+	shadowCasterDIB = StreamingBuffer(
+		GL_DRAW_INDIRECT_BUFFER,
+		SSBO_SHADOW_CASTER_DRAW_COMMAND,
+		cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_meshes", 10000) * sizeof(MeshDrawCmdData));
+	cascadeCasterSlotsSSBO = StreamingBuffer(
+		GL_SHADER_STORAGE_BUFFER,
+		SSBO_SHADOW_CASTER_SLOTS,
+		maxMeshInstances * sizeof(GLuint));
+	cascadeCasterDIB = StreamingBuffer(
+		GL_DRAW_INDIRECT_BUFFER,
+		SSBO_SHADOW_CASTER_DRAW_COMMAND,
+		cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_meshes", 10000) * sizeof(MeshDrawCmdData));
 	textureHndlrsSSBO = ShaderStorageBuffer(
 		SSBO_TEXTURE_HANDLERS, 
 		cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_textures", 10000) * sizeof(GLuint64));
+	maxPointLights = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_point_lights", 512);
+	maxShadowedPointLights = std::min(maxPointLights, cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_shadowed_point_lights", 8));
+	lightAttenuationCutoff = cfg::Rendering.Read<float>("OpenGL", "opengl.lights.attenuation_cutoff", 0.01f);
 	pointLightDataArraySSBO = ShaderStorageBuffer(
 		SSBO_POINT_LIGHT_DATA_ARRAY, 
-		cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_point_lights", 8) * sizeof(PointLightData));
+		maxPointLights * sizeof(PointLightData));
+
+	lightClusters = LightClusters(cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.clusters.x", 16),
+								  cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.clusters.y", 9),
+								  cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.clusters.z", 24),
+								  cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.clusters.max_lights", 64));
+	lightClusterDataUBO = StreamingBuffer(GL_UNIFORM_BUFFER, UBO_LIGHT_CLUSTER_DATA, sizeof(LightClusterGridData));
+	lightClustersSSBO = StreamingBuffer(
+		GL_SHADER_STORAGE_BUFFER,
+		SSBO_LIGHT_CLUSTERS,
+		lightClusters.GetClusterCount() * sizeof(LightClusterRange));
+	lightIndicesSSBO = StreamingBuffer(
+		GL_SHADER_STORAGE_BUFFER,
+		SSBO_LIGHT_INDICES,
+		lightClusters.GetClusterCount() * sizeof(GLuint) * 4);
 	
-	cameraDataUBO     = UniformBuffer(UBO_CAMERA_DATA, sizeof(CameraData));
-	sceneLightDataUBO = UniformBuffer(UBO_SCENE_LIGHT_DATA, sizeof(SceneLightData), GL_DYNAMIC_STORAGE_BIT);
-	cascadeDataUBO    = UniformBuffer(UBO_SHADOW_CASCADE_DATA, SHADOW_MAP_MAX_CASCADES * sizeof(CascadeData), GL_DYNAMIC_STORAGE_BIT);
+	cameraDataUBO     = StreamingBuffer(GL_UNIFORM_BUFFER, UBO_CAMERA_DATA, sizeof(CameraData));
+	sceneLightDataUBO = StreamingBuffer(GL_UNIFORM_BUFFER, UBO_SCENE_LIGHT_DATA, sizeof(SceneLightData));
+	cascadeDataUBO    = StreamingBuffer(GL_UNIFORM_BUFFER, UBO_SHADOW_CASCADE_DATA, SHADOW_MAP_MAX_CASCADES * sizeof(CascadeData));
 
 	meshVAO = VertexArray();
-	std::vector<VertexAttrib> meshVAOAttribs = {
-		{ 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position) },
-		{ 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal) },
-		{ 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords) }
-	};
-	meshVAO.Configure(meshVBO.GetID(), sizeof(Vertex), meshEBO.GetID(), meshVAOAttribs);
+	compactVertices = cfg::Rendering.Read<bool>("OpenGL", "opengl.mesh.compact_vertices", true);
+	if (compactVertices) {
+		std::vector<VertexAttrib> meshVAOAttribs = {
+			{ 0, 3, GL_FLOAT, GL_FALSE, offsetof(PackedVertex, position) },
+			{ 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertex, normal) },
+			{ 2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, texCoords) }
+		};
+		meshVAO.Configure(meshVBO.GetID(), sizeof(PackedVertex), meshEBO.GetID(), meshVAOAttribs);
+	}
+	else {
+		std::vector<VertexAttrib> meshVAOAttribs = {
+			{ 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position) },
+			{ 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal) },
+			{ 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords) }
+		};
+		meshVAO.Configure(meshVBO.GetID(), sizeof(Vertex), meshEBO.GetID(), meshVAOAttribs);
+	}
 
 
 	screenQuadVBO = VertexArrayBuffer(sizeof(quadVertices), GL_DYNAMIC_STORAGE_BIT);
@@ -92,12 +208,49 @@ bool OpenGlApi::Initialize() {
 	};
 	screenQuadVAO.Configure(screenQuadVBO.GetID(), 4 * sizeof(float), screenQuadEBO.GetID(), screenVAOAttribs);
 
+	shadowCascadeCount = std::clamp(cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.cascade_count", 4), 1u, static_cast<uint32_t>(SHADOW_MAP_MAX_CASCADES));
+	shadowMapResolution = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512);
+
+	// the first cascades are redrawn every frame, the interval doubles for each one after them
+	const uint32_t fullRateCascades = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.cascade_full_rate", 2);
+	const uint32_t maxCascadeInterval = std::max(1u, cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.cascade_max_interval", 4));
+	cascadeUpdates.assign(shadowCascadeCount, CascadeUpdateData());
+	for (uint32_t i = fullRateCascades; i < shadowCascadeCount; i++)
+		cascadeUpdates[i].interval = std::min(maxCascadeInterval, 2u << std::min(i - fullRateCascades, 30u));
+
 	InitGBuffer();
+	InitHiZ();
 	InitShadowMapFBOs();
 	InitLightingFBO();
 	InitPostFxFBO();
 	InitSSAOUniformBuffer();
 
+	staticCasterFrames = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.static_caster_frames", 60);
+	InitPointShadowPaths(spp);
+	gammaCfg = cfg::Rendering.GetHandle<float>("Video", "video.gamma", 2.2f);
+	gpuCullingCfg = cfg::Rendering.GetHandle<bool>("OpenGL", "opengl.culling.gpu", true);
+	hiZCfg = cfg::Rendering.GetHandle<bool>("OpenGL", "opengl.culling.hiz", false);
+	occlusionCullingCfg = cfg::Rendering.GetHandle<bool>("OpenGL", "opengl.culling.occlusion", false);
+	bvhCullingCfg = cfg::Rendering.GetHandle<bool>("OpenGL", "opengl.culling.bvh", true);
+	lodPixelErrorCfg = cfg::Rendering.GetHandle<float>("OpenGL", "opengl.lod.pixel_error", 1.0f);
+	lodShadowPixelErrorCfg = cfg::Rendering.GetHandle<float>("OpenGL", "opengl.lod.shadow_pixel_error", 4.0f);
+	maxOccluderTriangles = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.occlusion.max_triangles", 20000);
+	occlusionBuffer = OcclusionBuffer(cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.occlusion.resX", 256),
+									  cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.occlusion.resY", 128));
+	cfg::Rendering.Subscribe([this]() { UpdateSSAOSettings(); });
+
+	TextureStreamSettings streamSettings;
+	streamSettings.threads = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.textures.stream.threads", 2);
+	streamSettings.uploadBudget = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.textures.stream.upload_budget_kb", 4096) * 1024ll;
+	streamSettings.memoryBudget = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.textures.stream.memory_budget_mb", 512) * 1024ull * 1024ull;
+	streamSettings.tailSize = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.textures.stream.tail_size", 64);
+	streamSettings.idleFrames = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.textures.stream.idle_frames", 300);
+	streamSettings.mipBias = cfg::Rendering.Read<float>("OpenGL", "opengl.textures.stream.mip_bias", 0.0f);
+	textureStreamer.Start(streamSettings, [this](const uint32_t handleIndex, const GLuint64 handle) {
+		tex2DHndlrDataArray[handleIndex] = handle;
+		textureHndlrsSSBO.UpdateData(handleIndex * sizeof(GLuint64), sizeof(GLuint64), &handle);
+	});
+
 	SetFaceCullEnabled(true);
 	SetDepthEnabled(true);
 
@@ -202,104 +355,75 @@ std::vector<Vec4> OpenGlApi::GetFrustumCornersWorldSpace(const float fov, const
 	return corners;
 }
 
-Mat4 OpenGlApi::GetLightViewMatrix(const Vec3& lightDir, const std::vector<Vec4>& frustumCorners) {
-	Vec3 center = Vec3(0.0f); // center of light frustum
-	for (const auto& v : frustumCorners) {
-		center += Vec3(v);
-	}
-
-	center /= (float)frustumCorners.size();
-
-	Vec3 normalizedLightDir = glm::normalize(lightDir);
-	float pitch = glm::asin(normalizedLightDir.y);
-	float yaw = glm::atan(normalizedLightDir.x, normalizedLightDir.z);
-
-	Mat4 view = Mat4(1.0f);
-	Mat4 translate = glm::translate(view, -(center - lightDir));
-	Mat4 rotYaw = glm::rotate(view, -yaw, { 0.0f, 1.0f, 0.0f });
-	Mat4 rotPitch = glm::rotate(view, -pitch, { 1.0f, 0.0f, 0.0f });
-	return rotPitch * rotYaw * translate;
-}
-
 void OpenGlApi::UpdateCameraFrustum(const Transform* transform)
 {
 	float aspect = currentActiveCamera->aspectRatio;
 	float zNear = currentActiveCamera->nearPlane;
 	float zFar = currentActiveCamera->farPlane;
 
-	const float halfVSide = zFar * tanf(currentActiveCamera->fov * .5f);
+	const float halfVSide = zFar * tanf(glm::radians(currentActiveCamera->fov) * .5f);
 	const float halfHSide = halfVSide * currentActiveCamera->aspectRatio;
 	const Vec3 frontMultNear = zNear * transform->forward;
 	const Vec3 frontMultFar = zFar * transform->forward;
 
 	cameraFrustum.nearFace = { transform->position + frontMultNear, transform->forward };
 	cameraFrustum.farFace = { transform->position + frontMultFar, -transform->forward };
+	// side normals point inwards, each plane holds the far edge on its own side
 	cameraFrustum.rightFace = { transform->position,
-							glm::cross(transform->up, frontMultFar - transform->right * halfHSide) };
+							glm::cross(transform->up, frontMultFar + transform->right * halfHSide) };
 	cameraFrustum.leftFace = { transform->position,
-							glm::cross(frontMultFar + transform->right * halfHSide, transform->up) };
+							glm::cross(frontMultFar - transform->right * halfHSide, transform->up) };
 	cameraFrustum.topFace = { transform->position,
-							glm::cross(frontMultFar - transform->up * halfVSide, transform->right) };
+							glm::cross(frontMultFar + transform->up * halfVSide, transform->right) };
 	cameraFrustum.bottomFace = { transform->position,
-							glm::cross(transform->right, frontMultFar + transform->up * halfVSide) };
+							glm::cross(transform->right, frontMultFar - transform->up * halfVSide) };
 }
 
-/* Returns the light proj matrix when using CSM. To get the view-proj matrix,
-just multiply by the view matrix (see GetLightViewMatrix()).*/
-Mat4 OpenGlApi::GetLightSpaceMatrix(const Mat4& lightViewMatrix, const std::vector<Vec4>& corners) {
-	float minX = std::numeric_limits<float>::max();
-	float maxX = std::numeric_limits<float>::lowest();
-	float minY = std::numeric_limits<float>::max();
-	float maxY = std::numeric_limits<float>::lowest();
-	float minZ = std::numeric_limits<float>::max();
-	float maxZ = std::numeric_limits<float>::lowest();
-
-	for (const auto& v : corners)
-	{
-		const auto trf = lightViewMatrix * v;
-		minX = glm::min(minX, trf.x);
-		maxX = glm::max(maxX, trf.x);
-		minY = glm::min(minY, trf.y);
-		maxY = glm::max(maxY, trf.y);
-		minZ = glm::min(minZ, trf.z);
-		maxZ = glm::max(maxZ, trf.z);
-	}
-
-	//auto tmp = -minZ;
-	//minZ = -maxZ;
-	//maxZ = tmp;
-
-	//auto mid = (maxZ - minZ) / 2;
-	//minZ -= mid * 5.0f;
-	//maxZ += mid * 5.0f;
-
-	constexpr float zMult = 10.0f; // multiplier to extend light view frustum to 
-	// corners of camera (objects out of view still cast shadows)
-	if (minZ < 0)
-		minZ *= zMult;
-	else
-		minZ /= zMult;
-
-	if (maxZ < 0)
-		maxZ /= zMult;
-	else
-		maxZ *= zMult;
-
-	//auto mid = (maxZ - minZ) / 2.0;
-	//minZ -= mid * 5.0f;
-	//maxZ += mid * 5.0f;
+/* Orthographic light matrix around the bounding sphere of a cascade's slice of the view
+frustum. The sphere keeps the covered size fixed while the camera turns and its center is
+snapped to whole shadow map texels, so the shadow edges do not swim as the camera moves. */
+Mat4 OpenGlApi::GetCascadeMatrix(const Vec3& lightDir, const std::vector<Vec4>& corners, const float casterDistance) {
+	Vec3 center = Vec3(0.0f);
+	for (const Vec4& corner : corners)
+		center += Vec3(corner);
+	center /= static_cast<float>(corners.size());
+
+	float radius = 0.0f;
+	for (const Vec4& corner : corners)
+		radius = std::max(radius, glm::length(Vec3(corner) - center));
+	// rounded up so that float noise in the corners never changes the texel size
+	radius = std::ceil(radius * 16.0f) / 16.0f;
+
+	const Vec3 forward = glm::normalize(lightDir);
+	const Vec3 up = std::abs(forward.y) > 0.99f ? Vec3(0.0f, 0.0f, 1.0f) : Vec3(0.0f, 1.0f, 0.0f);
+	const Mat4 lightRotation = glm::lookAt(Vec3(0.0f), forward, up);
+
+	Vec3 lightCenter = Vec3(lightRotation * Vec4(center, 1.0f));
+	const float texelSize = 2.0f * radius / static_cast<float>(shadowMapResolution);
+	lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+	lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+	// the light looks down -z, casters between it and the slice are further up the z axis
+	const Mat4 lightProjection = glm::ortho(lightCenter.x - radius,
+											lightCenter.x + radius,
+											lightCenter.y - radius,
+											lightCenter.y + radius,
+											-(lightCenter.z + radius + casterDistance),
+											-(lightCenter.z - radius));
+
+	return lightProjection * lightRotation;
+}
 
-	const Mat4 lightProjection = glm::ortho(
-		minX,
-		maxX,
-		minY,
-		maxY,
-		minZ,
-		maxZ
-	);
+/* True when every corner of a cascade's slice is still inside the light volume it was drawn with. */
+bool OpenGlApi::CascadeCovers(const Mat4& lightSpaceMatrix, const std::vector<Vec4>& corners) {
+	for (const Vec4& corner : corners) {
+		const Vec4 clip = lightSpaceMatrix * corner;
+		if (std::abs(clip.x) > clip.w || std::abs(clip.y) > clip.w || std::abs(clip.z) > clip.w)
+			return false;
+	}
 
-	return lightProjection * lightViewMatrix;
-};
+	return true;
+}
 
 void OpenGlApi::InitSSAOUniformBuffer() {
 
@@ -329,7 +453,7 @@ void OpenGlApi::InitSSAOUniformBuffer() {
 		cfg::Rendering.Read<float>("Video", "video.resX", 800.0f) / 4.0f, 
 		cfg::Rendering.Read<float>("Video", "video.resY", 600.0f) / 4.0f };
 	ssaoSettings.bias = cfg::Rendering.Read<float>("OpenGL", "opengl.ssao.bias", 0.025f);
-	ssaoSettings.power = cfg::Rendering.Read<float>("OpenGL", "openg.ssao.power", 1.0f);
+	ssaoSettings.power = cfg::Rendering.Read<float>("OpenGL", "opengl.ssao.power", 1.0f);
 	ssaoSettings.radius = cfg::Rendering.Read<float>("OpenGL", "opengl.ssao.radius", 0.5f);
 
 	//std::vector<Vec4> ssaoKernel;
@@ -424,7 +548,7 @@ void OpenGlApi::InitShadowMapFBOs() {
 												  GL_DEPTH_COMPONENT32F, 
 												  cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512), 
 												  cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512), 
-												  6 * cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.max_point_lights", 8), 1);
+												  6 * maxShadowedPointLights, 1);
 	pointShadowCubemapArray.SetParams(GL_TEXTURE_BORDER_COLOR, borderColor);
 	pointShadowFBO.AttachDepthCubeMapTex(pointShadowCubemapArray.GetID());
 	pointShadowFBO.DisableColorBuffer();
@@ -434,6 +558,26 @@ void OpenGlApi::InitShadowMapFBOs() {
 		return;
 	}
 
+	pointShadowStaticFBO = FrameBuffer(cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512), 
+									   cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512));
+	pointShadowStaticCubemapArray = TextureCubeMapArray("point_light_static_shadow_cubemap_array", 
+														GL_DEPTH_COMPONENT32F, 
+														cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512), 
+														cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512), 
+														6 * maxShadowedPointLights, 1);
+	pointShadowStaticFBO.AttachDepthCubeMapTex(pointShadowStaticCubemapArray.GetID());
+	pointShadowStaticFBO.DisableColorBuffer();
+
+	if (!pointShadowStaticFBO.CheckComplete()) {
+		LOG(LogOpenGL, LOG_CRITICAL, "Static point light shadow map frame buffer is incomplete.");
+		return;
+	}
+
+	// layers are only cleared when their light is drawn, start them all at the far plane
+	const float farDepth = 1.0f;
+	glClearTexImage(pointShadowCubemapArray.GetID(), 0, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+	glClearTexImage(pointShadowStaticCubemapArray.GetID(), 0, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+
 	// Gaussian blur on shadows
 	vBlurShadowMapTex2D = Texture2D("vBlurShadowMapTex2D", 
 						            GL_RGB16F, 
@@ -478,28 +622,27 @@ void OpenGlApi::InitShadowMapFBOs() {
 	// CSM Shadow Maps
 	shadowMapTex2DArray = Texture2DArray("shadow_map_tex2d", 
 										 GL_RG32F, 
-										 cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512), 
-										 cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512), cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.cascade_count", 4));
+										 shadowMapResolution, 
+										 shadowMapResolution, 
+										 shadowCascadeCount);
 	shadowMapTex2DArray.SetParam(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	shadowMapTex2DArray.SetParam(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	shadowMapTex2DArray.SetParam(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 	shadowMapTex2DArray.SetParam(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 	shadowMapTex2DArray.SetParams(GL_TEXTURE_BORDER_COLOR, borderColor);
 
-	Texture2DArray shadowMapDepthTex2DArray = Texture2DArray("shadow_map_depth_tex2darray", 
-															 GL_DEPTH_COMPONENT32F, 
-															 cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512), 
-															 cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512), 
-															 cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.cascade_count", 4));
+	shadowMapDepthTex2DArray = Texture2DArray("shadow_map_depth_tex2darray", 
+											  GL_DEPTH_COMPONENT32F, 
+											  shadowMapResolution, 
+											  shadowMapResolution, 
+											  shadowCascadeCount);
 	shadowMapDepthTex2DArray.SetParam(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	shadowMapDepthTex2DArray.SetParam(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	shadowMapDepthTex2DArray.SetParam(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 	shadowMapDepthTex2DArray.SetParam(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 	shadowMapDepthTex2DArray.SetParams(GL_TEXTURE_BORDER_COLOR, borderColor);
 
-	BIND(Shader, shadowMapShader); // we bind here to tell open gl that we are using a geometry shader
-	shadowMapFBO = FrameBuffer(cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512), 
-						       cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.resolution", 512));
+	shadowMapFBO = FrameBuffer(shadowMapResolution, shadowMapResolution);
 	shadowMapFBO.AttachDepthTex2D(shadowMapDepthTex2DArray.GetID());
 	shadowMapFBO.AttachColorTex2D(shadowMapTex2DArray.GetID(), 0);
 	shadowMapFBO.DrawBuffer(0);
@@ -589,13 +732,59 @@ void OpenGlApi::InitGBuffer() {
 	gBufferFBO.AttachColorTex2D(gViewPosition.GetID(), 5);
 	gBufferFBO.AttachColorTex2D(gViewNormal.GetID(), 6);
 	gBufferFBO.DrawColorBuffers();
-	gBufferFBO.CreateRenderBuffer();
+
+	// sampled depth, the Hi-Z pyramid is built from it
+	gDepth = Texture2D("gDepth_tex2D", 
+					   GL_DEPTH_COMPONENT32F, 
+					   cfg::Rendering.Read<uint32_t>("Video", "video.resX", 800), 
+					   cfg::Rendering.Read<uint32_t>("Video", "video.resY", 600));
+	gDepth.SetParam(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	gDepth.SetParam(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	gBufferFBO.AttachDepthTex2D(gDepth.GetID());
 
 	if (!gBufferFBO.CheckComplete()) {
 		LOG(LogOpenGL, LOG_CRITICAL, "Gbuffer frame buffer is incomplete.");
 	}
 }
 
+void OpenGlApi::InitHiZ() {
+	const GLuint width = gDepth.GetWidth();
+	const GLuint height = gDepth.GetHeight();
+	const GLsizei levels = 1 + static_cast<GLsizei>(std::floor(std::log2(std::max(width, height))));
+
+	hiZTex2D = Texture2D("hiZ_tex2D", GL_R32F, width, height, levels);
+	hiZTex2D.SetParam(GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	hiZTex2D.SetParam(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	hiZTex2D.SetParam(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	hiZTex2D.SetParam(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+/* Reduces the depth of this frame's geometry pass to a pyramid of max depths.
+The next frame culls against it, so newly disoccluded objects show a frame late. */
+void OpenGlApi::BuildHiZ() {
+	BIND(Shader, hiZBuildShader);
+
+	GLuint width = hiZTex2D.GetWidth();
+	GLuint height = hiZTex2D.GetHeight();
+	for (GLsizei level = 0; level < hiZTex2D.GetLevels(); level++) {
+		Texture2D& source = level == 0 ? gDepth : hiZTex2D;
+		BIND_TEX(Texture2D, source, 0);
+		hiZBuildShader.SetUBool("uCopy", level == 0);
+		hiZBuildShader.SetUInt("uSourceLevel", level == 0 ? 0 : level - 1);
+
+		glBindImageTexture(0, hiZTex2D.GetID(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		hiZBuildShader.Dispatch((width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+	}
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+	hiZViewProj = currentActiveCamera->projMatrix * currentActiveCamera->viewMatrix;
+	hiZValid = true;
+}
+
 void OpenGlApi::RegisterTexture2D(Texture* texture) {
 	if (texture == nullptr)
 		LOG(LogOpenGL, LOG_CRITICAL, std::format("Failed to register texture {} to buffer.", texture->assetPath));
@@ -603,7 +792,49 @@ void OpenGlApi::RegisterTexture2D(Texture* texture) {
 	auto it = assetIDToTex2DMap.find(texture->assetId);
 	if (it != assetIDToTex2DMap.end())
 		return;
-	
+
+	// the streamer owns the GL texture and swaps the handle as levels come and go
+	if (!texture->cookedPath.empty()) {
+		const uint32_t handleIndex = static_cast<uint32_t>(tex2DHndlrDataArray.size());
+		const GLuint64 hndl = textureStreamer.Register(texture, handleIndex);
+		textureHndlrsSSBO.UpdateData(handleIndex * sizeof(GLuint64), sizeof(GLuint64), &hndl);
+		tex2DHndlrDataArray.push_back(hndl);
+
+		Texture2D streamed;
+		streamed.SetHandleIndex(static_cast<int32_t>(handleIndex));
+		assetIDToTex2DMap[texture->assetId] = streamed;
+		return;
+	}
+
+	Texture2D glTex2D;
+	if (texture->compressedFormat != 0) {
+		// cooked textures carry their whole mip chain
+		glTex2D = Texture2D(texture->assetName, texture->compressedFormat, texture->width, texture->height, static_cast<GLsizei>(texture->mips.size()));
+		for (size_t level = 0; level < texture->mips.size(); level++) {
+			const TextureMip& mip = texture->mips[level];
+			glTex2D.SetCompressedSubImage2D(static_cast<GLint>(level), mip.width, mip.height, static_cast<GLsizei>(mip.size), texture->compressedData.data() + mip.offset);
+		}
+	}
+	else {
+		glTex2D = CreateUncompressedTexture2D(texture);
+	}
+
+	glTex2D.SetParam(GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTex2D.SetParam(GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTex2D.SetParam(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTex2D.SetParam(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTex2D.MakeResident();
+	glTex2D.SetHandleIndex(static_cast<int32_t>(tex2DHndlrDataArray.size()));
+
+	GLuint64 hndl = glTex2D.GetHandle();
+	textureHndlrsSSBO.UpdateData(tex2DHndlrDataArray.size() * sizeof(GLuint64), sizeof(GLuint64), &hndl);
+	tex2DHndlrDataArray.push_back(glTex2D.GetHandle());
+
+	assetIDToTex2DMap[texture->assetId] = glTex2D;
+}
+
+/* Raw pixels from an image that was not cooked, the mips are built on the GPU after the upload. */
+Texture2D OpenGlApi::CreateUncompressedTexture2D(const Texture* texture) {
 	GLenum internalFormat;
 	if (texture->type == TextureAssetType::Albedo) {
 		if (texture->hasAlphaChannel) {
@@ -634,21 +865,12 @@ void OpenGlApi::RegisterTexture2D(Texture* texture) {
 	}
 	GLenum format = internalToFormat(internalFormat);
 
-	Texture2D glTex2D = Texture2D(texture->assetName, internalFormat, texture->width, texture->height);
-	glTex2D.SetParam(GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTex2D.SetParam(GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTex2D.SetParam(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTex2D.SetParam(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTex2D.GenerateMipMap();
+	const GLsizei levels = 1 + static_cast<GLsizei>(std::floor(std::log2(std::max(texture->width, texture->height))));
+	Texture2D glTex2D = Texture2D(texture->assetName, internalFormat, texture->width, texture->height, levels);
 	glTex2D.SetSubImage2D(format, 0, 0, 0, GL_UNSIGNED_BYTE, texture->data);
-	glTex2D.MakeResident();
-	glTex2D.SetHandleIndex(static_cast<int32_t>(tex2DHndlrDataArray.size()));
-
-	GLuint64 hndl = glTex2D.GetHandle();
-	textureHndlrsSSBO.UpdateData(tex2DHndlrDataArray.size() * sizeof(GLuint64), sizeof(GLuint64), &hndl);
-	tex2DHndlrDataArray.push_back(glTex2D.GetHandle());
+	glTex2D.GenerateMipMap();
 
-	assetIDToTex2DMap[texture->assetId] = glTex2D;
+	return glTex2D;
 }
 
 void OpenGlApi::UploadSceneLightData() {
@@ -675,32 +897,274 @@ void OpenGlApi::UploadCameraData(const Camera* camera, const Transform* transfor
 
 	cameraDataUBO.UpdateData(0, sizeof(CameraData), &cameraData);
 	UpdateCameraFrustum(transform);
+
+	// world error e at distance d covers e * lodFactor / d pixels once divided by the pixel budget
+	const float pixelsPerUnit = 0.5f * gBufferFBO.GetHeight() / std::tan(glm::radians(currentActiveCamera->fov) * 0.5f);
+	const float pixelError = lodPixelErrorCfg.Get();
+	const float shadowPixelError = lodShadowPixelErrorCfg.Get();
+	cameraPosition = transform->position;
+	this->pixelsPerUnit = pixelsPerUnit;
+	lodFactor = pixelError > 0.0f ? pixelsPerUnit / pixelError : FLT_MAX;
+	shadowLodFactor = shadowPixelError > 0.0f ? pixelsPerUnit / shadowPixelError : FLT_MAX;
+}
+
+/* The layered path needs gl_Layer in the vertex shader, without it the instanced
+casters are drawn face by face. opengl.shadows.point_path picks one by name. */
+void OpenGlApi::InitPointShadowPaths(const ShaderPreProcessor& spp) {
+	layerFromVertexSupported = HasGLExtension("GL_ARB_shader_viewport_layer_array");
+	if (layerFromVertexSupported) {
+		pointLightShadowLayeredShader = Shader(spp.GetCodeStr("point_shadow_map_layered.vert"),
+											   spp.GetCodeStr("point_shadow_map.frag"));
+		pointLightShadowLayeredShader.RequireUniforms({ "uPointLightIndex" });
+		pointLightShadowLayeredShader.RequireBlock("ShadowCasterSlots", SSBO_SHADOW_CASTER_SLOTS);
+	}
+
+	const std::string path = cfg::Rendering.Read<std::string>("OpenGL", "opengl.shadows.point_path", "auto");
+	if (path == "geometry")
+		pointShadowConfiguredPath = PointShadowPath::GeometryShader;
+	else if (path == "per_face")
+		pointShadowConfiguredPath = PointShadowPath::PerFace;
+	else
+		pointShadowConfiguredPath = layerFromVertexSupported ? PointShadowPath::Layered : PointShadowPath::PerFace;
+
+	if (path == "layered" && !layerFromVertexSupported)
+		LOG(LogOpenGL, LOG_WARNING, "GL_ARB_shader_viewport_layer_array is not supported, point shadows are drawn per face.");
+
+	pointShadowPath = pointShadowConfiguredPath;
+	LOG(LogOpenGL, LOG_INFO, std::format("Point shadows use the {} path.", PointShadowPathName(pointShadowPath)));
+
+	pointShadowBenchFrames = cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.point_bench_frames", 0);
+	if (pointShadowBenchFrames == 0)
+		return;
+
+	pointShadowBenchPaths = { PointShadowPath::GeometryShader, PointShadowPath::PerFace };
+	if (layerFromVertexSupported)
+		pointShadowBenchPaths.push_back(PointShadowPath::Layered);
+
+	pointShadowTimer = GpuTimer(GPU_TIMER_QUERIES);
+	pointShadowPath = pointShadowBenchPaths[0];
+}
+
+/* Logs the mean GPU time of the current path once it ran for the benchmark's frame
+count, then moves on to the next path. */
+void OpenGlApi::UpdatePointShadowBenchmark() {
+	if (pointShadowBenchIndex >= pointShadowBenchPaths.size() || ++pointShadowBenchFrame < pointShadowBenchFrames)
+		return;
+
+	pointShadowTimer.Collect();
+	LOG(LogOpenGL, LOG_INFO, std::format("Point shadow benchmark: {} path, {:.3f} ms GPU mean over {} frames.",
+										 PointShadowPathName(pointShadowPath),
+										 pointShadowTimer.GetMeanMs(),
+										 pointShadowTimer.GetSampleCount()));
+
+	pointShadowTimer.Reset();
+	pointShadowBenchFrame = 0;
+	if (++pointShadowBenchIndex < pointShadowBenchPaths.size()) {
+		pointShadowPath = pointShadowBenchPaths[pointShadowBenchIndex];
+		return;
+	}
+
+	pointShadowPath = pointShadowConfiguredPath;
+	LOG(LogOpenGL, LOG_INFO, std::format("Point shadow benchmark done, back to the {} path.", PointShadowPathName(pointShadowPath)));
 }
 
+/* Each light in view draws only the casters in its range, tagged with the cube faces they
+touch. Casters that have rested for a while form a static layer that is re-rendered only
+when that set or the light changes, and is copied under the dynamic casters every frame. */
 void OpenGlApi::PointLightShadowMapPass() {
 	if (pointLightDataArray.empty())
 		return;
 
-	BIND(FrameBuffer, pointShadowFBO);
-	BIND(Shader, pointLightShadowMapShader);
+	// lights whose range misses the camera frustum cannot shadow anything on screen
+	pointShadowLights.clear();
+	pointLightTree.QueryFrustum(cameraFrustum, [this](const uint32_t lightIndex) {
+		if (pointLightDataArray[lightIndex].shadowLayer >= 0)
+			pointShadowLights.push_back(lightIndex);
+	});
+	if (pointShadowLights.empty())
+		return;
+
+	// the benchmark times full redraws, not the cached static layers
+	const bool benchmarking = pointShadowBenchIndex < pointShadowBenchPaths.size();
+	if (benchmarking) {
+		for (PointShadowCacheData& cache : pointShadowCaches)
+			cache.valid = false;
+	}
+
+	shadowCasterCmds.clear();
+	shadowCasterSlots.clear();
+	shadowCasterDraws.clear();
+	for (const uint32_t lightIndex : pointShadowLights) {
+		const PointLightData& light = pointLightDataArray[lightIndex];
+		GatherPointShadowCasters(light);
+
+		uint64_t staticSignature = 0;
+		for (const auto& caster : staticShadowCasters)
+			staticSignature += Utils::HashBytes(&caster, sizeof(caster));
+
+		PointShadowCacheData& cache = pointShadowCaches[lightIndex];
+		if (!cache.valid || cache.position != light.mPosition || cache.farPlane != light.shadowFarPlane || cache.staticSignature != staticSignature) {
+			shadowCasterDraws.push_back(AppendShadowCasterCmds(lightIndex, staticShadowCasters, true));
+			cache = { light.mPosition, light.shadowFarPlane, staticSignature, true };
+		}
+
+		shadowCasterDraws.push_back(AppendShadowCasterCmds(lightIndex, dynamicShadowCasters, false));
+	}
+
+	if (!shadowCasterSlots.empty())
+		shadowCasterSlotsSSBO.UpdateData(0, shadowCasterSlots.size() * sizeof(GLuint), shadowCasterSlots.data());
+	if (!shadowCasterCmds.empty())
+		shadowCasterDIB.UpdateData(0, shadowCasterCmds.size() * sizeof(MeshDrawCmdData), shadowCasterCmds.data());
+
+	Shader& shader = pointShadowPath == PointShadowPath::GeometryShader ? pointLightShadowMapShader
+				   : pointShadowPath == PointShadowPath::Layered ? pointLightShadowLayeredShader
+				   : pointLightShadowFaceShader;
+
+	BIND(Shader, shader);
 	BIND(VertexArray, meshVAO);
-	BIND(DrawIndirectBuffer, meshDIB);
-	ClearBuffers(GL_DEPTH_BUFFER_BIT);
+	BIND(StreamingBuffer, shadowCasterDIB);
 	SetDepthEnabled(true);
 	SetFaceCullMode(GL_FRONT);
 	SetViewport(0, 0, pointShadowFBO.GetWidth(), pointShadowFBO.GetHeight());
-	size_t pointLightsCount = pointLightDataArray.size();
 
-	// we re-draw the scene for each of the faces
-	// of the cube map depth texture
-	for (unsigned int i = 0; i < pointLightsCount; i++) {
-		pointLightShadowMapShader.SetUInt("uPointLightIndex", i);
+	const GLsizei width = static_cast<GLsizei>(pointShadowFBO.GetWidth());
+	const GLsizei height = static_cast<GLsizei>(pointShadowFBO.GetHeight());
+	const float farDepth = 1.0f;
+	pointShadowTimer.Begin();
+
+	{
+		BIND(FrameBuffer, pointShadowStaticFBO);
+		for (const ShadowCasterDraw& draw : shadowCasterDraws) {
+			if (!draw.staticLayer)
+				continue;
+
+			glClearTexSubImage(pointShadowStaticCubemapArray.GetID(), 0, 0, 0, 6 * draw.shadowLayer, width, height, 6, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+			DrawShadowCasters(shader, draw, pointShadowStaticFBO, pointShadowStaticCubemapArray);
+		}
+	}
+
+	BIND(FrameBuffer, pointShadowFBO);
+	for (const ShadowCasterDraw& draw : shadowCasterDraws) {
+		if (draw.staticLayer)
+			continue;
+
+		glCopyImageSubData(pointShadowStaticCubemapArray.GetID(), GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, 6 * draw.shadowLayer,
+						   pointShadowCubemapArray.GetID(), GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, 6 * draw.shadowLayer,
+						   width, height, 6);
+		DrawShadowCasters(shader, draw, pointShadowFBO, pointShadowCubemapArray);
+	}
+
+	pointShadowTimer.End();
+	UpdatePointShadowBenchmark();
+}
+
+/* Splits the casters in range of a light into the static and dynamic lists, each entry
+carrying the faces whose frustum its bounds touch. */
+void OpenGlApi::GatherPointShadowCasters(const PointLightData& light) {
+	Frustum faceFrusta[6];
+	for (uint32_t face = 0; face < 6; face++)
+		faceFrusta[face] = Culling::FrustumFromMatrix(light.cubemapViewMatrices[face]);
+
+	// lods follow the light's own cube faces, so a cached static layer keeps its lods as the camera moves
+	const float shadowPixelError = lodShadowPixelErrorCfg.Get();
+	const float pointLodFactor = shadowPixelError > 0.0f ? 0.5f * pointShadowFBO.GetHeight() / shadowPixelError : FLT_MAX;
+
+	staticShadowCasters.clear();
+	dynamicShadowCasters.clear();
+	// nothing past the light's range is lit, so nothing there can be shadowed
+	meshInstTree.QuerySphere(light.mPosition, std::min(light.range, light.shadowFarPlane), [&](const uint32_t slot) {
+		const Vec3 center(meshInstBounds.centerX[slot], meshInstBounds.centerY[slot], meshInstBounds.centerZ[slot]);
+		const Vec3 extent(meshInstBounds.extentX[slot], meshInstBounds.extentY[slot], meshInstBounds.extentZ[slot]);
+
+		uint32_t faceMask = 0;
+		for (uint32_t face = 0; face < 6; face++) {
+			if (Culling::IntersectsFrustum(faceFrusta[face], center, extent))
+				faceMask |= 1u << face;
+		}
+
+		if (faceMask == 0)
+			return;
+
+		const uint32_t entry = slot | (faceMask << SHADOW_CASTER_FACE_SHIFT);
+		const uint32_t cmdIndex = SelectMeshLod(slot, pointLodFactor, light.mPosition);
+		if (frameIndex - meshInstLastMoved[slot] > staticCasterFrames)
+			staticShadowCasters.emplace_back(cmdIndex, entry);
+		else
+			dynamicShadowCasters.emplace_back(cmdIndex, entry);
+	});
+}
+
+/* Groups the casters by mesh into draw commands appended to the frame's shadow caster lists.
+The instanced paths get one entry per touched face, grouped by face first. */
+ShadowCasterDraw OpenGlApi::AppendShadowCasterCmds(const uint32_t lightIndex, const std::vector<std::pair<uint32_t, uint32_t>>& casters, const bool staticLayer) {
+	shadowCasterKeys.clear();
+	for (const auto& [cmdIndex, entry] : casters) {
+		if (pointShadowPath == PointShadowPath::GeometryShader) {
+			shadowCasterKeys.push_back((static_cast<uint64_t>(cmdIndex) << 32) | entry);
+			continue;
+		}
+
+		const uint32_t slot = entry & SHADOW_CASTER_SLOT_MASK;
+		for (uint32_t faceMask = entry >> SHADOW_CASTER_FACE_SHIFT; faceMask != 0; faceMask &= faceMask - 1) {
+			const uint32_t face = static_cast<uint32_t>(std::countr_zero(faceMask));
+			shadowCasterKeys.push_back((static_cast<uint64_t>(face) << 61) | (static_cast<uint64_t>(cmdIndex) << 32) | (slot | (face << SHADOW_CASTER_FACE_SHIFT)));
+		}
+	}
+	std::sort(shadowCasterKeys.begin(), shadowCasterKeys.end());
+
+	ShadowCasterDraw draw;
+	draw.lightIndex = lightIndex;
+	draw.shadowLayer = static_cast<uint32_t>(pointLightDataArray[lightIndex].shadowLayer);
+	draw.firstCmd = static_cast<uint32_t>(shadowCasterCmds.size());
+	draw.staticLayer = staticLayer;
+
+	for (size_t i = 0; i < shadowCasterKeys.size();) {
+		const uint64_t group = shadowCasterKeys[i] >> 32;
+		MeshDrawCmdData cmdData = meshDrawCmdDataArray[group & 0x1FFFFFFFu];
+		cmdData.baseInstance = static_cast<GLuint>(shadowCasterSlots.size());
+
+		for (; i < shadowCasterKeys.size() && (shadowCasterKeys[i] >> 32) == group; i++)
+			shadowCasterSlots.push_back(static_cast<GLuint>(shadowCasterKeys[i]));
+
+		cmdData.instanceCount = static_cast<GLuint>(shadowCasterSlots.size()) - cmdData.baseInstance;
+		shadowCasterCmds.push_back(cmdData);
+		draw.faceCmdCounts[group >> 29]++;
+	}
+
+	draw.cmdCount = static_cast<uint32_t>(shadowCasterCmds.size()) - draw.firstCmd;
+	return draw;
+}
+
+void OpenGlApi::DrawShadowCasters(Shader& shader, const ShadowCasterDraw& draw, FrameBuffer& fbo, const TextureCubeMapArray& cubemapArray) {
+	if (draw.cmdCount == 0)
+		return;
+
+	shader.SetUInt("uPointLightIndex", draw.lightIndex);
+	const uint8_t* commands = static_cast<const uint8_t*>(shadowCasterDIB.GetIndirectOffset()) + draw.firstCmd * sizeof(MeshDrawCmdData);
+	if (pointShadowPath != PointShadowPath::PerFace) {
 		glMultiDrawElementsIndirect(GL_TRIANGLES,
 									GL_UNSIGNED_INT,
-									nullptr,
-									static_cast<GLsizei>(meshDrawCmdDataArray.size()),
+									commands,
+									static_cast<GLsizei>(draw.cmdCount),
 									sizeof(MeshDrawCmdData));
+		return;
+	}
+
+	// without layer selection in the vertex shader each face is drawn into its own attached layer
+	for (uint32_t face = 0; face < 6; face++) {
+		if (draw.faceCmdCounts[face] > 0) {
+			fbo.AttachDepthTexLayer(cubemapArray.GetID(), static_cast<GLint>(6 * draw.shadowLayer + face));
+			glMultiDrawElementsIndirect(GL_TRIANGLES,
+										GL_UNSIGNED_INT,
+										commands,
+										static_cast<GLsizei>(draw.faceCmdCounts[face]),
+										sizeof(MeshDrawCmdData));
+		}
+
+		commands += draw.faceCmdCounts[face] * sizeof(MeshDrawCmdData);
 	}
+
+	fbo.AttachDepthCubeMapTex(cubemapArray.GetID());
 }
 
 void OpenGlApi::RegisterCamera(Camera* camera) {
@@ -708,12 +1172,12 @@ void OpenGlApi::RegisterCamera(Camera* camera) {
 		currentActiveCamera = camera;
 
 		cascadeDataArray.clear();
-		cascadeDataArray = std::vector<CascadeData>(cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.cascade_count", 4));
+		cascadeDataArray = std::vector<CascadeData>(shadowCascadeCount);
 
-		for (size_t i = 0; i < cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.cascade_count", 4); i++) {
+		for (size_t i = 0; i < shadowCascadeCount; i++) {
 			
-			const float fractionNear = static_cast<float>(i) / static_cast<float>(cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.cascade_count", 4));
-			const float fractionFar = static_cast<float>(i + 1) / static_cast<float>(cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.cascade_count", 4));
+			const float fractionNear = static_cast<float>(i) / static_cast<float>(shadowCascadeCount);
+			const float fractionFar = static_cast<float>(i + 1) / static_cast<float>(shadowCascadeCount);
 
 			const float cameraClipRange = camera->farPlane - camera->nearPlane;
 			const float cameraClipRatio = camera->farPlane / camera->nearPlane;
@@ -730,36 +1194,145 @@ void OpenGlApi::RegisterCamera(Camera* camera) {
 		}
 
 		cascadeDataArray[0].nearPlane = camera->nearPlane;
-		cascadeDataArray[cfg::Rendering.Read<size_t>("OpenGL", "opengl.shadows.cascade_count", 4) - 1].farPlane = camera->farPlane;
+		cascadeDataArray[shadowCascadeCount - 1].farPlane = camera->farPlane;
+
+		for (CascadeUpdateData& update : cascadeUpdates)
+			update.valid = false;
 	}
 }
 
+/* Each cascade draws only the casters inside its own light volume. The near cascades are
+redrawn every frame, the far ones on a staggered schedule, unless the camera moved their
+slice out of the volume they were last drawn with. */
 void OpenGlApi::ShadowMapPass() {
+	PROFILE_SCOPE("OpenGlApi::ShadowMapPass", "Render");
 	if (directionalLight == nullptr) return;
 
-	for (size_t i = 0; i < cfg::Rendering.Read<uint32_t>("OpenGL", "opengl.shadows.cascade_count", 4); i++) {
-		const float cascadeNearPlane = cascadeDataArray[i].nearPlane;
-		const float cascadeFarPlane = cascadeDataArray[i].farPlane;
+	if (directionalLight->direction != cascadeLightDirection) {
+		for (CascadeUpdateData& update : cascadeUpdates)
+			update.valid = false;
+		cascadeLightDirection = directionalLight->direction;
+	}
 
+	cascadeCasterCmds.clear();
+	cascadeCasterSlots.clear();
+	cascadeCasterDraws.clear();
+	for (uint32_t i = 0; i < static_cast<uint32_t>(cascadeDataArray.size()); i++) {
 		const std::vector<Vec4> corners = GetFrustumCornersWorldSpace(currentActiveCamera->fov, 
-																		   currentActiveCamera->aspectRatio, 
-																		   cascadeNearPlane, 
-																		   cascadeFarPlane, 
-																		   currentActiveCamera->viewMatrix);
-		const Mat4 view = GetLightViewMatrix(directionalLight->direction, corners);
-		const Mat4 lightSpaceMatrix = GetLightSpaceMatrix(view, corners);
-		cascadeDataArray[i].lightSpaceMatrix = lightSpaceMatrix;
+																	  currentActiveCamera->aspectRatio, 
+																	  cascadeDataArray[i].nearPlane, 
+																	  cascadeDataArray[i].farPlane, 
+																	  currentActiveCamera->viewMatrix);
+
+		// cascades drawn in different frames are spread over the interval by their index
+		CascadeUpdateData& update = cascadeUpdates[i];
+		const bool due = (frameIndex + i) % update.interval == 0;
+		if (update.valid && !due && CascadeCovers(cascadeDataArray[i].lightSpaceMatrix, corners))
+			continue;
+
+		cascadeDataArray[i].lightSpaceMatrix = GetCascadeMatrix(directionalLight->direction, corners, directionalLight->shadowDistance);
+		update.valid = true;
+		AppendCascadeCasterCmds(i);
 	}
 
+	// skipped cascades keep the matrix their layer was drawn with
 	cascadeDataUBO.UpdateData(0, cascadeDataArray.size() * sizeof(CascadeData), cascadeDataArray.data());
+	if (cascadeCasterDraws.empty())
+		return;
+
+	if (!cascadeCasterSlots.empty())
+		cascadeCasterSlotsSSBO.UpdateData(0, cascadeCasterSlots.size() * sizeof(GLuint), cascadeCasterSlots.data());
+	if (!cascadeCasterCmds.empty())
+		cascadeCasterDIB.UpdateData(0, cascadeCasterCmds.size() * sizeof(MeshDrawCmdData), cascadeCasterCmds.data());
 
 	BIND(Shader, shadowMapShader);
 	BIND(FrameBuffer, shadowMapFBO);
+	BIND(VertexArray, meshVAO);
+	BIND(StreamingBuffer, cascadeCasterDIB);
+	SetDepthEnabled(true);
+	SetFaceCullMode(GL_FRONT);
 	SetViewport(0, 0, shadowMapFBO.GetWidth(), shadowMapFBO.GetHeight());
-	DrawScene(true, GL_FRONT);
+
+	const GLsizei size = static_cast<GLsizei>(shadowMapResolution);
+	const Vec2 farMoments = Vec2(1.0f);
+	const float farDepth = 1.0f;
+	for (const CascadeCasterDraw& draw : cascadeCasterDraws) {
+		const GLint layer = static_cast<GLint>(draw.cascade);
+		glClearTexSubImage(shadowMapTex2DArray.GetID(), 0, 0, 0, layer, size, size, 1, GL_RG, GL_FLOAT, &farMoments[0]);
+		glClearTexSubImage(shadowMapDepthTex2DArray.GetID(), 0, 0, 0, layer, size, size, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+		if (draw.cmdCount == 0)
+			continue;
+
+		shadowMapFBO.AttachColorTexLayer(shadowMapTex2DArray.GetID(), 0, layer);
+		shadowMapFBO.AttachDepthTexLayer(shadowMapDepthTex2DArray.GetID(), layer);
+		shadowMapShader.SetUInt("uCascadeIndex", draw.cascade);
+		glMultiDrawElementsIndirect(GL_TRIANGLES,
+									GL_UNSIGNED_INT,
+									static_cast<const uint8_t*>(cascadeCasterDIB.GetIndirectOffset()) + draw.firstCmd * sizeof(MeshDrawCmdData),
+									static_cast<GLsizei>(draw.cmdCount),
+									sizeof(MeshDrawCmdData));
+	}
+}
+
+/* Groups the instances inside a cascade's light volume by mesh into draw commands. */
+void OpenGlApi::AppendCascadeCasterCmds(const uint32_t cascade) {
+	const Frustum lightVolume = Culling::FrustumFromMatrix(cascadeDataArray[cascade].lightSpaceMatrix);
+
+	cascadeCasters.clear();
+	meshInstTree.QueryFrustum(lightVolume, [this](const uint32_t slot) {
+		cascadeCasters.emplace_back(SelectMeshLod(slot, shadowLodFactor, cameraPosition), slot);
+	});
+	std::sort(cascadeCasters.begin(), cascadeCasters.end());
+
+	CascadeCasterDraw draw;
+	draw.cascade = cascade;
+	draw.firstCmd = static_cast<uint32_t>(cascadeCasterCmds.size());
+
+	for (size_t i = 0; i < cascadeCasters.size();) {
+		const uint32_t cmdIndex = cascadeCasters[i].first;
+		MeshDrawCmdData cmdData = meshDrawCmdDataArray[cmdIndex];
+		cmdData.baseInstance = static_cast<GLuint>(cascadeCasterSlots.size());
+
+		for (; i < cascadeCasters.size() && cascadeCasters[i].first == cmdIndex; i++)
+			cascadeCasterSlots.push_back(cascadeCasters[i].second);
+
+		cmdData.instanceCount = static_cast<GLuint>(cascadeCasterSlots.size()) - cmdData.baseInstance;
+		cascadeCasterCmds.push_back(cmdData);
+	}
+
+	draw.cmdCount = static_cast<uint32_t>(cascadeCasterCmds.size()) - draw.firstCmd;
+	cascadeCasterDraws.push_back(draw);
+}
+
+/* Assigns the lights whose range reaches into the view to the froxel clusters, the
+lighting pass then only loops over the lights of each pixel's cluster. */
+void OpenGlApi::BuildLightClusters() {
+	PROFILE_SCOPE("OpenGlApi::BuildLightClusters", "Render");
+
+	lightClusters.SetProjection(currentActiveCamera->projMatrix, currentActiveCamera->nearPlane, currentActiveCamera->farPlane);
+
+	lightClusters.Begin();
+	pointLightTree.QueryFrustum(cameraFrustum, [this](const uint32_t lightIndex) {
+		const PointLightData& light = pointLightDataArray[lightIndex];
+		lightClusters.AddLight(lightIndex, Vec3(currentActiveCamera->viewMatrix * Vec4(light.mPosition, 1.0f)), light.range);
+	});
+
+	const uint32_t dropped = lightClusters.End();
+	if (dropped > 0 && droppedClusterLights == 0)
+		LOG(LogOpenGL, LOG_WARNING, std::format("{} cluster light entries over the limit of {} per cluster were dropped.", dropped, lightClusters.GetMaxLightsPerCluster()));
+	droppedClusterLights = dropped;
+
+	const std::vector<LightClusterRange>& ranges = lightClusters.GetRanges();
+	const std::vector<GLuint>& indices = lightClusters.GetLightIndices();
+	lightClusterDataUBO.UpdateData(0, sizeof(LightClusterGridData), &lightClusters.GetGridData());
+	lightClustersSSBO.UpdateData(0, ranges.size() * sizeof(LightClusterRange), ranges.data());
+	if (!indices.empty())
+		lightIndicesSSBO.UpdateData(0, indices.size() * sizeof(GLuint), indices.data());
 }
 
 void OpenGlApi::LightingPass() {
+	BuildLightClusters();
+
 	BIND_TEX(TextureCubeMapArray, pointShadowCubemapArray, 0);
 	BIND_TEX(Texture2DArray, shadowMapTex2DArray, 1);
 	BIND_TEX(Texture2D, gPosition, 2);
@@ -820,7 +1393,6 @@ void OpenGlApi::DrawScreenQuad(Texture2D& texture) {
 }
 
 void OpenGlApi::DrawScene(const bool withDepth, const GLenum faceCulling, const bool clear) {
-	BIND(DrawIndirectBuffer, meshDIB);
 	BIND(VertexArray, meshVAO);
 
 	if (clear) {
@@ -830,11 +1402,30 @@ void OpenGlApi::DrawScene(const bool withDepth, const GLenum faceCulling, const
 	
 	SetDepthEnabled(withDepth);
 	SetFaceCullMode(faceCulling);
-	glMultiDrawElementsIndirect(GL_TRIANGLES,
-								GL_UNSIGNED_INT,
-								nullptr,
-								static_cast<GLsizei>(meshDrawCmdDataArray.size()),
-								sizeof(MeshDrawCmdData));
+	DrawMeshes();
+}
+
+/* Issues the mesh draws with the commands culled this frame. */
+void OpenGlApi::DrawMeshes() {
+	const GLsizei maxDrawCount = static_cast<GLsizei>(meshDrawCmdDataArray.size());
+	if (!gpuCulling) {
+		BIND(StreamingBuffer, meshDIB);
+		glMultiDrawElementsIndirect(GL_TRIANGLES,
+									GL_UNSIGNED_INT,
+									meshDIB.GetIndirectOffset(),
+									maxDrawCount,
+									sizeof(MeshDrawCmdData));
+		return;
+	}
+
+	BIND(DrawIndirectBuffer, gpuMeshDIB);
+	BIND(ParameterBuffer, drawCountBuffer);
+	glMultiDrawElementsIndirectCount(GL_TRIANGLES,
+									 GL_UNSIGNED_INT,
+									 nullptr,
+									 0,
+									 maxDrawCount,
+									 sizeof(MeshDrawCmdData));
 }
 
 void OpenGlApi::PostFxPass()
@@ -842,37 +1433,123 @@ void OpenGlApi::PostFxPass()
 	BIND_TEX(Texture2D, diffuseTex2D, 0);
 	BIND(Shader, postFxShader);
 	BIND(FrameBuffer, postfxFBO);
-	postFxShader.SetUFloat("uGamma", cfg::Rendering.Read<float>("Video", "video.gamma", 2.2f));
+	postFxShader.SetUFloat("uGamma", gammaCfg.Get());
 	SetViewport(0, 0, postfxFBO.GetWidth(), postfxFBO.GetHeight());
 	DrawScreenQuad(postFXTex2D);
 }
 
-void OpenGlApi::UpsertMeshEntity(const Entity entity, const StaticMeshRenderer* smRenderer, const Transform* transform) {
-	Mat4 model = smRenderer->modelMatrix;
-	Mat4 inverseModel = smRenderer->inverseModelMatrix;
+void OpenGlApi::UpsertMeshEntity(const Entity entity, StaticMeshRenderer* smRenderer) {
+	const Mat4& model = smRenderer->modelMatrix;
+	const Mat4& inverseModel = smRenderer->inverseModelMatrix;
+	bool boundsChanged = false;
+
+	// meshes dropped from the renderer give their slots back
+	auto& entSlots = entToMeshInstSlots[entity];
+	for (auto it = entSlots.begin(); it != entSlots.end();) {
+		if (std::find(smRenderer->meshes.begin(), smRenderer->meshes.end(), it->first) != smRenderer->meshes.end()) {
+			++it;
+			continue;
+		}
+
+		ReleaseMeshInstSlot(it->first, it->second);
+		it = entSlots.erase(it);
+		boundsChanged = true;
+	}
 
 	for (const Asset meshID : smRenderer->meshes) {
-		Mesh* mesh = AssetManager::Get().GetAssetById<Mesh>(meshID);
 		auto meshDataIt = assToMesh.find(meshID);
-		if (assToMesh.find(meshID) == assToMesh.end()) {
-			LOG(LogOpenGL, LOG_ERROR, std::format("Missing open GL mesh data for mesh {}.", mesh->assetPath));
+		if (meshDataIt == assToMesh.end()) {
+			LOG(LogOpenGL, LOG_ERROR, std::format("Missing open GL mesh data for mesh {}.", meshID));
 			continue;
 		}
 
-		auto& meshInstances = assToMeshInsts[mesh->assetId];
-		auto [entInstIt, inserted] = assToEntMeshInstIndexes[mesh->assetId].try_emplace(entity, static_cast<uint32_t>(meshInstances.size()));
-
+		auto slotIt = entSlots.find(meshID);
+		const bool inserted = slotIt == entSlots.end();
 		if (inserted) {
-			meshInstances.emplace_back();
+			if (freeMeshInstSlots.empty() && meshInstSlotCount >= maxMeshInstances) {
+				LOG(LogOpenGL, LOG_ERROR, std::format("Out of mesh instance slots ({}), entity {} is not drawn.", maxMeshInstances, entity));
+				continue;
+			}
+
+			const uint32_t slot = Utils::AllocateIdFromPool(freeMeshInstSlots, meshInstSlotCount);
+			if (slot >= meshInstanceDataArray.size()) {
+				meshInstanceDataArray.resize(slot + 1);
+				meshInstProxies.resize(slot + 1, BVH_NULL_NODE);
+				meshInstLastMoved.resize(slot + 1, 0);
+				meshInstBounds.Resize(slot + 1);
+			}
+
+			meshDataIt->second.instanceSlots.push_back(slot);
+			slotIt = entSlots.emplace(meshID, slot).first;
+			if (smRenderer->isOccluder)
+				occluderSlots.emplace(slot, meshID);
+		}
+
+		// the slot keeps its data on the GPU, only upload it again when it moved
+		const uint32_t slot = slotIt->second;
+		MeshInstanceData& instance = meshInstanceDataArray[slot];
+		if (inserted || instance.model != model || instance.inverseModel != inverseModel) {
+			Vec3 worldMin, worldMax;
+			Culling::TransformAABB(meshDataIt->second.boundsMin, meshDataIt->second.boundsMax, model, worldMin, worldMax);
+			meshInstBounds.Set(slot, worldMin, worldMax);
+			meshInstLastMoved[slot] = frameIndex;
+			boundsChanged = true;
+
+			if (inserted)
+				meshInstProxies[slot] = meshInstTree.Insert(worldMin, worldMax, slot);
+			else
+				meshInstTree.Update(meshInstProxies[slot], worldMin, worldMax);
+
+			instance.model = model;
+			instance.inverseModel = inverseModel;
+			instance.boundsCenter = Vec4((worldMin + worldMax) * 0.5f, 1.0f);
+			instance.boundsExtent = (worldMax - worldMin) * 0.5f;
+			instance.drawCmdIndex = static_cast<GLuint>(meshDataIt->second.drawCmdIndex);
+			dirtyMeshInstSlots.push_back(slot);
 		}
+	}
+
+	if (!boundsChanged)
+		return;
+
+	// entity bounds are the union of its mesh bounds
+	AABBRender& aabb = smRenderer->aabb;
+	aabb.min = Vec3(std::numeric_limits<float>::max());
+	aabb.max = Vec3(std::numeric_limits<float>::lowest());
+	for (const auto& [meshID, slot] : entSlots) {
+		const Vec3 center(meshInstBounds.centerX[slot], meshInstBounds.centerY[slot], meshInstBounds.centerZ[slot]);
+		const Vec3 extent(meshInstBounds.extentX[slot], meshInstBounds.extentY[slot], meshInstBounds.extentZ[slot]);
+		aabb.min = glm::min(aabb.min, center - extent);
+		aabb.max = glm::max(aabb.max, center + extent);
+	}
+}
 
-		auto& instance = meshInstances[entInstIt->second];
-		instance.model = model;
-		instance.inverseModel = inverseModel;
+/* Returns the instance slots of an entity to the free list. */
+void OpenGlApi::RemoveMeshEntity(const Entity entity) {
+	auto entIt = entToMeshInstSlots.find(entity);
+	if (entIt == entToMeshInstSlots.end())
+		return;
 
-		bool _isOnFrustum = IsOnFrustum(transform);
-		instance.shouldDraw = _isOnFrustum;
+	for (const auto& [meshID, slot] : entIt->second)
+		ReleaseMeshInstSlot(meshID, slot);
+
+	entToMeshInstSlots.erase(entIt);
+}
+
+void OpenGlApi::ReleaseMeshInstSlot(const Asset meshID, const uint32_t slot) {
+	std::vector<uint32_t>& meshSlots = assToMesh[meshID].instanceSlots;
+	auto slotIt = std::find(meshSlots.begin(), meshSlots.end(), slot);
+	if (slotIt != meshSlots.end()) {
+		*slotIt = meshSlots.back();
+		meshSlots.pop_back();
 	}
+
+	occluderSlots.erase(slot);
+	meshInstTree.Remove(meshInstProxies[slot]);
+	meshInstProxies[slot] = BVH_NULL_NODE;
+	meshInstanceDataArray[slot].drawCmdIndex = MESH_INSTANCE_FREE_SLOT;
+	dirtyMeshInstSlots.push_back(slot);
+	freeMeshInstSlots.push(slot);
 }
 
 void OpenGlApi::RegisterPointLight(const Entity entity, const PointLight* light, const Transform* transform) {
@@ -881,6 +1558,11 @@ void OpenGlApi::RegisterPointLight(const Entity entity, const PointLight* light,
 		return;
 	}
 
+	if (!entToPointLightData.contains(entity) && entToPointLightData.size() >= maxPointLights) {
+		LOG(LogOpenGL, LOG_WARNING, std::format("Failed to register point light. Limit of {} lights reached.", maxPointLights));
+		return;
+	}
+
 	auto [it, inserted] = entToPointLightData.try_emplace(entity);
 
 	it->second.mPosition = transform->position;
@@ -888,42 +1570,82 @@ void OpenGlApi::RegisterPointLight(const Entity entity, const PointLight* light,
 	it->second.mIntensity = light->intensity;
 	it->second.shadowFarPlane = light->shadowMapFarPlane;
 	it->second.shadowNearPlane = light->shadowMapNearPlane;
+	// distance where the inverse square falloff drops under the cutoff
+	it->second.range = std::sqrt(std::max(light->intensity, 0.0f) / lightAttenuationCutoff);
 	for (size_t i = 0; i < 6; i++)
 		it->second.cubemapViewMatrices[i] = light->cubemapMatrices[i];
 
 	if (inserted) {
 		it->second.dataArrayIndex = static_cast<GLuint>(pointLightDataArray.size());
+		it->second.shadowLayer = shadowedPointLightCount < maxShadowedPointLights ? static_cast<GLint>(shadowedPointLightCount++) : -1;
 		pointLightDataArray.push_back(it->second);
+		pointShadowCaches.emplace_back();
 	}
+	pointLightDataArray[it->second.dataArrayIndex] = it->second;
 
 	pointLightDataArraySSBO.UpdateData(it->second.dataArrayIndex * sizeof(PointLightData), sizeof(PointLightData), &it->second);
+
+	// bounds of everything the light reaches, shadow casters are further limited by the far plane
+	const Vec3 lightMin = transform->position - Vec3(it->second.range);
+	const Vec3 lightMax = transform->position + Vec3(it->second.range);
+	if (inserted)
+		entToPointLightProxy[entity] = pointLightTree.Insert(lightMin, lightMax, it->second.dataArrayIndex);
+	else
+		pointLightTree.Update(entToPointLightProxy[entity], lightMin, lightMax);
 }
 
 void OpenGlApi::RegisterMesh(const Mesh* mesh) {
-	const std::vector<Vertex>& vertices = mesh->vertices;
-	const std::vector<GLuint>& indices = mesh->indices;
+	RegisterMesh(mesh, mesh->GetData());
+}
+
+/* The buffers are filled straight from data, which may point into a mapped mesh cache. */
+void OpenGlApi::RegisterMesh(const Mesh* mesh, const MeshData& data) {
+	const std::span<const Vertex> vertices = data.vertices;
+	const std::span<const GLuint> indices = data.indices;
 
 	auto [it, inserted] = assToMesh.try_emplace(mesh->assetId);
 	if (inserted) {
-		it->second.drawCmdIndex = static_cast<int32_t>(meshDrawCmdDataArray.size());
+		const uint32_t lodCount = 1 + data.lodCount;
 
-		meshDrawCmdDataArray.push_back(MeshDrawCmdData());
-		MeshDrawCmdData& cmd = meshDrawCmdDataArray.back();
+		it->second.drawCmdIndex = static_cast<int32_t>(meshDrawCmdDataArray.size());
+		it->second.lodCount = lodCount;
+		it->second.boundsMin = mesh->boundsMin;
+		it->second.boundsMax = mesh->boundsMax;
 
-		cmd.count = static_cast<GLuint>(indices.size());
+		MeshDrawCmdData cmd;
 		cmd.instanceCount = 0;
-		cmd.firstIndex = static_cast<GLuint>(meshIndexDataArray.size());
-		cmd.baseVertex = static_cast<GLuint>(meshVertexDataArray.size());
+		cmd.baseVertex = meshVertexCount;
+		cmd.lodCount = lodCount;
+
+		cmd.diffTexHndlrIndex = mesh->diffuseTexture.IsValid() ? assetIDToTex2DMap[mesh->diffuseTexture.id].GetHandleIndex() : -1;
+		cmd.specTexHndlrIndex = mesh->specularTexture.IsValid() ? assetIDToTex2DMap[mesh->specularTexture.id].GetHandleIndex() : -1;
+		cmd.normTexHndlrIndex = mesh->normalTexture.IsValid() ? assetIDToTex2DMap[mesh->normalTexture.id].GetHandleIndex() : -1;
+
+		// imports and the mesh cache carry the packed layout, only meshes built elsewhere are packed here
+		if (compactVertices && data.packedVertices.size() == vertices.size()) {
+			meshVBO.UpdateData(cmd.baseVertex * sizeof(PackedVertex), data.packedVertices.size_bytes(), data.packedVertices.data());
+		}
+		else if (compactVertices) {
+			packedVertices.assign(vertices.begin(), vertices.end());
+			meshVBO.UpdateData(cmd.baseVertex * sizeof(PackedVertex), packedVertices.size() * sizeof(PackedVertex), packedVertices.data());
+		}
+		else {
+			meshVBO.UpdateData(cmd.baseVertex * sizeof(Vertex), vertices.size() * sizeof(Vertex), vertices.data());
+		}
+		meshVertexCount += static_cast<GLuint>(vertices.size());
+
+		// one command per lod, all drawing from the same vertices
+		for (uint32_t lod = 0; lod < lodCount; lod++) {
+			const std::span<const GLuint> lodIndices = lod == 0 ? indices : data.lodIndices[lod - 1];
 
-		cmd.diffTexHndlrIndex = mesh->diffuseTexture >= 0 ? assetIDToTex2DMap[mesh->diffuseTexture].GetHandleIndex() : -1;
-		cmd.specTexHndlrIndex = mesh->specularTexture >= 0 ? assetIDToTex2DMap[mesh->specularTexture].GetHandleIndex() : -1;
-		cmd.normTexHndlrIndex = mesh->normalTexture >= 0 ? assetIDToTex2DMap[mesh->normalTexture].GetHandleIndex() : -1;
-		
-		meshIndexDataArray.insert(meshIndexDataArray.end(), indices.begin(), indices.end());
-		meshVertexDataArray.insert(meshVertexDataArray.end(), vertices.begin(), vertices.end());
+			cmd.count = static_cast<GLuint>(lodIndices.size());
+			cmd.firstIndex = meshIndexCount;
+			cmd.lodError = lod == 0 ? 0.0f : data.lodErrors[lod - 1];
+			meshDrawCmdDataArray.push_back(cmd);
 
-		meshVBO.UpdateData(cmd.baseVertex * sizeof(Vertex), vertices.size() * sizeof(Vertex), vertices.data());
-		meshEBO.UpdateData(cmd.firstIndex * sizeof(GLuint), indices.size() * sizeof(GLuint), indices.data());
+			meshEBO.UpdateData(cmd.firstIndex * sizeof(GLuint), lodIndices.size() * sizeof(GLuint), lodIndices.data());
+			meshIndexCount += cmd.count;
+		}
 	}
 	else {
 		LOG(LogOpenGL, LOG_WARNING, std::format("Mesh with asset id {} already registered. Ignoring...", mesh->assetId));
@@ -931,42 +1653,221 @@ void OpenGlApi::RegisterMesh(const Mesh* mesh) {
 }
 
 void OpenGlApi::UploadMeshRenderData() {
-	std::vector<MeshInstanceData> meshInstDataArray;
-	uint32_t vertices = 0;
-	for (const auto& it : assToMeshInsts) {
-		MeshMetaData& metaData = assToMesh[it.first];
-		MeshDrawCmdData& cmdData = meshDrawCmdDataArray[metaData.drawCmdIndex];
-		cmdData.baseInstance = static_cast<GLuint>(meshInstDataArray.size());
-
-		const std::vector<MeshInstanceData>& meshInsts = it.second;
-
-		// frustum culling
-		for (auto& instanceData : it.second) {
-			if (instanceData.shouldDraw) {
-				meshInstDataArray.push_back(instanceData);
-				vertices += cmdData.count / 3;
-			}
+	// upload the slots that changed, merging neighbours into a single range
+	std::sort(dirtyMeshInstSlots.begin(), dirtyMeshInstSlots.end());
+	dirtyMeshInstSlots.erase(std::unique(dirtyMeshInstSlots.begin(), dirtyMeshInstSlots.end()), dirtyMeshInstSlots.end());
+	for (size_t i = 0; i < dirtyMeshInstSlots.size();) {
+		const uint32_t first = dirtyMeshInstSlots[i];
+		uint32_t last = first;
+		while (++i < dirtyMeshInstSlots.size() && dirtyMeshInstSlots[i] == last + 1)
+			last++;
+
+		meshInstanceSSBO.UpdateData(first * sizeof(MeshInstanceData), (last - first + 1) * sizeof(MeshInstanceData), &meshInstanceDataArray[first]);
+	}
+	dirtyMeshInstSlots.clear();
+
+	gpuCulling = gpuCullingCfg.Get();
+	if (gpuCulling)
+		CullMeshInstancesGPU();
+	else
+		CullMeshInstancesCPU();
+
+	RequestStreamedTextures();
+	textureStreamer.Update(frameIndex);
+}
+
+/* Asks for the mips of every texture on an instance in the frustum, sized by the pixels its
+bounds cover. Both culling paths keep the tree, the GPU one never reads visibility back. */
+void OpenGlApi::RequestStreamedTextures() {
+	PROFILE_SCOPE("OpenGlApi::RequestStreamedTextures", "Render");
+
+	meshInstTree.QueryFrustum(cameraFrustum, [this](const uint32_t slot) {
+		const MeshInstanceData& instance = meshInstanceDataArray[slot];
+		const MeshDrawCmdData& cmd = meshDrawCmdDataArray[instance.drawCmdIndex];
+		const float distance = std::max(glm::length(Vec3(instance.boundsCenter) - cameraPosition), 0.001f);
+		const float pixels = 2.0f * glm::length(instance.boundsExtent) * pixelsPerUnit / distance;
+
+		for (const GLint handleIndex : { cmd.diffTexHndlrIndex, cmd.specTexHndlrIndex, cmd.normTexHndlrIndex }) {
+			if (handleIndex >= 0)
+				textureStreamer.Request(static_cast<uint32_t>(handleIndex), pixels, frameIndex);
+		}
+	});
+}
+
+void OpenGlApi::CullMeshInstancesCPU() {
+	// the tree only visits the parts of the world near the frustum, the flat SIMD test visits every slot
+	if (bvhCullingCfg.Get()) {
+		meshInstVisibility.assign((meshInstSlotCount + CULL_BATCH_SIZE - 1) / CULL_BATCH_SIZE, 0);
+		meshInstTree.QueryFrustum(cameraFrustum, [this](const uint32_t slot) {
+			meshInstVisibility[slot / CULL_BATCH_SIZE] |= static_cast<uint8_t>(1u << (slot % CULL_BATCH_SIZE));
+		});
+	}
+	else {
+		Culling::FrustumCull(cameraFrustum, meshInstBounds, meshInstSlotCount, meshInstVisibility);
+	}
+
+	if (occlusionCullingCfg.Get())
+		CullOccludedInstances();
+
+	// visible slots are written per draw command, baseInstance points into this list
+	const size_t liveSlots = meshInstSlotCount - freeMeshInstSlots.size();
+	GLuint* visibleSlots = static_cast<GLuint*>(visibleSlotsSSBO.BeginWrite(liveSlots * sizeof(GLuint)));
+	GLuint instanceCount = 0;
+	for (auto& [meshID, metaData] : assToMesh) {
+		visibleLodSlots.clear();
+		for (const uint32_t slot : metaData.instanceSlots) {
+			if (meshInstVisibility[slot / CULL_BATCH_SIZE] & (1u << (slot % CULL_BATCH_SIZE)))
+				visibleLodSlots.emplace_back(SelectMeshLod(slot, lodFactor, cameraPosition), slot);
+		}
+		if (metaData.lodCount > 1)
+			std::sort(visibleLodSlots.begin(), visibleLodSlots.end());
+
+		size_t i = 0;
+		for (uint32_t lod = 0; lod < metaData.lodCount; lod++) {
+			const uint32_t cmdIndex = metaData.drawCmdIndex + lod;
+			MeshDrawCmdData& cmdData = meshDrawCmdDataArray[cmdIndex];
+			cmdData.baseInstance = instanceCount;
+
+			for (; i < visibleLodSlots.size() && visibleLodSlots[i].first == cmdIndex; i++)
+				visibleSlots[instanceCount++] = visibleLodSlots[i].second;
+			cmdData.instanceCount = instanceCount - cmdData.baseInstance;
 		}
-		cmdData.instanceCount = meshInstDataArray.size() - cmdData.baseInstance;
 	}
-	std::cout << "Vertices: " << vertices << std::endl;
+	visibleSlotsSSBO.EndWrite();
 
 	meshDIB.UpdateData(0, meshDrawCmdDataArray.size() * sizeof(MeshDrawCmdData), meshDrawCmdDataArray.data());
-	meshSSBO.UpdateData(0, meshInstDataArray.size() * sizeof(MeshInstanceData), meshInstDataArray.data());
+}
+
+/* Rasterizes the occluders that survived the frustum cull into the occlusion buffer,
+then clears the visibility bit of every slot hidden behind them. */
+void OpenGlApi::CullOccludedInstances() {
+	PROFILE_SCOPE("OpenGlApi::CullOccludedInstances", "Render");
+
+	occlusionBuffer.Clear(currentActiveCamera->projMatrix * currentActiveCamera->viewMatrix);
+
+	uint32_t triangles = 0;
+	for (const auto& [slot, meshID] : occluderSlots) {
+		if (!(meshInstVisibility[slot / CULL_BATCH_SIZE] & (1u << (slot % CULL_BATCH_SIZE))))
+			continue;
+
+		const Mesh* mesh = AssetManager::Get().GetAssetById<Mesh>(meshID);
+		if (mesh == nullptr || triangles + mesh->indices.size() / 3 > maxOccluderTriangles)
+			continue;
+
+		triangles += occlusionBuffer.RenderOccluder(mesh->vertices, mesh->indices, meshInstanceDataArray[slot].model);
+	}
+
+	if (triangles == 0)
+		return;
+
+	occlusionBuffer.UpdateTiles();
+	occlusionBuffer.CullBounds(meshInstBounds, meshInstSlotCount, meshInstVisibility);
+}
+
+/* Coarsest lod of the slot's mesh whose error, projected at the instance's distance from the
+viewer, stays within the pixel budget folded into factor. Returns the draw command index of that lod. */
+uint32_t OpenGlApi::SelectMeshLod(const uint32_t slot, const float factor, const Vec3& viewPosition) const {
+	const MeshInstanceData& instance = meshInstanceDataArray[slot];
+	const uint32_t cmdIndex = instance.drawCmdIndex;
+	const float distance = glm::length(Vec3(instance.boundsCenter) - viewPosition);
+	const float radius = glm::length(instance.boundsExtent);
+
+	for (uint32_t lod = meshDrawCmdDataArray[cmdIndex].lodCount - 1; lod > 0; lod--) {
+		if (meshDrawCmdDataArray[cmdIndex + lod].lodError * radius * factor <= distance)
+			return cmdIndex + lod;
+	}
+
+	return cmdIndex;
+}
+
+/* Culls every slot in a compute pass that appends visible slots to the ranges
+reserved per draw command, a second pass then compacts the non empty commands. */
+void OpenGlApi::CullMeshInstancesGPU() {
+	// any instance may land in any lod, so each one gets a range for all of them
+	GLuint instanceOffset = 0;
+	for (auto& [meshID, metaData] : assToMesh) {
+		for (uint32_t lod = 0; lod < metaData.lodCount; lod++) {
+			MeshDrawCmdData& cmdData = meshDrawCmdDataArray[metaData.drawCmdIndex + lod];
+			cmdData.baseInstance = instanceOffset;
+			cmdData.instanceCount = 0;
+			instanceOffset += static_cast<GLuint>(metaData.instanceSlots.size());
+		}
+	}
+
+	drawCmdSourceSSBO.UpdateData(0, meshDrawCmdDataArray.size() * sizeof(MeshDrawCmdData), meshDrawCmdDataArray.data());
+	drawCountBuffer.Clear();
+
+	// the CPU path streams into the same bindings
+	gpuVisibleSlotsSSBO.BindBase();
+	gpuMeshDIB.BindBase();
+	drawCountBuffer.BindBase();
+
+	const Plane* planes[6] = { &cameraFrustum.leftFace, &cameraFrustum.rightFace, &cameraFrustum.topFace,
+							   &cameraFrustum.bottomFace, &cameraFrustum.nearFace, &cameraFrustum.farFace };
+	Vec4 frustumPlanes[6];
+	for (size_t i = 0; i < 6; i++)
+		frustumPlanes[i] = Vec4(planes[i]->normal, planes[i]->distance);
+
+	{
+		const bool useHiZ = hiZValid && hiZCfg.Get();
+
+		BIND(Shader, cullShader);
+		BIND_TEX(Texture2D, hiZTex2D, 0);
+		cullShader.SetUInt("uSlotCount", meshInstSlotCount);
+		cullShader.SetUVec4v("uFrustumPlanes", 6, frustumPlanes);
+		cullShader.SetUBool("uHiZEnabled", useHiZ);
+		cullShader.SetUMat4("uHiZViewProj", hiZViewProj);
+		cullShader.SetUInt("uHiZLevels", static_cast<uint32_t>(hiZTex2D.GetLevels()));
+		cullShader.SetUVec3("uCameraPosition", cameraPosition);
+		cullShader.SetUFloat("uLodFactor", lodFactor);
+		cullShader.Dispatch((meshInstSlotCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+	}
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	{
+		const GLuint drawCmdCount = static_cast<GLuint>(meshDrawCmdDataArray.size());
+
+		BIND(Shader, drawCompactShader);
+		drawCompactShader.SetUInt("uDrawCmdCount", drawCmdCount);
+		drawCompactShader.Dispatch((drawCmdCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+	}
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+/* Fences this frame's regions of the streamed buffers, call after the last pass. */
+void OpenGlApi::EndFrame() {
+	meshDIB.EndFrame();
+	visibleSlotsSSBO.EndFrame();
+	drawCmdSourceSSBO.EndFrame();
+	cameraDataUBO.EndFrame();
+	sceneLightDataUBO.EndFrame();
+	cascadeDataUBO.EndFrame();
+	shadowCasterSlotsSSBO.EndFrame();
+	shadowCasterDIB.EndFrame();
+	cascadeCasterSlotsSSBO.EndFrame();
+	cascadeCasterDIB.EndFrame();
+	lightClusterDataUBO.EndFrame();
+	lightClustersSSBO.EndFrame();
+	lightIndicesSSBO.EndFrame();
+	textureStreamer.EndFrame();
+	frameIndex++;
 }
 
 void OpenGlApi::GeometryPass() {
-	BIND(Shader, gBufferShader);
-	BIND(FrameBuffer, gBufferFBO);
-	SetViewport(0, 0, gBufferFBO.GetWidth(), gBufferFBO.GetHeight());
-	DrawScene(true, GL_BACK);
+	{
+		BIND(Shader, gBufferShader);
+		BIND(FrameBuffer, gBufferFBO);
+		SetViewport(0, 0, gBufferFBO.GetWidth(), gBufferFBO.GetHeight());
+		DrawScene(true, GL_BACK);
+	}
+
+	hiZValid = false;
+	if (gpuCulling && hiZCfg.Get())
+		BuildHiZ();
 }
 
 void OpenGlApi::SSAOPass() {
-	SetViewport(0, 
-				0, 
-				cfg::Rendering.Read<uint32_t>("Video", "video.resX", 800), 
-			    cfg::Rendering.Read<uint32_t>("Video", "video.resY", 600));
+	SetViewport(0, 0, ssaoFBO.GetWidth(), ssaoFBO.GetHeight());
 
 	{
 		BIND_TEX(Texture2D, gViewPosition, 0);
@@ -988,6 +1889,17 @@ void OpenGlApi::SSAOPass() {
 
 }
 
+/* Only the tweakable parameters are refreshed, the kernel and noise stay as they were. */
+void OpenGlApi::UpdateSSAOSettings() {
+	const float radius = cfg::Rendering.Read<float>("OpenGL", "opengl.ssao.radius", 0.5f);
+	const float bias = cfg::Rendering.Read<float>("OpenGL", "opengl.ssao.bias", 0.025f);
+	const float power = cfg::Rendering.Read<float>("OpenGL", "opengl.ssao.power", 1.0f);
+
+	ssaoSettingsDataUBO.UpdateData(offsetof(SSAOSettingsData, radius), sizeof(float), &radius);
+	ssaoSettingsDataUBO.UpdateData(offsetof(SSAOSettingsData, bias), sizeof(float), &bias);
+	ssaoSettingsDataUBO.UpdateData(offsetof(SSAOSettingsData, power), sizeof(float), &power);
+}
+
 void OpenGlApi::SetDepthEnabled(const bool val)
 {
 	if (mDepthEnabled == val) return;
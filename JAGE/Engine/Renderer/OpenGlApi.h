@@ -5,6 +5,12 @@
 #include "Types/FrameBuffer.h"
 #include "Types/Texture.h"
 #include "Types/VertexArray.h"
+#include "Types/GpuTimer.h"
+#include "Culling.h"
+#include "OcclusionBuffer.h"
+#include "BVH.h"
+#include "LightClusters.h"
+#include "TextureStreamer.h"
 #include <ECS/Components/Transform.h>
 #include <Core/Core.h>
 #include <Core/Config.h>
@@ -20,10 +26,28 @@
 #define SSBO_MESH_INDIRECT_DRAW_COMMAND 7
 #define UBO_SHADOW_CASCADE_DATA 8
 #define UBO_SSAO_SETTINGS_DATA 9
+#define SSBO_VISIBLE_INSTANCE_SLOTS 10
+#define SSBO_MESH_DRAW_COMMAND_SOURCE 11
+#define SSBO_MESH_DRAW_COUNT 12
+#define SSBO_SHADOW_CASTER_SLOTS 13
+#define SSBO_SHADOW_CASTER_DRAW_COMMAND 14
+#define UBO_LIGHT_CLUSTER_DATA 15
+#define SSBO_LIGHT_CLUSTERS 16
+#define SSBO_LIGHT_INDICES 17
 
 #define SHADOW_MAP_MAX_CASCADES 16
 #define SSAO_KERNEL_SIZE 64
 
+// compute work group sizes, must match the local sizes in the shaders
+#define CULL_GROUP_SIZE 64
+#define HIZ_GROUP_SIZE 8
+
+#define MESH_INSTANCE_FREE_SLOT 0xFFFFFFFFu
+
+// point shadow caster entries pack the slot with the mask of cube faces it touches
+#define SHADOW_CASTER_FACE_SHIFT 26
+#define SHADOW_CASTER_SLOT_MASK ((1u << SHADOW_CASTER_FACE_SHIFT) - 1u)
+
 struct Vertex;
 struct Texture;
 struct Transform;
@@ -33,42 +57,7 @@ struct Camera;
 struct DirectionalLight;
 struct PointLight;
 struct StaticMeshRenderer;
-
-struct Plane {
-	Vec3 normal = { 0.f, 1.f, 0.f };
-	float distance = 0.f;
-
-	Plane() = default;
-
-	Plane(const Vec3& p1, const Vec3& norm)
-		: normal(glm::normalize(norm)),
-		  distance(glm::dot(normal, p1)) {};
-
-	float getSignedDistanceToPlane(const glm::vec3& point) const
-	{
-		return glm::dot(normal, point) - distance;
-	}
-};
-
-struct Frustum {
-	Plane topFace;
-	Plane bottomFace;
-
-	Plane rightFace;
-	Plane leftFace;
-
-	Plane farFace;
-	Plane nearFace;
-};
-
-struct BoundingSphere {
-	Vec3 center{ 0.f };
-	float radius{ 1.f };
-
-	bool isOnOrForwardPlane(const Plane& plane) const {
-		return plane.getSignedDistanceToPlane(center) > -radius;
-	}
-};
+class ShaderPreProcessor;
 
 struct SSAOSettingsData {
 	GLuint  kernelSize;
@@ -87,6 +76,19 @@ struct CascadeData {
 	float padding[2];
 };
 
+/* When a cascade was last drawn, far cascades are only redrawn every few frames. */
+struct CascadeUpdateData {
+	uint32_t interval = 1;		// frames between redraws
+	bool valid = false;			// drawn since the camera or the light were set
+};
+
+/* A range of cascadeCasterCmds drawn into one cascade layer. */
+struct CascadeCasterDraw {
+	uint32_t cascade = 0;
+	uint32_t firstCmd = 0;
+	uint32_t cmdCount = 0;
+};
+
 struct MeshDrawCmdData {
 	GLuint count         = 0;	// n of indices to draw for each instance
 	GLuint instanceCount = 0;	// n of instances to draw
@@ -97,18 +99,26 @@ struct MeshDrawCmdData {
 	GLint diffTexHndlrIndex = -1;
 	GLint specTexHndlrIndex = -1;
 	GLint normTexHndlrIndex = -1;
+
+	GLuint lodCount = 1;		// commands of the mesh's lod chain, they follow lod 0 in the array
+	float lodError = 0.0f;		// simplification error relative to the bounds radius
 };
 
 
 struct MeshInstanceData {
 	Mat4 model;
 	Mat4 inverseModel;
-	GLboolean shouldDraw = false;
-	float padding[3];
+	Vec4 boundsCenter{ 0.0f };		// world AABB, read by the culling compute pass
+	Vec3 boundsExtent{ 0.0f };
+	GLuint drawCmdIndex = MESH_INSTANCE_FREE_SLOT;
 };
 
 struct MeshMetaData {
-	int32_t drawCmdIndex = -1;
+	int32_t drawCmdIndex = -1;				// lod 0, the coarser levels follow
+	uint32_t lodCount = 1;
+	std::vector<uint32_t> instanceSlots;	// slots of the live instances of this mesh
+	Vec3 boundsMin{ 0.0f };
+	Vec3 boundsMax{ 0.0f };
 };
 
 struct SceneLightData {
@@ -127,16 +137,41 @@ struct SceneLightData {
 
 struct PointLightData {
 	Vec3	  mPosition;
-	float     padding;
+	GLint     shadowLayer;		// cube map in the shadow arrays, -1 when the light casts no shadows
 	Vec3	  mColor;
 	float	  mIntensity;
 	float	  shadowFarPlane;
 	float	  shadowNearPlane;
 	GLuint	  dataArrayIndex;
-	float     padding2;
+	float     range;			// distance where the falloff reaches zero
 	Mat4	  cubemapViewMatrices[6];
 };
 
+/* What the static layer of a point light's cube map was last rendered with. */
+struct PointShadowCacheData {
+	Vec3 position{ 0.0f };
+	float farPlane = 0.0f;
+	uint64_t staticSignature = 0;	// order independent hash of the static caster entries
+	bool valid = false;
+};
+
+/* How point light casters reach the six cube faces. */
+enum class PointShadowPath : uint8_t {
+	GeometryShader,		// one instance per caster, the geometry shader copies triangles to each face
+	Layered,			// one instance per caster face, the vertex shader picks the layer
+	PerFace				// one instance per caster face, one multi draw per face layer
+};
+
+/* A range of shadowCasterCmds drawn into the cube faces of one light. */
+struct ShadowCasterDraw {
+	uint32_t lightIndex = 0;
+	uint32_t shadowLayer = 0;
+	uint32_t firstCmd = 0;
+	uint32_t cmdCount = 0;
+	uint32_t faceCmdCounts[6] = {};	// commands of each face in order, the instanced paths sort by face
+	bool staticLayer = false;
+};
+
 struct CameraData {
 	Vec4 mPosition;
 	Mat4 mProjection{ 1.0f };
@@ -197,6 +232,8 @@ private:
 	Shader screenShader;
 	Shader gBufferShader;
 	Shader pointLightShadowMapShader;
+	Shader pointLightShadowLayeredShader;
+	Shader pointLightShadowFaceShader;
 	Shader varianceShadowMapShader;
 	Shader hBlurShadowMapShader;
 	Shader vBlurShadowMapShader;
@@ -204,13 +241,16 @@ private:
 	Shader ssaoShader;
 	Shader ssaoBlurShader;
 	Shader postFxShader;
+	Shader cullShader;
+	Shader drawCompactShader;
+	Shader hiZBuildShader;
 	
-	UniformBuffer sceneLightDataUBO;
-	UniformBuffer cameraDataUBO;
-	UniformBuffer cascadeDataUBO;
+	StreamingBuffer sceneLightDataUBO;
+	StreamingBuffer cameraDataUBO;
+	StreamingBuffer cascadeDataUBO;
 	UniformBuffer ssaoSettingsDataUBO;
 
-	DrawIndirectBuffer meshDIB;
+	StreamingBuffer meshDIB;
 
 	VertexArray meshVAO;
 	VertexArray screenQuadVAO;
@@ -221,14 +261,35 @@ private:
 	ElementArrayBuffer screenQuadEBO;
 	ElementArrayBuffer meshEBO;
 
-	ShaderStorageBuffer meshSSBO;
+	ShaderStorageBuffer meshInstanceSSBO;	// persistent, one slot per entity mesh
+	StreamingBuffer visibleSlotsSSBO;		// slots visible this frame, grouped by draw command
+
+	// GPU culling, the compute passes fill these and the CPU never reads them back
+	StreamingBuffer drawCmdSourceSSBO;		// commands with empty instance counts and reserved slot ranges
+	ShaderStorageBuffer gpuVisibleSlotsSSBO;
+	DrawIndirectBuffer gpuMeshDIB;
+	ParameterBuffer drawCountBuffer;
+
+	// point light shadow casters, every light's lists are packed into one region per frame
+	StreamingBuffer shadowCasterSlotsSSBO;
+	StreamingBuffer shadowCasterDIB;
+
+	// directional shadow casters of the cascades redrawn this frame, bound like the point light lists
+	StreamingBuffer cascadeCasterSlotsSSBO;
+	StreamingBuffer cascadeCasterDIB;
 	ShaderStorageBuffer textureHndlrsSSBO;
 	ShaderStorageBuffer pointLightDataArraySSBO;
 
+	// clustered lighting, rebuilt on the CPU every frame
+	StreamingBuffer lightClusterDataUBO;
+	StreamingBuffer lightClustersSSBO;
+	StreamingBuffer lightIndicesSSBO;
+
 	FrameBuffer screenFBO;
 	FrameBuffer gBufferFBO;
 	FrameBuffer shadowMapFBO;
 	FrameBuffer pointShadowFBO;
+	FrameBuffer pointShadowStaticFBO;
 	FrameBuffer hBlurShadowMapFBO;
 	FrameBuffer vBlurShadowMapFBO;
 	FrameBuffer lightingFBO;
@@ -245,10 +306,13 @@ private:
 	Texture2D gViewPosition;
 	Texture2D gViewNormal;
 	Texture2D gDepth;
+	Texture2D hiZTex2D;				// max depth pyramid of the last geometry pass
 	
 	/* Shadow maps */
 	Texture2DArray shadowMapTex2DArray;
+	Texture2DArray shadowMapDepthTex2DArray;
 	TextureCubeMapArray pointShadowCubemapArray;
+	TextureCubeMapArray pointShadowStaticCubemapArray;	// static casters only, copied into the array above every frame
 	Texture2D vBlurShadowMapTex2D;
 	Texture2D hBlurShadowMapTex2D;
 
@@ -264,21 +328,96 @@ private:
 	Camera* currentActiveCamera;
 	Frustum cameraFrustum;
 	
-	std::unordered_map<Asset, std::unordered_map<Entity, uint32_t>> assToEntMeshInstIndexes;
+	std::unordered_map<Entity, std::unordered_map<Asset, uint32_t>> entToMeshInstSlots;
 	std::unordered_map<Asset, MeshMetaData> assToMesh;
-	std::unordered_map<Asset, std::vector<MeshInstanceData>> assToMeshInsts;
 	std::unordered_map<Entity, PointLightData> entToPointLightData;
 
 	std::vector<CascadeData> cascadeDataArray;
+	uint32_t shadowCascadeCount = 0;	// fixed at init, the shadow map arrays are sized for it
+	uint32_t shadowMapResolution = 0;
+	std::vector<CascadeUpdateData> cascadeUpdates;
+	Vec3 cascadeLightDirection{ 0.0f };		// light direction the cascades were drawn with
+
+	std::vector<std::pair<uint32_t, uint32_t>> cascadeCasters;	// draw command index, slot
+	std::vector<MeshDrawCmdData> cascadeCasterCmds;
+	std::vector<GLuint> cascadeCasterSlots;
+	std::vector<CascadeCasterDraw> cascadeCasterDraws;
+
+	cfg::Handle<float> gammaCfg;
+	cfg::Handle<bool> gpuCullingCfg;
+	cfg::Handle<bool> hiZCfg;
+	cfg::Handle<bool> occlusionCullingCfg;
+	cfg::Handle<bool> bvhCullingCfg;
+
+	bool gpuCulling = false;		// path used this frame, fixed when the mesh data is uploaded
+	bool hiZValid = false;
+	Mat4 hiZViewProj{ 1.0f };
+
+	// an instance draws its coarsest lod whose error stays under the configured pixels
+	cfg::Handle<float> lodPixelErrorCfg;
+	cfg::Handle<float> lodShadowPixelErrorCfg;
+	Vec3 cameraPosition{ 0.0f };
+	float lodFactor = 0.0f;				// screen height over pixel error, in pixels per world unit at distance 1
+	float shadowLodFactor = 0.0f;
+	float pixelsPerUnit = 0.0f;			// screen pixels covered by one world unit at distance 1
+
+	OcclusionBuffer occlusionBuffer;
+	std::unordered_map<uint32_t, Asset> occluderSlots;	// slot to mesh of every occluder instance
+	uint32_t maxOccluderTriangles = 0;
 
 	std::vector<MeshDrawCmdData> meshDrawCmdDataArray;
-	std::vector<GLuint> meshIndexDataArray;
-	std::vector<Vertex> meshVertexDataArray;
+	std::vector<MeshInstanceData> meshInstanceDataArray;	// CPU copy of the instance SSBO, indexed by slot
+	BoundsSoA meshInstBounds;				// world bounds, indexed by slot
+	std::vector<uint8_t> meshInstVisibility;	// one bit per slot, written by the frustum cull
+	std::vector<std::pair<uint32_t, uint32_t>> visibleLodSlots;	// draw command index, slot of one mesh's visible instances
+	BVH meshInstTree;						// world bounds of the live slots, user data is the slot
+	std::vector<int32_t> meshInstProxies;	// tree leaf of each slot
+	std::vector<uint64_t> meshInstLastMoved;	// frame of the last bounds change of each slot
+	uint64_t frameIndex = 0;
+	uint32_t staticCasterFrames = 0;		// frames a caster has to rest before it joins the static shadow layer
+
+	PointShadowPath pointShadowPath = PointShadowPath::GeometryShader;
+	PointShadowPath pointShadowConfiguredPath = PointShadowPath::GeometryShader;
+	bool layerFromVertexSupported = false;
+
+	// times every point shadow path for a number of frames, then goes back to the configured one
+	GpuTimer pointShadowTimer;
+	std::vector<PointShadowPath> pointShadowBenchPaths;
+	size_t pointShadowBenchIndex = 0;
+	uint32_t pointShadowBenchFrames = 0;
+	uint32_t pointShadowBenchFrame = 0;
+	std::vector<uint32_t> dirtyMeshInstSlots;
+	std::stack<uint32_t> freeMeshInstSlots;
+	uint32_t meshInstSlotCount = 0;
+	uint32_t maxMeshInstances = 0;
+	GLuint meshIndexCount = 0;				// indices and vertices already in meshEBO and meshVBO
+	GLuint meshVertexCount = 0;
+	bool compactVertices = false;			// meshVBO holds PackedVertex instead of Vertex
+	std::vector<PackedVertex> packedVertices;
 	std::vector<uint32_t> depthCubemapDataArray;
 	std::vector<PointLightData> pointLightDataArray;
-
-	std::unordered_map<Asset, Texture2D> assetIDToTex2DMap;
+	BVH pointLightTree;						// shadow range of each light, user data is the data array index
+	std::unordered_map<Entity, int32_t> entToPointLightProxy;
+	std::vector<PointShadowCacheData> pointShadowCaches;	// indexed like pointLightDataArray
+	uint32_t maxPointLights = 0;
+	uint32_t maxShadowedPointLights = 0;	// layers of the point shadow arrays, taken by the first lights registered
+	uint32_t shadowedPointLightCount = 0;
+	float lightAttenuationCutoff = 0.0f;	// intensity below which a light's range ends
+
+	LightClusters lightClusters;
+	uint32_t droppedClusterLights = 0;	// lights cut by the per cluster cap last frame
+
+	std::vector<uint32_t> pointShadowLights;
+	std::vector<std::pair<uint32_t, uint32_t>> staticShadowCasters;	// draw command index, caster entry
+	std::vector<std::pair<uint32_t, uint32_t>> dynamicShadowCasters;
+	std::vector<MeshDrawCmdData> shadowCasterCmds;
+	std::vector<GLuint> shadowCasterSlots;
+	std::vector<ShadowCasterDraw> shadowCasterDraws;
+	std::vector<uint64_t> shadowCasterKeys;		// face, draw command and entry, sorted to group the draws
+
+	std::unordered_map<Asset, Texture2D> assetIDToTex2DMap;	// streamed textures only carry their handle index here
 	std::vector<GLuint64> tex2DHndlrDataArray;
+	TextureStreamer textureStreamer;
 
 	void SetDepthEnabled(const bool val);
 	void SetFaceCullEnabled(const bool val);
@@ -294,27 +433,33 @@ private:
 	void InitLightingFBO();
 	void InitPostFxFBO();
     void InitSSAOUniformBuffer();
+	void UpdateSSAOSettings();
+	void InitHiZ();
+	void BuildHiZ();
+
+	Texture2D CreateUncompressedTexture2D(const Texture* texture);
+
+	void CullMeshInstancesCPU();
+	void CullOccludedInstances();
+	void CullMeshInstancesGPU();
+	uint32_t SelectMeshLod(const uint32_t slot, const float factor, const Vec3& viewPosition) const;
+	void RequestStreamedTextures();
+	void DrawMeshes();
+	void GatherPointShadowCasters(const PointLightData& light);
+	ShadowCasterDraw AppendShadowCasterCmds(const uint32_t lightIndex, const std::vector<std::pair<uint32_t, uint32_t>>& casters, const bool staticLayer);
+	void DrawShadowCasters(Shader& shader, const ShadowCasterDraw& draw, FrameBuffer& fbo, const TextureCubeMapArray& cubemapArray);
+	void InitPointShadowPaths(const ShaderPreProcessor& spp);
+	void UpdatePointShadowBenchmark();
+	void BuildLightClusters();
     
     std::vector<Vec4> GetFrustumCornersWorldSpace(const float fov, const float aspectRatio, const float nearPlane, const float farPlane, const Mat4 &view);
-    Mat4 GetLightSpaceMatrix(const Mat4 &lightViewMatrix, const std::vector<Vec4> &corners);
-    Mat4 GetLightViewMatrix(const Vec3 &lightDir, const std::vector<Vec4> &frustumCorners);
+    Mat4 GetCascadeMatrix(const Vec3 &lightDir, const std::vector<Vec4> &corners, const float casterDistance);
+    bool CascadeCovers(const Mat4 &lightSpaceMatrix, const std::vector<Vec4> &corners);
+    void AppendCascadeCasterCmds(const uint32_t cascade);
     Mat4 CalculateModelMatrix(const Vec3& position, const glm::quat& rotation, const Vec3& scale);
 
 	void UpdateCameraFrustum(const Transform* transform);
 
-	bool IsOnFrustum(const Transform* transform) const
-	{
-		const float maxScale = std::max(std::max(transform->scale.x, transform->scale.y), transform->scale.z);
-		BoundingSphere boundingSphere(transform->position, maxScale * 0.5f);
-
-		return (boundingSphere.isOnOrForwardPlane(cameraFrustum.leftFace) &&
-			boundingSphere.isOnOrForwardPlane(cameraFrustum.rightFace) &&
-			boundingSphere.isOnOrForwardPlane(cameraFrustum.farFace) &&
-			boundingSphere.isOnOrForwardPlane(cameraFrustum.nearFace) &&
-			boundingSphere.isOnOrForwardPlane(cameraFrustum.topFace) &&
-			boundingSphere.isOnOrForwardPlane(cameraFrustum.bottomFace));
-	}
-
 public:
 	OpenGlApi(const OpenGlApi&) = delete;
 	OpenGlApi& operator=(const OpenGlApi&) = delete;
@@ -342,7 +487,10 @@ public:
 	// Buffering
 	void RegisterTexture2D(Texture* texture);
 	void RegisterMesh(const Mesh* mesh);
-	void UpsertMeshEntity(const Entity entity, const StaticMeshRenderer* smRenderer, const Transform* transform);
+	void RegisterMesh(const Mesh* mesh, const MeshData& data);
+	void UpsertMeshEntity(const Entity entity, StaticMeshRenderer* smRenderer);
+	void RemoveMeshEntity(const Entity entity);
+	void ReleaseMeshInstSlot(const Asset meshID, const uint32_t slot);
 	
 	// Passes
 	void GeometryPass();
@@ -354,6 +502,8 @@ public:
 	void OutputToScreen(const SceneTexture st);
 
 
+	void EndFrame();
+
     void DrawScreenQuad(Texture2D& texture);
     void DrawScene(const bool withDepth, const GLenum faceCulling, const bool clear = true);
 };
\ No newline at end of file
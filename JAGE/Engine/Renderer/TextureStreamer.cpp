@@ -0,0 +1,412 @@
+#include "TextureStreamer.h"
+#include <Core/Assets/TextureCooker.h>
+#include <Core/Config.h>
+#include <Core/Profiler.h>
+
+namespace {
+	/* First level no larger than tailSize on either side, the 1x1 level at worst. */
+	uint32_t GetTailLevel(const Texture& info, const uint32_t tailSize) {
+		for (uint32_t level = 0; level < info.mips.size(); level++) {
+			if (std::max(info.mips[level].width, info.mips[level].height) <= tailSize)
+				return level;
+		}
+		return static_cast<uint32_t>(info.mips.size() - 1);
+	}
+}
+
+void TextureStreamer::Start(const TextureStreamSettings& settings, HandleCallback onHandleChanged) {
+	if (IsRunning())
+		return;
+
+	this->settings = settings;
+	this->onHandleChanged = std::move(onHandleChanged);
+
+	// cooking a missing cache has to match the options its path was hashed with
+	useBC7 = cfg::Engine.Read<bool>("Assets", "assets.textures.bc7", false);
+
+	// a row of blocks of any sensible texture fits in a frame's region
+	this->settings.uploadBudget = std::max<GLsizeiptr>(settings.uploadBudget, 1 << 20);
+	stagingPBO = StreamingBuffer(GL_PIXEL_UNPACK_BUFFER, 0, this->settings.uploadBudget);
+
+	// mid grey for every map and a flat tangent space normal for normal maps
+	const uint8_t grey[4] = { 128, 128, 128, 255 };
+	const uint8_t flatNormal[4] = { 128, 128, 255, 255 };
+	placeholder = Texture2D("StreamPlaceholder", GL_RGBA8, 1, 1);
+	placeholder.SetSubImage2D(GL_RGBA, 0, 0, 0, GL_UNSIGNED_BYTE, grey);
+	placeholder.MakeResident();
+	normalPlaceholder = Texture2D("StreamNormalPlaceholder", GL_RGBA8, 1, 1);
+	normalPlaceholder.SetSubImage2D(GL_RGBA, 0, 0, 0, GL_UNSIGNED_BYTE, flatNormal);
+	normalPlaceholder.MakeResident();
+
+	for (uint32_t i = 0; i < std::max(1u, settings.threads); i++)
+		workers.emplace_back([this](std::stop_token stopToken) { Run(stopToken); });
+
+	LOG(LogOpenGL, LOG_VERBOSE, std::format("Texture streaming started with {} threads, {}kb uploads per frame and a {}mb budget.",
+		workers.size(), this->settings.uploadBudget / 1024, settings.memoryBudget / (1024 * 1024)));
+}
+
+void TextureStreamer::Stop() {
+	for (std::jthread& worker : workers)
+		worker.request_stop();
+
+	jobAvailable.notify_all();
+	workers.clear();
+}
+
+GLuint64 TextureStreamer::Register(const Texture* texture, const uint32_t handleIndex) {
+	const uint32_t index = static_cast<uint32_t>(textures.size());
+	StreamedTexture& streamed = textures.emplace_back();
+	streamed.info = *texture;
+	streamed.info.data = nullptr;
+	streamed.info.compressedData.clear();
+	streamed.cachePath = texture->cookedPath;
+	streamed.handleIndex = handleIndex;
+	handleToTexture[handleIndex] = index;
+
+	if (streamed.info.compressedFormat == 0) {
+		// nothing cooked yet, the worker cooks the whole chain and its tail comes back with it
+		streamed.loading = true;
+
+		TextureStreamJob job;
+		job.texture = index;
+		job.info = streamed.info;
+		job.cachePath = streamed.cachePath;
+		{
+			std::lock_guard<std::mutex> lock(jobsMutex);
+			jobs.push_back(std::move(job));
+		}
+		jobAvailable.notify_one();
+	}
+	else {
+		const uint32_t mipCount = static_cast<uint32_t>(streamed.info.mips.size());
+		streamed.tailLevel = GetTailLevel(streamed.info, settings.tailSize);
+		streamed.residentLevel = mipCount;
+		streamed.requestedLevel = streamed.tailLevel;
+		QueueLevels(index, streamed.tailLevel, mipCount - 1);
+	}
+
+	return texture->type == TextureAssetType::Normal ? normalPlaceholder.GetHandle() : placeholder.GetHandle();
+}
+
+void TextureStreamer::Request(const uint32_t handleIndex, const float pixels, const uint64_t frame) {
+	auto it = handleToTexture.find(handleIndex);
+	if (it == handleToTexture.end())
+		return;
+
+	StreamedTexture& texture = textures[it->second];
+	if (texture.lastRequestFrame != frame)
+		texture.requestedLevel = texture.tailLevel;
+	texture.lastRequestFrame = frame;
+
+	// still cooking, the size is not known yet
+	if (texture.info.mips.empty())
+		return;
+
+	// the finest level with no more texels across than the pixels it covers
+	const float size = static_cast<float>(std::max(texture.info.width, texture.info.height));
+	const float level = std::floor(std::log2(size / std::max(pixels, 1.0f)) + settings.mipBias);
+	const uint32_t wanted = static_cast<uint32_t>(std::clamp(level, 0.0f, static_cast<float>(texture.tailLevel)));
+	texture.requestedLevel = std::min(texture.requestedLevel, wanted);
+}
+
+void TextureStreamer::Update(const uint64_t frame) {
+	PROFILE_SCOPE("TextureStreamer::Update", "Render");
+
+	currentFrame = frame;
+	RetireTextures();
+	ApplyResults();
+	ProcessUploads();
+	UpdateResidency();
+}
+
+/* Fences the staging region written this frame. */
+void TextureStreamer::EndFrame() {
+	if (IsRunning())
+		stagingPBO.EndFrame();
+}
+
+void TextureStreamer::Run(std::stop_token stopToken) {
+	while (!stopToken.stop_requested()) {
+		TextureStreamJob job;
+		{
+			std::unique_lock<std::mutex> lock(jobsMutex);
+			if (!jobAvailable.wait(lock, stopToken, [this] { return !jobs.empty(); }))
+				return;
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		if (job.info.compressedFormat == 0) {
+			std::ifstream file(job.info.assetPath, std::ios::binary | std::ios::ate);
+			std::vector<uint8_t> source(file.is_open() ? static_cast<size_t>(file.tellg()) : 0);
+			file.seekg(0);
+
+			job.ok = file.is_open() && file.read(reinterpret_cast<char*>(source.data()), source.size()) &&
+				TextureCooker::CookSource(source, job.info, useBC7);
+
+			// a failed write only means cooking again next run
+			if (job.ok)
+				TextureCooker::WriteCache(job.cachePath, job.info);
+		}
+		else {
+			job.ok = TextureCooker::ReadCacheLevels(job.cachePath, job.info, job.firstLevel, job.lastLevel, job.info.compressedData);
+		}
+
+		std::lock_guard<std::mutex> lock(resultsMutex);
+		results.push_back(std::move(job));
+	}
+}
+
+void TextureStreamer::QueueLevels(const uint32_t index, const uint32_t firstLevel, const uint32_t lastLevel) {
+	StreamedTexture& texture = textures[index];
+	texture.loading = true;
+	pendingBytes += GetLevelBytes(texture, firstLevel, lastLevel + 1);
+
+	TextureStreamJob job;
+	job.texture = index;
+	job.firstLevel = firstLevel;
+	job.lastLevel = lastLevel;
+	job.info = texture.info;
+	job.cachePath = texture.cachePath;
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+/* Deletes the textures whose handles were replaced long enough ago that no frame in flight uses them. */
+void TextureStreamer::RetireTextures() {
+	for (size_t i = 0; i < retiredTextures.size();) {
+		if (currentFrame - retiredTextures[i].first < TEXTURE_STREAM_RETIRE_FRAMES) {
+			i++;
+			continue;
+		}
+
+		retiredTextures[i].second.MakeNonResident();
+		retiredTextures[i].second.Clear();
+		retiredTextures[i] = std::move(retiredTextures.back());
+		retiredTextures.pop_back();
+	}
+}
+
+void TextureStreamer::ApplyResults() {
+	{
+		std::lock_guard<std::mutex> lock(resultsMutex);
+		finishedJobs.swap(results);
+	}
+
+	for (TextureStreamJob& job : finishedJobs) {
+		StreamedTexture& texture = textures[job.texture];
+		const bool cooked = texture.info.compressedFormat == 0;
+
+		if (!job.ok) {
+			LOG(LogOpenGL, LOG_WARNING, std::format("Failed to stream texture {} from {}.", texture.info.assetPath, texture.cachePath));
+			if (!cooked)
+				pendingBytes -= GetLevelBytes(texture, job.firstLevel, job.lastLevel + 1);
+			texture.loading = false;
+			texture.failed = true;
+			continue;
+		}
+
+		TextureUpload upload;
+		upload.texture = job.texture;
+
+		if (cooked) {
+			texture.info.compressedFormat = job.info.compressedFormat;
+			texture.info.width = job.info.width;
+			texture.info.height = job.info.height;
+			texture.info.hasAlphaChannel = job.info.hasAlphaChannel;
+			texture.info.mips = job.info.mips;
+
+			const uint32_t mipCount = static_cast<uint32_t>(texture.info.mips.size());
+			texture.tailLevel = GetTailLevel(texture.info, settings.tailSize);
+			texture.residentLevel = mipCount;
+			texture.requestedLevel = texture.tailLevel;
+			pendingBytes += GetLevelBytes(texture, texture.tailLevel, mipCount);
+
+			LOG(LogOpenGL, LOG_VERBOSE, std::format("Cooked texture {} into {}. Width: {} | Height: {} | Mips: {}",
+				texture.info.assetPath, texture.cachePath, texture.info.width, texture.info.height, mipCount));
+
+			upload.firstLevel = texture.tailLevel;
+			upload.lastLevel = mipCount - 1;
+			upload.data.assign(job.info.compressedData.begin() + texture.info.mips[texture.tailLevel].offset, job.info.compressedData.end());
+		}
+		else {
+			upload.firstLevel = job.firstLevel;
+			upload.lastLevel = job.lastLevel;
+			upload.data = std::move(job.info.compressedData);
+		}
+
+		upload.level = upload.firstLevel;
+		uploads.push_back(std::move(upload));
+	}
+
+	finishedJobs.clear();
+}
+
+/* Copies whole rows of blocks into the staging region and from there into the textures,
+in order, until the frame's budget is spent. A texture's handle is swapped once all its new
+levels are in. */
+void TextureStreamer::ProcessUploads() {
+	if (uploads.empty())
+		return;
+
+	uint8_t* staging = static_cast<uint8_t*>(stagingPBO.BeginWrite(settings.uploadBudget));
+	const GLintptr regionOffset = stagingPBO.GetRegionOffset();
+	GLsizeiptr written = 0;
+
+	stagingPBO.Bind();
+	while (!uploads.empty()) {
+		TextureUpload& upload = uploads.front();
+		StreamedTexture& texture = textures[upload.texture];
+
+		if (!upload.started) {
+			upload.target = CreateTexture(texture, upload.firstLevel);
+			if (texture.residentLevel < texture.info.mips.size())
+				CopyLevels(texture, upload.target, upload.firstLevel, texture.residentLevel);
+			upload.started = true;
+		}
+
+		const TextureMip& mip = texture.info.mips[upload.level];
+		const uint32_t blockRows = (mip.height + 3) / 4;
+		const size_t rowBytes = mip.size / blockRows;
+		const uint32_t rows = std::min(blockRows - upload.row, static_cast<uint32_t>((settings.uploadBudget - written) / rowBytes));
+		if (rows == 0)
+			break;
+
+		const size_t size = rows * rowBytes;
+		const size_t dataOffset = mip.offset - texture.info.mips[upload.firstLevel].offset + upload.row * rowBytes;
+		std::memcpy(staging + written, upload.data.data() + dataOffset, size);
+
+		const uint32_t y = upload.row * 4;
+		upload.target.SetCompressedSubImage2D(static_cast<GLint>(upload.level - upload.firstLevel), y, mip.width, std::min(rows * 4, mip.height - y),
+			static_cast<GLsizei>(size), reinterpret_cast<const void*>(regionOffset + written));
+		written += size;
+
+		upload.row += rows;
+		if (upload.row < blockRows)
+			continue;
+
+		upload.row = 0;
+		if (++upload.level <= upload.lastLevel)
+			continue;
+
+		pendingBytes -= GetLevelBytes(texture, upload.firstLevel, upload.lastLevel + 1);
+		SwapTexture(texture, upload.target, upload.firstLevel);
+		texture.loading = false;
+		uploads.pop_front();
+	}
+	stagingPBO.Unbind();
+}
+
+/* Drops what textures no longer need and reads what they are missing, the textures furthest
+from their request first. Textures not requested this frame keep their levels until they idle. */
+void TextureStreamer::UpdateResidency() {
+	loadOrder.clear();
+	evictionOrder.clear();
+
+	for (uint32_t i = 0; i < textures.size(); i++) {
+		StreamedTexture& texture = textures[i];
+		if (texture.loading || texture.failed)
+			continue;
+
+		if (currentFrame - texture.lastRequestFrame > settings.idleFrames) {
+			if (texture.residentLevel < texture.tailLevel)
+				DropLevels(texture, texture.tailLevel);
+			continue;
+		}
+
+		if (texture.lastRequestFrame != currentFrame)
+			continue;
+
+		// one level of slack, so that a texture on a mip boundary does not flip every frame
+		if (texture.requestedLevel > texture.residentLevel + 1)
+			DropLevels(texture, texture.requestedLevel - 1);
+		else if (texture.requestedLevel < texture.residentLevel)
+			loadOrder.emplace_back(texture.residentLevel - texture.requestedLevel, i);
+	}
+
+	std::sort(loadOrder.begin(), loadOrder.end(), [](const auto& l, const auto& r) { return l.first > r.first; });
+	for (const auto& [missingLevels, i] : loadOrder) {
+		StreamedTexture& texture = textures[i];
+		if (!MakeRoom(GetLevelBytes(texture, texture.requestedLevel, texture.residentLevel)))
+			continue;
+
+		QueueLevels(i, texture.requestedLevel, texture.residentLevel - 1);
+	}
+}
+
+/* Drops the least recently requested textures to their tail until bytes more fit in the
+budget. Textures requested this frame are left alone. */
+bool TextureStreamer::MakeRoom(const size_t bytes) {
+	if (residentBytes + pendingBytes + bytes <= settings.memoryBudget)
+		return true;
+
+	if (evictionOrder.empty()) {
+		for (uint32_t i = 0; i < textures.size(); i++) {
+			const StreamedTexture& texture = textures[i];
+			if (!texture.loading && !texture.failed && texture.residentLevel < texture.tailLevel && texture.lastRequestFrame != currentFrame)
+				evictionOrder.emplace_back(texture.lastRequestFrame, i);
+		}
+
+		// oldest last
+		std::sort(evictionOrder.begin(), evictionOrder.end(), [](const auto& l, const auto& r) { return l.first > r.first; });
+	}
+
+	while (residentBytes + pendingBytes + bytes > settings.memoryBudget && !evictionOrder.empty()) {
+		StreamedTexture& texture = textures[evictionOrder.back().second];
+		evictionOrder.pop_back();
+		DropLevels(texture, texture.tailLevel);
+	}
+
+	return residentBytes + pendingBytes + bytes <= settings.memoryBudget;
+}
+
+Texture2D TextureStreamer::CreateTexture(const StreamedTexture& texture, const uint32_t firstLevel) const {
+	const TextureMip& top = texture.info.mips[firstLevel];
+	const GLsizei levels = static_cast<GLsizei>(texture.info.mips.size() - firstLevel);
+
+	Texture2D glTexture(texture.info.assetName, texture.info.compressedFormat, top.width, top.height, levels);
+	glTexture.SetParam(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	return glTexture;
+}
+
+/* Copies levels firstLevel to the last one from the resident texture into target, whose level 0 is targetFirstLevel. */
+void TextureStreamer::CopyLevels(const StreamedTexture& texture, const Texture2D& target, const uint32_t targetFirstLevel, const uint32_t firstLevel) const {
+	for (uint32_t level = firstLevel; level < texture.info.mips.size(); level++) {
+		const TextureMip& mip = texture.info.mips[level];
+		glCopyImageSubData(texture.glTexture.GetID(), GL_TEXTURE_2D, static_cast<GLint>(level - texture.residentLevel), 0, 0, 0,
+			target.GetID(), GL_TEXTURE_2D, static_cast<GLint>(level - targetFirstLevel), 0, 0, 0,
+			mip.width, mip.height, 1);
+	}
+}
+
+void TextureStreamer::SwapTexture(StreamedTexture& texture, Texture2D& target, const uint32_t firstLevel) {
+	const uint32_t mipCount = static_cast<uint32_t>(texture.info.mips.size());
+
+	target.MakeResident();
+	onHandleChanged(texture.handleIndex, target.GetHandle());
+
+	if (texture.glTexture.GetID() != 0)
+		retiredTextures.emplace_back(currentFrame, texture.glTexture);
+
+	residentBytes -= GetLevelBytes(texture, texture.residentLevel, mipCount);
+	residentBytes += GetLevelBytes(texture, firstLevel, mipCount);
+	texture.glTexture = target;
+	texture.residentLevel = firstLevel;
+}
+
+void TextureStreamer::DropLevels(StreamedTexture& texture, const uint32_t firstLevel) {
+	Texture2D target = CreateTexture(texture, firstLevel);
+	CopyLevels(texture, target, firstLevel, firstLevel);
+	SwapTexture(texture, target, firstLevel);
+}
+
+size_t TextureStreamer::GetLevelBytes(const StreamedTexture& texture, const uint32_t firstLevel, const uint32_t endLevel) const {
+	size_t bytes = 0;
+	for (uint32_t level = firstLevel; level < endLevel; level++)
+		bytes += texture.info.mips[level].size;
+	return bytes;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Types/Buffer.h"
+#include "Types/Texture.h"
+#include <Core/Core.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+// frames a replaced texture stays alive, the frames in flight may still sample it
+#define TEXTURE_STREAM_RETIRE_FRAMES (STREAMING_BUFFER_FRAMES + 1)
+
+struct TextureStreamSettings {
+	uint32_t threads = 2;
+	GLsizeiptr uploadBudget = 0;	// bytes copied into textures per frame
+	size_t memoryBudget = 0;		// bytes of resident mips over every streamed texture
+	uint32_t tailSize = 64;			// levels this size and smaller load first and are never dropped
+	uint32_t idleFrames = 300;		// frames without requests before a texture falls back to its tail
+	float mipBias = 0.0f;			// added to the requested level, positive values stream less
+};
+
+/* A cooked texture whose top levels come and go. The GL texture holds levels residentLevel
+to the last one and its handle sits at handleIndex of the texture handle SSBO. */
+struct StreamedTexture {
+	Texture info;				// format, size, mips and paths, never any data
+	std::string cachePath;
+	uint32_t handleIndex = 0;
+	Texture2D glTexture;		// empty until the tail arrives, the placeholder is bound meanwhile
+	uint32_t residentLevel = 0;	// mip count while nothing is resident
+	uint32_t tailLevel = 0;
+	uint32_t requestedLevel = 0;	// finest level asked for this frame
+	uint64_t lastRequestFrame = 0;
+	bool loading = false;		// a read or an upload is in flight, residency is left alone
+	bool failed = false;
+};
+
+/* Levels to read from a cooked texture, or the whole texture to cook when info has no format yet. */
+struct TextureStreamJob {
+	uint32_t texture = 0;
+	uint32_t firstLevel = 0;
+	uint32_t lastLevel = 0;
+	Texture info;				// compressedData carries the levels back
+	std::string cachePath;
+	bool ok = false;
+};
+
+/* Levels read by a worker on their way into a new texture, a few rows of blocks per frame. */
+struct TextureUpload {
+	uint32_t texture = 0;
+	uint32_t firstLevel = 0;	// levels in data, the coarser ones are copied from the resident texture
+	uint32_t lastLevel = 0;
+	std::vector<uint8_t> data;
+	Texture2D target;
+	uint32_t level = 0;			// next level and block row to upload
+	uint32_t row = 0;
+	bool started = false;
+};
+
+/* Streams the mips of cooked textures behind bindless handles. Workers read level ranges from
+the cache, or cook a texture whose cache is missing, and the render thread uploads them through
+a persistent mapped pixel unpack ring under a per frame byte budget. Every texture starts at its
+small tail levels and refines to the level its visible instances request. Bindless textures are
+immutable, so a residency change builds a texture with the new level range, copies the levels it
+shares with the old one on the GPU and swaps the handle. Textures nobody asked for in a while go
+back to their tail and the least recently requested ones make room when the budget runs out. */
+class TextureStreamer {
+public:
+	using HandleCallback = std::function<void(const uint32_t handleIndex, const GLuint64 handle)>;
+
+	TextureStreamer() = default;
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+	~TextureStreamer() { Stop(); }
+
+	/* onHandleChanged writes a texture's new handle wherever the shaders read it. */
+	void Start(const TextureStreamSettings& settings, HandleCallback onHandleChanged);
+	void Stop();
+
+	/* Returns the handle to bind at handleIndex until the texture's tail is resident. */
+	GLuint64 Register(const Texture* texture, const uint32_t handleIndex);
+
+	/* The texture at handleIndex covers about pixels on screen this frame. */
+	void Request(const uint32_t handleIndex, const float pixels, const uint64_t frame);
+
+	/* Applies finished reads, uploads within the budget and starts or drops levels. */
+	void Update(const uint64_t frame);
+	void EndFrame();
+
+	bool IsRunning() const { return !workers.empty(); }
+	size_t GetResidentBytes() const { return residentBytes; }
+
+private:
+	TextureStreamSettings settings;
+	HandleCallback onHandleChanged;
+	bool useBC7 = false;
+
+	std::vector<StreamedTexture> textures;
+	std::unordered_map<uint32_t, uint32_t> handleToTexture;
+	size_t residentBytes = 0;
+	size_t pendingBytes = 0;		// levels read or uploading, counted against the budget already
+
+	Texture2D placeholder;
+	Texture2D normalPlaceholder;
+
+	StreamingBuffer stagingPBO;
+	std::deque<TextureUpload> uploads;
+	std::vector<std::pair<uint64_t, Texture2D>> retiredTextures;	// frame replaced, texture
+	std::vector<std::pair<uint32_t, uint32_t>> loadOrder;			// levels missing, texture
+	std::vector<std::pair<uint64_t, uint32_t>> evictionOrder;		// last request frame, texture
+	uint64_t currentFrame = 0;
+
+	std::mutex jobsMutex;
+	std::condition_variable_any jobAvailable;
+	std::deque<TextureStreamJob> jobs;
+	std::mutex resultsMutex;
+	std::vector<TextureStreamJob> results;
+	std::vector<TextureStreamJob> finishedJobs;
+	std::vector<std::jthread> workers;
+
+	void Run(std::stop_token stopToken);
+	void QueueLevels(const uint32_t index, const uint32_t firstLevel, const uint32_t lastLevel);
+	void RetireTextures();
+	void ApplyResults();
+	void ProcessUploads();
+	void UpdateResidency();
+	bool MakeRoom(const size_t bytes);
+
+	Texture2D CreateTexture(const StreamedTexture& texture, const uint32_t firstLevel) const;
+	void CopyLevels(const StreamedTexture& texture, const Texture2D& target, const uint32_t targetFirstLevel, const uint32_t firstLevel) const;
+	void SwapTexture(StreamedTexture& texture, Texture2D& target, const uint32_t firstLevel);
+	void DropLevels(StreamedTexture& texture, const uint32_t firstLevel);
+	size_t GetLevelBytes(const StreamedTexture& texture, const uint32_t firstLevel, const uint32_t endLevel) const;
+};
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <cstring>
+#include <utility>
 #include <Core/Core.h>
 #include <Core/Log/Logging.h>
 #include "IBindable.h"
 
+// frames the CPU may run ahead of the GPU on streamed buffers
+#define STREAMING_BUFFER_FRAMES 3
+#define STREAMING_BUFFER_WAIT_NS 1000000
+
 class IBuffer {
 public:
 	IBuffer() = default;
@@ -31,6 +37,11 @@ public:
 		size = newSize;
 	}
 
+	/* Zero fills the whole buffer on the GPU. */
+	void Clear() {
+		glClearNamedBufferData(id, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	}
+
 	GLuint GetID() { return id; }
 	GLsizeiptr GetSize() { return size; }
 	GLenum GetMode() { return mode; }
@@ -106,6 +117,11 @@ public:
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, id);
 	}
 
+	/* Points the binding back at this buffer, e.g. after a streamed buffer used the same slot. */
+	void BindBase() const {
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, id);
+	}
+
 	GLuint GetBindingPoint() const { return bindingPoint; }
 
 private:
@@ -130,8 +146,217 @@ public:
 		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 	}
 
+	void BindBase() const {
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, id);
+	}
+
+	GLuint GetBindingPoint() const { return bindingPoint; }
+
+private:
+	GLuint bindingPoint = 0;
+};
+
+/* Holds draw counts written on the GPU, read by the *IndirectCount draws. */
+class ParameterBuffer : public IBuffer {
+public:
+	ParameterBuffer() = default;
+	ParameterBuffer(const GLuint bindingPoint, const GLsizeiptr size, const GLenum mode = GL_DYNAMIC_STORAGE_BIT)
+		: IBuffer(size, mode), bindingPoint(bindingPoint) {
+		glCreateBuffers(1, &id);
+		glNamedBufferStorage(id, size, nullptr, mode);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, id);
+	}
+
+	void Bind() const {
+		glBindBuffer(GL_PARAMETER_BUFFER, id);
+	}
+
+	void Unbind() const {
+		glBindBuffer(GL_PARAMETER_BUFFER, 0);
+	}
+
+	void BindBase() const {
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, id);
+	}
+
 	GLuint GetBindingPoint() const { return bindingPoint; }
 
 private:
 	GLuint bindingPoint = 0;
-};
\ No newline at end of file
+};
+
+/* Persistently mapped ring of per-frame regions for data rewritten every frame.
+The CPU writes straight into the current region and binds by offset. A fence per
+region keeps it from overwriting data the GPU may still read. Each frame writes
+a region once, then EndFrame() fences it and moves on. Regions are not carried
+over between frames, so whatever the GPU reads has to be written again every frame. */
+class StreamingBuffer {
+public:
+	StreamingBuffer() = default;
+	StreamingBuffer(const GLenum target, const GLuint bindingPoint, const GLsizeiptr regionSize, const uint32_t regionCount = STREAMING_BUFFER_FRAMES)
+		: target(target), bindingPoint(bindingPoint), regionCount(regionCount) {
+		Allocate(regionSize);
+		BindRange();
+	}
+
+	~StreamingBuffer() {
+		Release();
+	}
+
+	StreamingBuffer(const StreamingBuffer&) = delete;
+	StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+	StreamingBuffer(StreamingBuffer&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	StreamingBuffer& operator=(StreamingBuffer&& other) noexcept {
+		if (this == &other)
+			return *this;
+
+		Release();
+		id = std::exchange(other.id, 0);
+		target = other.target;
+		bindingPoint = other.bindingPoint;
+		regionSize = std::exchange(other.regionSize, 0);
+		regionCount = other.regionCount;
+		region = std::exchange(other.region, 0);
+		mapped = std::exchange(other.mapped, nullptr);
+		fences = std::move(other.fences);
+		other.fences.clear();
+		return *this;
+	}
+
+	/* Returns the current region to write into, growing the buffer if it is too small. */
+	void* BeginWrite(const GLsizeiptr dataSize) {
+		if (dataSize > regionSize) {
+			Reallocate(std::max(regionSize * 2, dataSize));
+		}
+
+		WaitForRegion(region);
+		return mapped + GetRegionOffset();
+	}
+
+	/* Points the binding at the region written this frame. */
+	void EndWrite() {
+		BindRange();
+	}
+
+	/* Writes into the current region only. The bytes before offset and past offset + dataSize
+	hold whatever an older frame left there, so callers write the full range they bind each frame. */
+	void UpdateData(const GLintptr offset, const GLsizeiptr dataSize, const void* data) {
+		uint8_t* dst = static_cast<uint8_t*>(BeginWrite(offset + dataSize));
+		std::memcpy(dst + offset, data, dataSize);
+		EndWrite();
+	}
+
+	void EndFrame() {
+		if (fences[region])
+			glDeleteSync(fences[region]);
+
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		region = (region + 1) % regionCount;
+	}
+
+	void Bind() const {
+		glBindBuffer(target, id);
+	}
+
+	void Unbind() const {
+		glBindBuffer(target, 0);
+	}
+
+	GLintptr GetRegionOffset() const { return static_cast<GLintptr>(region) * regionSize; }
+	const void* GetIndirectOffset() const { return reinterpret_cast<const void*>(GetRegionOffset()); }
+
+	GLuint GetID() const { return id; }
+	GLsizeiptr GetRegionSize() const { return regionSize; }
+	GLuint GetBindingPoint() const { return bindingPoint; }
+
+private:
+	GLuint id = 0;
+	GLenum target = GL_UNIFORM_BUFFER;
+	GLuint bindingPoint = 0;
+	GLsizeiptr regionSize = 0;
+	uint32_t regionCount = STREAMING_BUFFER_FRAMES;
+	uint32_t region = 0;
+	uint8_t* mapped = nullptr;
+	std::vector<GLsync> fences;
+
+	void Allocate(const GLsizeiptr requestedSize) {
+		// regions are bound by offset, so they have to respect the binding alignment
+		GLint uboAlignment = 256;
+		GLint ssboAlignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssboAlignment);
+		const GLsizeiptr alignment = std::max(uboAlignment, ssboAlignment);
+		regionSize = std::max<GLsizeiptr>(1, (requestedSize + alignment - 1) / alignment) * alignment;
+
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &id);
+		glNamedBufferStorage(id, regionSize * regionCount, nullptr, flags);
+		mapped = static_cast<uint8_t*>(glMapNamedBufferRange(id, 0, regionSize * regionCount, flags));
+
+		if (mapped == nullptr)
+			LOG(LogOpenGL, LOG_CRITICAL, std::format("Failed to map streaming buffer {}.", id));
+
+		fences.assign(regionCount, nullptr);
+		region = 0;
+	}
+
+	void Release() {
+		// static owners can outlive the context, the driver frees everything with it then
+		if (id == 0 || glfwGetCurrentContext() == nullptr)
+			return;
+
+		for (GLsync fence : fences) {
+			if (fence)
+				glDeleteSync(fence);
+		}
+		fences.clear();
+
+		if (mapped)
+			glUnmapNamedBuffer(id);
+
+		glDeleteBuffers(1, &id);
+		id = 0;
+		mapped = nullptr;
+	}
+
+	void Reallocate(const GLsizeiptr newRegionSize) {
+		LOG(LogOpenGL, LOG_WARNING, std::format("Resizing streaming buffer {} from {}b to {}b per frame.", id, regionSize, newRegionSize));
+
+		for (uint32_t i = 0; i < regionCount; i++)
+			WaitForRegion(i);
+
+		glUnmapNamedBuffer(id);
+		glDeleteBuffers(1, &id);
+		Allocate(newRegionSize);
+	}
+
+	void WaitForRegion(const uint32_t index) {
+		GLsync& fence = fences[index];
+		if (!fence)
+			return;
+
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		while (result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, STREAMING_BUFFER_WAIT_NS);
+
+		if (result == GL_WAIT_FAILED)
+			LOG(LogOpenGL, LOG_ERROR, std::format("Waiting on streaming buffer {} failed.", id));
+
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	void BindRange() const {
+		// pixel unpack regions are addressed by offset, the target has no indexed bindings
+		if (target == GL_PIXEL_UNPACK_BUFFER)
+			return;
+
+		// indirect commands are also read by the vertex shader through an SSBO
+		const GLenum indexedTarget = target == GL_DRAW_INDIRECT_BUFFER ? GL_SHADER_STORAGE_BUFFER : target;
+		glBindBufferRange(indexedTarget, bindingPoint, id, GetRegionOffset(), regionSize);
+	}
+};
@@ -57,6 +57,15 @@ public:
 		colorTextAttachments[attachmentIndex] = texture;
 	}
 
+	/* Attaches a single layer of an array texture. */
+	void AttachColorTexLayer(const GLuint texture, const GLuint attachmentIndex, const GLint layer) {
+		glNamedFramebufferTextureLayer(id, GL_COLOR_ATTACHMENT0 + attachmentIndex, texture, 0, layer);
+		if (attachmentIndex >= colorTextAttachments.size()) {
+			colorTextAttachments.resize(attachmentIndex + 1);
+		}
+		colorTextAttachments[attachmentIndex] = texture;
+	}
+
 	void AttachColorTex2Ds(const std::vector<GLuint>& textures) {
 		size_t i = 0;
 		for (const auto& texture : textures) {
@@ -74,6 +83,12 @@ public:
 		depthTextAttachment = texture;
 	}
 
+	/* Attaches a single layer of an array or cube map array texture. */
+	void AttachDepthTexLayer(const GLuint texture, const GLint layer) {
+		glNamedFramebufferTextureLayer(id, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+		depthTextAttachment = texture;
+	}
+
 	void DettachDepthTexture() {
 		glNamedFramebufferTexture(id, GL_DEPTH_STENCIL_ATTACHMENT, 0, 0);
 		depthTextAttachment = 0;
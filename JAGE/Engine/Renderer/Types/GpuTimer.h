@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Core/Core.h>
+
+// queries in flight, results are read a few frames after they were issued
+#define GPU_TIMER_QUERIES 4
+
+/* GL_TIME_ELAPSED queries in a small ring. Finished results are summed without ever
+waiting on the GPU, a measurement is dropped when every query is still in flight. */
+class GpuTimer {
+public:
+	GpuTimer() = default;
+
+	explicit GpuTimer(const GLuint queryCount) : ids(queryCount, 0), pending(queryCount, false) {
+		glCreateQueries(GL_TIME_ELAPSED, queryCount, ids.data());
+	}
+
+	void Begin() {
+		Collect();
+		if (ids.empty() || pending[next])
+			return;
+
+		glBeginQuery(GL_TIME_ELAPSED, ids[next]);
+		active = true;
+	}
+
+	void End() {
+		if (!active)
+			return;
+
+		glEndQuery(GL_TIME_ELAPSED);
+		pending[next] = true;
+		next = (next + 1) % ids.size();
+		active = false;
+	}
+
+	void Collect() {
+		for (size_t i = 0; i < ids.size(); i++) {
+			if (!pending[i])
+				continue;
+
+			GLint available = 0;
+			glGetQueryObjectiv(ids[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				continue;
+
+			GLuint64 elapsedNs = 0;
+			glGetQueryObjectui64v(ids[i], GL_QUERY_RESULT, &elapsedNs);
+			totalNs += elapsedNs;
+			samples++;
+			pending[i] = false;
+		}
+	}
+
+	/* Waits for the queries in flight and drops them with the totals. */
+	void Reset() {
+		for (size_t i = 0; i < ids.size(); i++) {
+			GLuint64 elapsedNs = 0;
+			if (pending[i])
+				glGetQueryObjectui64v(ids[i], GL_QUERY_RESULT, &elapsedNs);
+			pending[i] = false;
+		}
+
+		totalNs = 0;
+		samples = 0;
+	}
+
+	double GetMeanMs() const { return samples > 0 ? static_cast<double>(totalNs) / samples * 1e-6 : 0.0; }
+	uint32_t GetSampleCount() const { return samples; }
+
+private:
+	std::vector<GLuint> ids;
+	std::vector<bool> pending;
+	size_t next = 0;
+	bool active = false;
+	GLuint64 totalNs = 0;
+	uint32_t samples = 0;
+};
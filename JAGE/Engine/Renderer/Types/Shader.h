@@ -1,8 +1,31 @@
 #pragma once
 
 #include <Core/Core.h>
+#include <cstring>
 #include "IBindable.h"
 
+/* Uniform and block names are hashed at compile time. Setters look the hash
+up in the table the program reflects when it links, so no string reaches GL. */
+struct UniformHandle {
+	uint32_t hash = 0;
+	const char* name = "";
+
+	consteval UniformHandle(const char* name) : hash(Utils::HashString(name)), name(name) {}
+};
+
+struct ShaderUniform {
+	GLint location = -1;
+	GLenum type = GL_NONE;
+	GLint arraySize = 1;
+	std::string name;
+};
+
+struct ShaderBlock {
+	GLenum interface = GL_UNIFORM_BLOCK;
+	GLint binding = -1;
+	std::string name;
+};
+
 class Shader {
 public:
     Shader() = default;
@@ -11,6 +34,10 @@ public:
 		Compile();
 	}
 
+	explicit Shader(const std::string& compCode) : compCode(compCode) {
+		Compile();
+	}
+
 	bool IsCompiled() const { return isCompiled; }
 
 	void Bind() const {
@@ -21,32 +48,75 @@ public:
 		glUseProgram(0);
 	}
 
-	void SetUBool(const std::string& name, const bool value) const {
-		glUniform1i(glGetUniformLocation(id, name.c_str()), static_cast<uint32_t>(value));
+	/* Runs a compute program, it has to be bound. */
+	void Dispatch(const GLuint groupsX, const GLuint groupsY = 1, const GLuint groupsZ = 1) const {
+		glDispatchCompute(groupsX, groupsY, groupsZ);
+	}
+
+	void SetUBool(const UniformHandle uniform, const bool value) const {
+		glProgramUniform1i(id, GetLocation(uniform), static_cast<uint32_t>(value));
 	}
 
-	void SetUInt(const std::string& name, const uint32_t value) const {
-		glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+	void SetUInt(const UniformHandle uniform, const uint32_t value) const {
+		glProgramUniform1i(id, GetLocation(uniform), value);
 	}
 
-	void SetUFloat(const std::string& name, const float value) const {
-		glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+	void SetUFloat(const UniformHandle uniform, const float value) const {
+		glProgramUniform1f(id, GetLocation(uniform), value);
 	}
 
-	void SetUMat4(const std::string& name, const glm::mat4& value) const {
-		glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &value[0][0]);
+	void SetUMat4(const UniformHandle uniform, const glm::mat4& value) const {
+		glProgramUniformMatrix4fv(id, GetLocation(uniform), 1, GL_FALSE, &value[0][0]);
 	}
 
-	void SetUVec3(const std::string& name, const glm::vec3& value) const {
-		glUniform3fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+	void SetUVec3(const UniformHandle uniform, const glm::vec3& value) const {
+		glProgramUniform3fv(id, GetLocation(uniform), 1, &value[0]);
 	}
 
-	void SetUVec2(const std::string& name, const glm::vec2& value) const {
-		glUniform2fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+	void SetUVec2(const UniformHandle uniform, const glm::vec2& value) const {
+		glProgramUniform2fv(id, GetLocation(uniform), 1, &value[0]);
 	}
 
-	void SetUMat4v(const std::string& name, const GLsizei size, const glm::mat4* values) const {
-		glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), size, GL_FALSE, glm::value_ptr(values[0]));
+	void SetUVec4v(const UniformHandle uniform, const GLsizei size, const glm::vec4* values) const {
+		glProgramUniform4fv(id, GetLocation(uniform), size, glm::value_ptr(values[0]));
+	}
+
+	void SetUMat4v(const UniformHandle uniform, const GLsizei size, const glm::mat4* values) const {
+		glProgramUniformMatrix4fv(id, GetLocation(uniform), size, GL_FALSE, glm::value_ptr(values[0]));
+	}
+
+	bool HasUniform(const UniformHandle uniform) const {
+		return uniforms.find(uniform.hash) != uniforms.end();
+	}
+
+	/* Reports uniforms the C++ side sets but the program does not have,
+	e.g. a renamed or optimized out uniform. Call once after creation. */
+	bool RequireUniforms(std::initializer_list<UniformHandle> required) const {
+		bool found = true;
+		for (const UniformHandle& uniform : required) {
+			if (!HasUniform(uniform)) {
+				LOG(LogOpenGL, LOG_ERROR, std::format("Shader {} has no active uniform {}.", id, uniform.name));
+				found = false;
+			}
+		}
+
+		return found;
+	}
+
+	/* Checks that a uniform or storage block exists and uses the binding point the engine uploads to. */
+	bool RequireBlock(const UniformHandle block, const GLint binding) const {
+		auto it = blocks.find(block.hash);
+		if (it == blocks.end()) {
+			LOG(LogOpenGL, LOG_ERROR, std::format("Shader {} has no active block {}.", id, block.name));
+			return false;
+		}
+
+		if (it->second.binding != binding) {
+			LOG(LogOpenGL, LOG_ERROR, std::format("Shader {} binds block {} to {}, the engine expects {}.", id, block.name, it->second.binding, binding));
+			return false;
+		}
+
+		return true;
 	}
 
 private:
@@ -55,32 +125,111 @@ private:
 	std::string vertCode;
 	std::string fragCode;
 	std::string geomCode;
+	std::string compCode;
 
 	bool isCompiled = false;
 
-	void Compile() {
-		GLuint vertShader = CompileCode(vertCode, GL_VERTEX_SHADER);
-		GLuint fragShader = CompileCode(fragCode, GL_FRAGMENT_SHADER);
+	std::unordered_map<uint32_t, ShaderUniform> uniforms;
+	std::unordered_map<uint32_t, ShaderBlock> blocks;
+	mutable std::unordered_set<uint32_t> reportedUniforms;
+
+	GLint GetLocation(const UniformHandle uniform) const {
+		auto it = uniforms.find(uniform.hash);
+		if (it != uniforms.end())
+			return it->second.location;
+
+		// -1 makes GL ignore the set, report it once instead of every frame
+		if (reportedUniforms.insert(uniform.hash).second)
+			LOG(LogOpenGL, LOG_WARNING, std::format("Shader {} has no active uniform {}.", id, uniform.name));
+		return -1;
+	}
+
+	/* Array uniforms are reported as name[0], they are stored under the bare name. */
+	static std::string GetResourceName(const GLuint programID, const GLenum interface, const GLuint index, const GLint nameLength) {
+		std::string name(static_cast<size_t>(nameLength), '\0');
+		glGetProgramResourceName(programID, interface, index, nameLength, nullptr, name.data());
+		name.resize(std::strlen(name.c_str()));
 
-		GLuint geomShader = 0;
-		if (!geomCode.empty()) {
-			geomShader = CompileCode(geomCode, GL_GEOMETRY_SHADER);
+		const size_t bracket = name.find('[');
+		if (bracket != std::string::npos)
+			name.resize(bracket);
+		return name;
+	}
+
+	void Reflect() {
+		uniforms.clear();
+		blocks.clear();
+
+		GLint uniformCount = 0;
+		glGetProgramInterfaceiv(id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+		for (GLint i = 0; i < uniformCount; i++) {
+			const GLenum props[] = { GL_NAME_LENGTH, GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+			GLint values[5];
+			glGetProgramResourceiv(id, GL_UNIFORM, i, 5, props, 5, nullptr, values);
+
+			// block members are fed through buffers, not setters
+			if (values[4] != -1)
+				continue;
+
+			ShaderUniform uniform;
+			uniform.name = GetResourceName(id, GL_UNIFORM, i, values[0]);
+			uniform.location = values[1];
+			uniform.type = static_cast<GLenum>(values[2]);
+			uniform.arraySize = values[3];
+
+			const uint32_t hash = Utils::HashString(uniform.name);
+			auto [it, inserted] = uniforms.emplace(hash, uniform);
+			if (!inserted)
+				LOG(LogOpenGL, LOG_ERROR, std::format("Uniforms {} and {} of shader {} share a name hash.", it->second.name, uniform.name, id));
 		}
 
-		GLuint programID = LinkProgram(vertShader, fragShader, geomShader);
+		for (const GLenum interface : { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK }) {
+			GLint blockCount = 0;
+			glGetProgramInterfaceiv(id, interface, GL_ACTIVE_RESOURCES, &blockCount);
+			for (GLint i = 0; i < blockCount; i++) {
+				const GLenum props[] = { GL_NAME_LENGTH, GL_BUFFER_BINDING };
+				GLint values[2];
+				glGetProgramResourceiv(id, interface, i, 2, props, 2, nullptr, values);
+
+				ShaderBlock block;
+				block.interface = interface;
+				block.name = GetResourceName(id, interface, i, values[0]);
+				block.binding = values[1];
+				blocks.emplace(Utils::HashString(block.name), block);
+			}
+		}
+	}
+
+	void Compile() {
+		GLuint programID = 0;
+		if (!compCode.empty()) {
+			programID = LinkProgram({ CompileCode(compCode, GL_COMPUTE_SHADER) });
+		}
+		else {
+			GLuint vertShader = CompileCode(vertCode, GL_VERTEX_SHADER);
+			GLuint fragShader = CompileCode(fragCode, GL_FRAGMENT_SHADER);
+
+			GLuint geomShader = 0;
+			if (!geomCode.empty()) {
+				geomShader = CompileCode(geomCode, GL_GEOMETRY_SHADER);
+			}
+
+			programID = LinkProgram({ vertShader, fragShader, geomShader });
+		}
 
 		this->id = programID;
 		this->isCompiled = true;
+
+		Reflect();
 	}
 
-	GLuint LinkProgram(const GLuint vertexShader, const GLuint fragShader, const GLuint geomShader) {
+	GLuint LinkProgram(std::initializer_list<GLuint> shaders) {
 		GLuint programID = glCreateProgram();
 
-		glAttachShader(programID, vertexShader);
-		glAttachShader(programID, fragShader);
-
-		if (geomShader != 0)
-			glAttachShader(programID, geomShader);
+		for (const GLuint shader : shaders) {
+			if (shader != 0)
+				glAttachShader(programID, shader);
+		}
 
 		glLinkProgram(programID);
 
@@ -89,15 +238,14 @@ private:
 		if (!success) {
 			char infoLog[512];
 			glGetProgramInfoLog(programID, 512, nullptr, infoLog);
-			LOG(LogOpenGL, LOG_CRITICAL, std::format("Shader program link failed. Code: {} \n Info: {}", vertCode + fragCode + geomCode, infoLog));
+			LOG(LogOpenGL, LOG_CRITICAL, std::format("Shader program link failed. Code: {} \n Info: {}", vertCode + fragCode + geomCode + compCode, infoLog));
 			//throw std::runtime_error("Shader: Program Linking Error: " + std::string(infoLog));
 		}
 
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragShader);
-
-		if (geomShader != 0)
-			glDeleteShader(geomShader);
+		for (const GLuint shader : shaders) {
+			if (shader != 0)
+				glDeleteShader(shader);
+		}
 
 		return programID;
 	}
@@ -70,13 +70,17 @@ public:
 			handle = glGetTextureHandleARB(id);
 		}
 
-		if (!isResident && handle != 0)
+		if (!isResident && handle != 0) {
 			glMakeTextureHandleResidentARB(handle);
+			isResident = true;
+		}
 	}
 
-	void MakeNonResident() const {
-		if (isResident && handle != 0)
+	void MakeNonResident() {
+		if (isResident && handle != 0) {
 			glMakeTextureHandleNonResidentARB(handle);
+			isResident = false;
+		}
 	}
 
 	void Clear() {
@@ -97,6 +101,8 @@ public:
 
 	std::string GetName() const { return name; }
 	GLuint GetID() const { return id; }
+	GLuint GetWidth() const { return width; }
+	GLuint GetHeight() const { return height; }
 	GLuint64 GetHandle() const { return handle; }
 	uint32_t GetHandleIndex() const { return handleIdx; }
 	void SetHandleIndex(const int32_t index) { handleIdx = index; }
@@ -190,12 +196,13 @@ public:
 		const std::string name,
 		const GLenum internalFormat,
 		const GLuint width,
-		const GLuint height)
+		const GLuint height,
+		const GLsizei levels = 1)
 		: TextureBase(
 			name,
 			internalFormat,
 			width,
-			height) {
+			height), levels(levels) {
 
 		glCreateTextures(GL_TEXTURE_2D, 1, &id);
 		glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -203,7 +210,7 @@ public:
 		glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		glTextureParameteri(id, GL_TEXTURE_WRAP_R, GL_REPEAT);
-		glTextureStorage2D(id, 1, internalFormat, width, height);
+		glTextureStorage2D(id, levels, internalFormat, width, height);
 	}
 
 	void Bind() override {
@@ -228,6 +235,24 @@ public:
 		glTextureSubImage2D(id, level, xoffset, yoffset, width, height, format, type, data);
 	}
 
+	/* Uploads one level of block compressed data in the texture's internal format. */
+	void SetCompressedSubImage2D(const GLint level, const GLsizei levelWidth, const GLsizei levelHeight, const GLsizei size, const void* data) {
+		if (data == nullptr)
+			LOG(LogOpenGL, LOG_CRITICAL, std::format("Failed to set compressed sub image 2D for texture {}. Data is null.", name));
+
+		glCompressedTextureSubImage2D(id, level, 0, 0, levelWidth, levelHeight, internalFormat, size, data);
+	}
+
+	/* Uploads whole rows of blocks of one level starting at yoffset. With a pixel unpack
+	buffer bound, data is an offset into it and may be null. */
+	void SetCompressedSubImage2D(const GLint level, const GLint yoffset, const GLsizei levelWidth, const GLsizei rowsHeight, const GLsizei size, const void* data) {
+		glCompressedTextureSubImage2D(id, level, 0, yoffset, levelWidth, rowsHeight, internalFormat, size, data);
+	}
+
+	GLsizei GetLevels() const { return levels; }
+
+private:
+	GLsizei levels = 1;
 };
 
 class Texture2DArray : public TextureBase {
@@ -28,9 +28,10 @@ bool World::Initialize()
 	any.set();
 
 	physicsSys = RegisterSystem<PhysicsSystem>();
-	Signature physicsSysReqSign = MakeSignature<Transform, RigidBody>();
+	Signature physicsSysReqSign = MakeSignature<Transform>();
+	Signature physicsSysOptSign = MakeSignature<RigidBody, Collider>();
 	SetSystemRequiredSignature<PhysicsSystem>(physicsSysReqSign);
-	SetSystemOptionalSignature<PhysicsSystem>(any);
+	SetSystemOptionalSignature<PhysicsSystem>(physicsSysOptSign);
 
 	characterSys = RegisterSystem<CharacterSystem>();
 	Signature charSysReqSign = MakeSignature<Transform, Character>();
@@ -49,14 +50,17 @@ bool World::Initialize()
 	SetSystemOptionalSignature<RenderSystem>(renderSysOptSign);
 	renderSys->SetRenderApi(&OpenGlApi::Get());
 
-	MeshModel& DefaultPlane = AssetLoader::Get().LoadMeshModelFromFile(
-		"Assets/Meshes/default_plane.obj");
-	MeshModel& DefaultCube = AssetLoader::Get().LoadMeshModelFromFile(
-		"Assets/Meshes/default_cube.obj");
-	MeshModel& backpackModel = AssetLoader::Get().LoadMeshModelFromFile(
-		"Assets/Meshes/SurvivalGuitarBackpack/backpack.obj");
-	MeshModel& akModel = AssetLoader::Get().LoadMeshModelFromFile(
-		"Assets/Meshes/ak47/ak47.obj", true);
+	// the imports run side by side, waiting only registers each one once it is done
+	auto& assetLoader = AssetLoader::Get();
+	auto defaultPlaneImport = assetLoader.LoadMeshModelAsync("Assets/Meshes/default_plane.obj");
+	auto defaultCubeImport = assetLoader.LoadMeshModelAsync("Assets/Meshes/default_cube.obj");
+	auto backpackImport = assetLoader.LoadMeshModelAsync("Assets/Meshes/SurvivalGuitarBackpack/backpack.obj");
+	auto akImport = assetLoader.LoadMeshModelAsync("Assets/Meshes/ak47/ak47.obj", true);
+
+	MeshModel& DefaultPlane = assetLoader.Wait(defaultPlaneImport);
+	MeshModel& DefaultCube = assetLoader.Wait(defaultCubeImport);
+	MeshModel& backpackModel = assetLoader.Wait(backpackImport);
+	MeshModel& akModel = assetLoader.Wait(akImport);
 
 	Window::Get().SetMouseCursorVisibility(false);
 
@@ -75,7 +79,8 @@ bool World::Initialize()
 
 	Entity ground = CreateEntity();
 	AddComponent(ground, Transform{ Vec3(0.0f, -1.5f, 0.0f), NullVec3, Vec3(1000.0f, 1.0f, 1000.0f) });
-	AddComponent(ground, StaticMeshRenderer{ DefaultPlane.meshes });
+	AddComponent(ground, StaticMeshRenderer{ .meshes = DefaultPlane.meshes, .isOccluder = true });
+	AddComponent(ground, Collider{ ColliderType::Mesh });
 
 	uint32_t nBackpacks = 5;
 	std::vector<Transform*> bkpTransforms;
@@ -107,7 +112,7 @@ bool World::Initialize()
 		Entity cube = CreateEntity();
 		AddComponent(cube, Transform{ Utils::RandomPointInSphere(15.f, Vec3(0.0f, 100.0f, 0.0f)), Vec3(0), Vec3(1) });
 		// AddComponent(cube, Transform{ Vec3(0, 100, 0), Vec3(0.0f), Vec3(1.0) });
-		AddComponent(cube, StaticMeshRenderer{ DefaultCube.meshes });
+		AddComponent(cube, StaticMeshRenderer{ .meshes = DefaultCube.meshes, .isOccluder = true });
 		AddComponent(cube, RigidBody());
 		AddComponent(cube, Collider{ ColliderType::Mesh });
 		World::Get().GetComponent<Collider>(cube).SetMeshes(DefaultCube.meshes);
@@ -36,6 +36,9 @@ public:
 
 	const Signature GetEntitySignature(Entity entity) const;
 
+	/* What the physics scene cache is checked against, see PhysicsSystem::GetLayoutHash. */
+	uint64_t GetPhysicsLayoutHash() { return physicsSys->GetLayoutHash(); }
+
 	template<typename T>
 	void RegisterComponent()
 	{
@@ -0,0 +1,9 @@
+#include <Physics/PhysicsBench.h>
+
+/* Headless entry point for the Linux build. Same as running the engine with --bench-physics. */
+int main(int argc, char** argv) {
+	StressSettings settings;
+	if (!PhysicsBench::ParseStressSettings(argc, argv, 1, settings)) return 1;
+	if (!Physics::Initialize()) return 1;
+	return PhysicsBench::RunStress(settings) ? 0 : 1;
+}
@@ -1,6 +1,19 @@
 #include "Engine/Engine.h"
+#include "Engine/Physics/PhysicsBench.h"
+
+int main(int argc, char** argv) {
+	if (argc > 1 && std::string(argv[1]) == "--bench-broadphase") {
+		if (!Physics::Initialize()) return 1;
+		return PhysicsBench::RunBroadPhase() ? 0 : 1;
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--bench-physics") {
+		StressSettings settings;
+		if (!PhysicsBench::ParseStressSettings(argc, argv, 2, settings)) return 1;
+		if (!Physics::Initialize()) return 1;
+		return PhysicsBench::RunStress(settings) ? 0 : 1;
+	}
 
-int main() {
 	Engine engine = Engine();
 	engine.Init();
 	return 0;